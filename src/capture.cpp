@@ -0,0 +1,164 @@
+#include "capture.h"
+
+#include <string.h>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+struct FrameCapture
+{
+    OglsReadback readback;
+    uint32_t width, height;
+    uint32_t maxQueuedFrames;
+    CaptureWriteFn write;
+    void* userData;
+    uint64_t nextIndex;
+
+    std::thread writer;
+    std::mutex mutex;
+    std::condition_variable queueChanged;
+    std::deque<CaptureFrame> queue;
+    std::vector<std::vector<uint8_t>> freeBuffers; // pixel buffers are recycled so steady state capture never allocates
+    bool stopping;
+    bool finished;
+
+    FrameCaptureStats stats;
+};
+
+static void writerThread(FrameCapture* capture)
+{
+    std::unique_lock<std::mutex> lock(capture->mutex);
+
+    while (true)
+    {
+        capture->queueChanged.wait(lock, [capture] { return !capture->queue.empty() || capture->stopping; });
+        if (capture->queue.empty()) { return; }
+
+        CaptureFrame frame = std::move(capture->queue.front());
+        capture->queue.pop_front();
+        capture->queueChanged.notify_all();
+
+        lock.unlock();
+        capture->write(capture->userData, &frame);
+        lock.lock();
+
+        capture->freeBuffers.push_back(std::move(frame.pixels));
+        capture->stats.framesWritten++;
+    }
+}
+
+// copies the oldest readback out of its mapped buffer and queues it for the writer
+static bool collectFrame(FrameCapture* capture, bool wait)
+{
+    const void* pixels;
+    if (ogls::mapReadback(capture->readback, wait, &pixels) == Ogls_Result_Failed) { return false; }
+
+    CaptureFrame frame;
+    frame.index = capture->nextIndex++;
+    frame.width = capture->width;
+    frame.height = capture->height;
+
+    {
+        std::lock_guard<std::mutex> lock(capture->mutex);
+        if (!capture->freeBuffers.empty())
+        {
+            frame.pixels = std::move(capture->freeBuffers.back());
+            capture->freeBuffers.pop_back();
+        }
+    }
+
+    uint32_t size = ogls::getReadbackSize(capture->readback);
+    frame.pixels.resize(size);
+    memcpy(frame.pixels.data(), pixels, size);
+    ogls::unmapReadback(capture->readback);
+
+    std::unique_lock<std::mutex> lock(capture->mutex);
+    if (capture->queue.size() >= capture->maxQueuedFrames)
+    {
+        capture->stats.queueWaits++;
+        capture->queueChanged.wait(lock, [capture] { return capture->queue.size() < capture->maxQueuedFrames; });
+    }
+
+    capture->queue.push_back(std::move(frame));
+    capture->queueChanged.notify_all();
+    return true;
+}
+
+bool createFrameCapture(FrameCapture** capture, FrameCaptureCreateInfo* createInfo)
+{
+    FrameCapture* newCapture = new FrameCapture();
+    newCapture->width = createInfo->width;
+    newCapture->height = createInfo->height;
+    newCapture->maxQueuedFrames = createInfo->maxQueuedFrames ? createInfo->maxQueuedFrames : 1;
+    newCapture->write = createInfo->write;
+    newCapture->userData = createInfo->userData;
+
+    OglsReadbackCreateInfo readbackCreateInfo{};
+    readbackCreateInfo.width = createInfo->width;
+    readbackCreateInfo.height = createInfo->height;
+    readbackCreateInfo.depth = createInfo->readbackDepth;
+    if (ogls::createReadback(&newCapture->readback, &readbackCreateInfo) == Ogls_Result_Failed)
+    {
+        delete newCapture;
+        return false;
+    }
+
+    newCapture->writer = std::thread(writerThread, newCapture);
+
+    *capture = newCapture;
+    return true;
+}
+
+void captureFrame(FrameCapture* capture, OglsFramebuffer framebuffer)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+
+    // take whatever the gpu has already finished, then only wait if the ring has no free buffer left
+    while (ogls::getReadbackPendingCount(capture->readback) > 0 && collectFrame(capture, false)) {}
+
+    OglsResult result = ogls::readbackFramebuffer(capture->readback, framebuffer);
+    if (result == Ogls_Result_Failed && ogls::getReadbackPendingCount(capture->readback) > 0)
+    {
+        capture->stats.readbackWaits++;
+        collectFrame(capture, true);
+        result = ogls::readbackFramebuffer(capture->readback, framebuffer);
+    }
+
+    if (result == Ogls_Result_Success) { capture->stats.framesCaptured++; }
+
+    capture->stats.captureMs += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+void finishFrameCapture(FrameCapture* capture)
+{
+    if (capture->finished) { return; }
+
+    while (ogls::getReadbackPendingCount(capture->readback) > 0)
+    {
+        if (!collectFrame(capture, true)) { break; }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(capture->mutex);
+        capture->stopping = true;
+    }
+    capture->queueChanged.notify_all();
+    capture->writer.join();
+
+    capture->finished = true;
+}
+
+void destroyFrameCapture(FrameCapture* capture)
+{
+    finishFrameCapture(capture);
+    ogls::destroyReadback(capture->readback);
+    delete capture;
+}
+
+FrameCaptureStats getFrameCaptureStats(FrameCapture* capture)
+{
+    std::lock_guard<std::mutex> lock(capture->mutex);
+    return capture->stats;
+}
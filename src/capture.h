@@ -0,0 +1,46 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+#include "ogls.h"
+
+// frames are read back through a ring of pixel pack buffers and handed to a writer thread,
+// so neither the gpu copy nor the file output stalls the render loop
+
+struct FrameCapture;
+
+// rgba8 rows, bottom row first as gl returns them
+struct CaptureFrame
+{
+    uint64_t index;
+    uint32_t width, height;
+    std::vector<uint8_t> pixels;
+};
+
+// called on the writer thread, frames arrive in order
+typedef void (*CaptureWriteFn)(void* userData, const CaptureFrame* frame);
+
+struct FrameCaptureCreateInfo
+{
+    uint32_t width, height;
+    uint32_t readbackDepth;   // frames the gpu may run ahead before a readback is waited on
+    uint32_t maxQueuedFrames; // frames waiting for the writer before capture blocks
+    CaptureWriteFn write;
+    void* userData;
+};
+
+struct FrameCaptureStats
+{
+    uint64_t framesCaptured;
+    uint64_t framesWritten;
+    uint64_t readbackWaits; // the ring was full and the oldest frame had to be waited on
+    uint64_t queueWaits;    // the writer fell behind and capture blocked on the queue
+    double captureMs;       // cpu time spent in captureFrame, summed
+};
+
+bool createFrameCapture(FrameCapture** capture, FrameCaptureCreateInfo* createInfo);
+void captureFrame(FrameCapture* capture, OglsFramebuffer framebuffer);
+void finishFrameCapture(FrameCapture* capture);
+void destroyFrameCapture(FrameCapture* capture);
+FrameCaptureStats getFrameCaptureStats(FrameCapture* capture);
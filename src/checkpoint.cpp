@@ -0,0 +1,368 @@
+#include "checkpoint.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define CHECKPOINT_MAGIC   0x4b435044 // "DPCK"
+#define CHECKPOINT_VERSION 1
+
+// 1.25 MB of members per chunk
+static const uint32_t s_CheckpointDefaultChunkMembers = 65536;
+
+struct CheckpointHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t headerSize;
+    uint32_t stateSize;
+    uint32_t memberCount;
+    uint32_t chunkMembers;
+    uint32_t chunkCount;
+    uint32_t chunkEntrySize;
+    uint64_t stateChecksum;
+    uint64_t tableChecksum;
+};
+
+// members of a chunk follow each other as ENSEMBLE_MEMBER_FLOATS arrays, the layout readEnsembleMembers uses
+struct CheckpointChunk
+{
+    uint64_t offset;
+    uint64_t checksum;
+    uint32_t members;
+    uint32_t reserved;
+};
+
+static_assert(sizeof(CheckpointState) == 88, "checkpoint state is stored as is");
+static_assert(sizeof(CheckpointHeader) == 48, "checkpoint header is stored as is");
+static_assert(sizeof(CheckpointChunk) == 24, "checkpoint chunks are stored as is");
+
+struct Checkpointer
+{
+    std::string path, tempPath, directory;
+    uint32_t chunkMembers;
+
+    std::thread writer;
+    std::mutex mutex;
+    std::condition_variable pending;
+    std::condition_variable idle;
+    bool busy, quit;
+
+    // only touched by the writer while busy is set
+    CheckpointState state;
+    uint32_t memberCount;
+    std::vector<float> members;
+
+    CheckpointerStats stats;
+};
+
+// fnv-1a over 8 byte words with an extra fold so high bits reach the low ones, it only has to catch torn or damaged files
+static uint64_t checkpointChecksum(const void* data, size_t size)
+{
+    const uint8_t* bytes = (const uint8_t*)data;
+    uint64_t hash = 0xcbf29ce484222325ull;
+
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8)
+    {
+        uint64_t word;
+        memcpy(&word, bytes + i, sizeof(word));
+        hash = (hash ^ word) * 0x100000001b3ull;
+        hash ^= hash >> 32;
+    }
+
+    for (; i < size; i++)
+        hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+
+    return hash;
+}
+
+static uint32_t checkpointChunkCount(uint32_t memberCount, uint32_t chunkMembers)
+{
+    return (uint32_t)(((uint64_t)memberCount + chunkMembers - 1) / chunkMembers);
+}
+
+static bool writeAll(int fd, const void* data, size_t size, uint64_t offset)
+{
+    const uint8_t* bytes = (const uint8_t*)data;
+    while (size > 0)
+    {
+        ssize_t written = pwrite(fd, bytes, size, (off_t)offset);
+        if (written < 0 && errno == EINTR) { continue; }
+        if (written <= 0) { return false; }
+
+        bytes += written;
+        offset += (uint64_t)written;
+        size -= (size_t)written;
+    }
+
+    return true;
+}
+
+static bool readAll(int fd, void* data, size_t size, uint64_t offset)
+{
+    uint8_t* bytes = (uint8_t*)data;
+    while (size > 0)
+    {
+        ssize_t read = pread(fd, bytes, size, (off_t)offset);
+        if (read < 0 && errno == EINTR) { continue; }
+        if (read <= 0) { return false; }
+
+        bytes += read;
+        offset += (uint64_t)read;
+        size -= (size_t)read;
+    }
+
+    return true;
+}
+
+// the rename only survives a crash once the directory entry is on disk too
+static bool syncDirectory(const std::string& directory)
+{
+    int fd = open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+    if (fd < 0) { return false; }
+
+    bool synced = fsync(fd) == 0;
+    close(fd);
+    return synced;
+}
+
+static bool writeCheckpointFile(Checkpointer* checkpointer, uint64_t* bytesWritten)
+{
+    int fd = open(checkpointer->tempPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) { return false; }
+
+    uint32_t chunkCount = checkpointChunkCount(checkpointer->memberCount, checkpointer->chunkMembers);
+    std::vector<CheckpointChunk> chunks(chunkCount);
+
+    // chunks go first, each is checksummed right before it is written while its members are still in cache.
+    // the header and table describing them are written last
+    uint64_t offset = sizeof(CheckpointHeader) + sizeof(CheckpointState) + chunkCount * sizeof(CheckpointChunk);
+    bool ok = true;
+    for (uint32_t i = 0; i < chunkCount && ok; i++)
+    {
+        uint32_t first = i * checkpointer->chunkMembers;
+        uint32_t members = std::min(checkpointer->chunkMembers, checkpointer->memberCount - first);
+        const float* data = checkpointer->members.data() + (size_t)first * ENSEMBLE_MEMBER_FLOATS;
+        size_t size = (size_t)members * ENSEMBLE_MEMBER_FLOATS * sizeof(float);
+
+        chunks[i] = { offset, checkpointChecksum(data, size), members, 0 };
+        ok = writeAll(fd, data, size, offset);
+        offset += size;
+    }
+
+    CheckpointHeader header{};
+    header.magic = CHECKPOINT_MAGIC;
+    header.version = CHECKPOINT_VERSION;
+    header.headerSize = sizeof(CheckpointHeader);
+    header.stateSize = sizeof(CheckpointState);
+    header.memberCount = checkpointer->memberCount;
+    header.chunkMembers = checkpointer->chunkMembers;
+    header.chunkCount = chunkCount;
+    header.chunkEntrySize = sizeof(CheckpointChunk);
+    header.stateChecksum = checkpointChecksum(&checkpointer->state, sizeof(CheckpointState));
+    header.tableChecksum = checkpointChecksum(chunks.data(), chunks.size() * sizeof(CheckpointChunk));
+
+    ok = ok && writeAll(fd, &header, sizeof(header), 0);
+    ok = ok && writeAll(fd, &checkpointer->state, sizeof(CheckpointState), sizeof(CheckpointHeader));
+    ok = ok && writeAll(fd, chunks.data(), chunks.size() * sizeof(CheckpointChunk), sizeof(CheckpointHeader) + sizeof(CheckpointState));
+    ok = ok && fsync(fd) == 0;
+    ok = close(fd) == 0 && ok;
+
+    ok = ok && rename(checkpointer->tempPath.c_str(), checkpointer->path.c_str()) == 0;
+    ok = ok && syncDirectory(checkpointer->directory);
+
+    if (!ok)
+    {
+        printf("checkpoint: writing %s failed: %s\n", checkpointer->path.c_str(), strerror(errno));
+        unlink(checkpointer->tempPath.c_str());
+    }
+
+    *bytesWritten = offset;
+    return ok;
+}
+
+static void checkpointWriterThread(Checkpointer* checkpointer)
+{
+    std::unique_lock<std::mutex> lock(checkpointer->mutex);
+    while (true)
+    {
+        checkpointer->pending.wait(lock, [checkpointer] { return checkpointer->busy || checkpointer->quit; });
+        if (!checkpointer->busy) { return; }
+
+        lock.unlock();
+        auto start = std::chrono::high_resolution_clock::now();
+        uint64_t bytesWritten = 0;
+        bool ok = writeCheckpointFile(checkpointer, &bytesWritten);
+        double writeMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+        lock.lock();
+
+        if (ok) { checkpointer->stats.written++; checkpointer->stats.bytesWritten += bytesWritten; }
+        else { checkpointer->stats.failed++; }
+        checkpointer->stats.writeMs = writeMs;
+
+        checkpointer->busy = false;
+        checkpointer->idle.notify_all();
+    }
+}
+
+bool createCheckpointer(Checkpointer** checkpointer, CheckpointerCreateInfo* createInfo)
+{
+    if (!createInfo->path || !createInfo->path[0]) { return false; }
+
+    Checkpointer* newCheckpointer = new Checkpointer();
+    newCheckpointer->path = createInfo->path;
+    newCheckpointer->chunkMembers = createInfo->chunkMembers ? createInfo->chunkMembers : s_CheckpointDefaultChunkMembers;
+
+    // two runs checkpointing to the same path never write into one temporary file
+    char suffix[32];
+    snprintf(suffix, sizeof(suffix), ".%016llx.tmp", ((unsigned long long)std::random_device{}() << 32) | std::random_device{}());
+    newCheckpointer->tempPath = newCheckpointer->path + suffix;
+
+    size_t slash = newCheckpointer->path.find_last_of('/');
+    newCheckpointer->directory = slash == std::string::npos ? "." : (slash == 0 ? "/" : newCheckpointer->path.substr(0, slash));
+
+    newCheckpointer->writer = std::thread(checkpointWriterThread, newCheckpointer);
+
+    *checkpointer = newCheckpointer;
+    return true;
+}
+
+bool writeCheckpoint(Checkpointer* checkpointer, const CheckpointState* state, Ensemble* ensemble)
+{
+    {
+        std::lock_guard<std::mutex> lock(checkpointer->mutex);
+        if (checkpointer->busy)
+        {
+            checkpointer->stats.skipped++;
+            return false;
+        }
+    }
+
+    // the writer is idle, so the snapshot can be filled without holding the lock
+    auto start = std::chrono::high_resolution_clock::now();
+    checkpointer->state = *state;
+    checkpointer->memberCount = ensemble ? getEnsembleCount(ensemble) : 0;
+    checkpointer->members.resize((size_t)checkpointer->memberCount * ENSEMBLE_MEMBER_FLOATS);
+
+    for (uint32_t first = 0; first < checkpointer->memberCount; first += checkpointer->chunkMembers)
+    {
+        uint32_t members = std::min(checkpointer->chunkMembers, checkpointer->memberCount - first);
+        readEnsembleMembers(ensemble, first, members, checkpointer->members.data() + (size_t)first * ENSEMBLE_MEMBER_FLOATS);
+    }
+
+    double snapshotMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+    std::lock_guard<std::mutex> lock(checkpointer->mutex);
+    checkpointer->stats.snapshotMs = snapshotMs;
+    checkpointer->busy = true;
+    checkpointer->pending.notify_one();
+    return true;
+}
+
+bool finishCheckpointer(Checkpointer* checkpointer)
+{
+    std::unique_lock<std::mutex> lock(checkpointer->mutex);
+    checkpointer->idle.wait(lock, [checkpointer] { return !checkpointer->busy; });
+    return checkpointer->stats.failed == 0;
+}
+
+CheckpointerStats getCheckpointerStats(Checkpointer* checkpointer)
+{
+    std::lock_guard<std::mutex> lock(checkpointer->mutex);
+    return checkpointer->stats;
+}
+
+void destroyCheckpointer(Checkpointer* checkpointer)
+{
+    finishCheckpointer(checkpointer);
+
+    {
+        std::lock_guard<std::mutex> lock(checkpointer->mutex);
+        checkpointer->quit = true;
+        checkpointer->pending.notify_one();
+    }
+
+    checkpointer->writer.join();
+    delete checkpointer;
+}
+
+static bool readCheckpointFile(int fd, uint64_t fileSize, CheckpointState* state, Ensemble** ensemble, uint32_t threadCount)
+{
+    CheckpointHeader header;
+    if (fileSize < sizeof(CheckpointHeader) + sizeof(CheckpointState) || !readAll(fd, &header, sizeof(header), 0)) { return false; }
+
+    if (header.magic != CHECKPOINT_MAGIC || header.version != CHECKPOINT_VERSION || header.headerSize != sizeof(CheckpointHeader) ||
+        header.stateSize != sizeof(CheckpointState) || header.chunkEntrySize != sizeof(CheckpointChunk) ||
+        (header.memberCount > 0 && header.chunkMembers == 0) ||
+        header.chunkCount != (header.memberCount ? checkpointChunkCount(header.memberCount, header.chunkMembers) : 0))
+        return false;
+
+    // a checkpoint ends with its last chunk, anything else is not a file this wrote
+    uint64_t tableOffset = sizeof(CheckpointHeader) + sizeof(CheckpointState);
+    uint64_t memberSize = (uint64_t)header.memberCount * ENSEMBLE_MEMBER_FLOATS * sizeof(float);
+    if (tableOffset + (uint64_t)header.chunkCount * sizeof(CheckpointChunk) + memberSize != fileSize) { return false; }
+
+    CheckpointState newState;
+    std::vector<CheckpointChunk> chunks(header.chunkCount);
+    if (!readAll(fd, &newState, sizeof(newState), sizeof(CheckpointHeader)) ||
+        !readAll(fd, chunks.data(), chunks.size() * sizeof(CheckpointChunk), tableOffset) ||
+        checkpointChecksum(&newState, sizeof(newState)) != header.stateChecksum ||
+        checkpointChecksum(chunks.data(), chunks.size() * sizeof(CheckpointChunk)) != header.tableChecksum)
+        return false;
+
+    Ensemble* newEnsemble = nullptr;
+    if (header.memberCount > 0)
+    {
+        EnsembleCreateInfo ensembleCreateInfo{};
+        ensembleCreateInfo.count = header.memberCount;
+        ensembleCreateInfo.threadCount = threadCount;
+        if (!createEnsemble(&newEnsemble, &ensembleCreateInfo)) { return false; }
+    }
+
+    std::vector<float> members;
+    for (uint32_t i = 0; i < header.chunkCount; i++)
+    {
+        uint32_t first = i * header.chunkMembers;
+        uint32_t expected = std::min(header.chunkMembers, header.memberCount - first);
+        size_t size = (size_t)expected * ENSEMBLE_MEMBER_FLOATS * sizeof(float);
+
+        const CheckpointChunk& chunk = chunks[i];
+        members.resize((size_t)expected * ENSEMBLE_MEMBER_FLOATS);
+        if (chunk.members != expected || chunk.offset > fileSize || size > fileSize - chunk.offset ||
+            !readAll(fd, members.data(), size, chunk.offset) || checkpointChecksum(members.data(), size) != chunk.checksum)
+        {
+            destroyEnsemble(newEnsemble);
+            return false;
+        }
+
+        writeEnsembleMembers(newEnsemble, first, expected, members.data());
+    }
+
+    *state = newState;
+    *ensemble = newEnsemble;
+    return true;
+}
+
+bool readCheckpoint(const char* path, CheckpointState* state, Ensemble** ensemble, uint32_t threadCount)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) { return false; }
+
+    struct stat info;
+    bool ok = fstat(fd, &info) == 0 && readCheckpointFile(fd, (uint64_t)info.st_size, state, ensemble, threadCount);
+    close(fd);
+    return ok;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "ensemble.h"
+
+// versioned snapshots of the whole simulation, the pendulum state and parameters plus every ensemble member.
+// a checkpoint is copied out on the calling thread and written on a background thread to a temporary file
+// that is synced and renamed over the previous one, so the file on disk is always a complete checkpoint.
+// members are stored in chunks with their own checksum and written one chunk at a time, restoring reads
+// the exact bits back so a resumed run continues the same trajectory
+
+struct Checkpointer;
+
+enum CheckpointFlags
+{
+    Checkpoint_Flag_GravityOn = 1 << 0,
+    Checkpoint_Flag_Paused    = 1 << 1,
+};
+
+struct CheckpointState
+{
+    uint64_t step;      // simulated steps since the start of the run
+    double time;        // simulated seconds
+    uint64_t rngState;
+    uint32_t integrator; // TrajectoryIntegrator
+    uint32_t flags;      // CheckpointFlags
+    float dt;
+    float m1, m2;
+    float l1, l2;
+    float g;            // gravity constant, used while Checkpoint_Flag_GravityOn is set
+    float a1, a2;
+    float av1, av2;
+    float aa1, aa2;
+    float ensembleSpread;
+    uint32_t reserved;
+};
+
+struct CheckpointerCreateInfo
+{
+    const char* path;
+    uint32_t chunkMembers; // ensemble members per chunk, 0 picks a default
+};
+
+struct CheckpointerStats
+{
+    uint64_t written;
+    uint64_t skipped;   // requests made while the previous checkpoint was still being written
+    uint64_t failed;
+    uint64_t bytesWritten;
+    double snapshotMs;  // time spent copying on the calling thread, for the last checkpoint
+    double writeMs;     // time spent writing and syncing on the background thread, for the last checkpoint
+};
+
+bool createCheckpointer(Checkpointer** checkpointer, CheckpointerCreateInfo* createInfo);
+
+// ensemble may be null. returns false without copying anything if the previous checkpoint is still being written
+bool writeCheckpoint(Checkpointer* checkpointer, const CheckpointState* state, Ensemble* ensemble);
+
+// waits for the checkpoint being written, returns false if any write failed
+bool finishCheckpointer(Checkpointer* checkpointer);
+CheckpointerStats getCheckpointerStats(Checkpointer* checkpointer);
+void destroyCheckpointer(Checkpointer* checkpointer);
+
+// *ensemble is created with threadCount threads when the checkpoint has members and set to null otherwise
+bool readCheckpoint(const char* path, CheckpointState* state, Ensemble** ensemble, uint32_t threadCount);
@@ -0,0 +1,605 @@
+#include "codec.h"
+
+#include <stddef.h>
+#include <string.h>
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CODEC_SSE2
+#include <emmintrin.h>
+#endif
+
+#define CODEC_MAGIC   0x43545044 // "DPTC"
+#define CODEC_VERSION 2
+
+static const uint32_t s_CodecBlockFrames = 4096;
+static const uint32_t s_CodecGroupSize = 128;
+static const uint32_t s_CodecMaxGroups = s_CodecBlockFrames / s_CodecGroupSize;
+static const uint8_t s_CodecWideGroup = 64; // width of groups stored as plain 64-bit values
+static const uint32_t s_CodecPredictors = 3;
+
+// a channel whose block cannot be quantized, a nan or a value too large for the error bound, keeps its bit
+// patterns instead and says so in the high bit of its predictor byte
+static const uint8_t s_CodecLosslessChannel = 0x80;
+
+// below 2^52 steps a value times the inverse step still rounds to the nearest whole step
+static const double s_CodecMaxQuantized = 4503599627370496.0;
+
+enum CodecChannel
+{
+    Codec_Channel_Time,
+    Codec_Channel_A1,
+    Codec_Channel_A2,
+    Codec_Channel_Av1,
+    Codec_Channel_Av2,
+    Codec_Channel_Count,
+};
+
+struct CodecHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t frameCount;
+    uint32_t blockFrames;
+    uint32_t reserved;
+    double angleError;
+    double velocityError;
+    double anglePeriod;
+};
+
+struct CodecBlockHeader
+{
+    uint32_t frameCount;
+    uint32_t size; // bytes of channel data after this header
+};
+
+// integers and the transforms between them and the stored values
+
+static inline uint64_t zigzag(uint64_t value)
+{
+    return (value << 1) ^ (uint64_t)((int64_t)value >> 63);
+}
+
+static inline uint64_t unzigzag(uint64_t value)
+{
+    return (value >> 1) ^ (0 - (value & 1));
+}
+
+// bit patterns reordered so that larger floats are larger integers, neighbouring values then have small deltas
+static inline uint64_t orderDouble(double value)
+{
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return (bits >> 63) ? ~bits : bits | (1ull << 63);
+}
+
+static inline double unorderDouble(uint64_t bits)
+{
+    bits = (bits >> 63) ? bits & ~(1ull << 63) : ~bits;
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+static inline uint64_t orderFloat(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return (bits >> 31) ? ~bits : bits | (1u << 31);
+}
+
+static inline float unorderFloat(uint64_t ordered)
+{
+    uint32_t bits = (uint32_t)ordered;
+    bits = (bits >> 31) ? bits & ~(1u << 31) : ~bits;
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+static inline int64_t roundToInt(double value)
+{
+    return (int64_t)(value + (value >= 0.0 ? 0.5 : -0.5));
+}
+
+static inline double floorToDouble(double value)
+{
+    double truncated = (double)(int64_t)value;
+    return truncated > value ? truncated - 1.0 : truncated;
+}
+
+static inline uint32_t bitWidth(uint64_t value)
+{
+    uint32_t width = 0;
+    while (value) { width++; value >>= 1; }
+    return width;
+}
+
+// groups are packed lane interleaved, value i goes to lane i % 4, so decoding unpacks four values per step
+
+static void packGroup(const uint64_t* values, uint32_t width, uint8_t* out)
+{
+    for (uint32_t lane = 0; lane < 4; lane++)
+    {
+        uint64_t bits = 0;
+        uint32_t used = 0, word = 0;
+        for (uint32_t k = 0; k < s_CodecGroupSize / 4; k++)
+        {
+            bits |= values[k * 4 + lane] << used;
+            used += width;
+            if (used >= 32)
+            {
+                uint32_t packed = (uint32_t)bits;
+                memcpy(out + (word * 4 + lane) * 4, &packed, 4);
+                word++;
+                bits >>= 32;
+                used -= 32;
+            }
+        }
+    }
+}
+
+static void unpackGroup(const uint8_t* in, uint32_t width, uint32_t* out)
+{
+    if (width == 0)
+    {
+        memset(out, 0, s_CodecGroupSize * sizeof(uint32_t));
+        return;
+    }
+
+    uint32_t shift = 0;
+
+#ifdef CODEC_SSE2
+    const __m128i mask = _mm_set1_epi32(width == 32 ? -1 : (int)((1u << width) - 1));
+    const __m128i* words = (const __m128i*)in;
+    __m128i current = _mm_loadu_si128(words++);
+
+    for (uint32_t k = 0; k < s_CodecGroupSize / 4; k++)
+    {
+        __m128i value = _mm_srl_epi32(current, _mm_cvtsi32_si128(shift));
+        shift += width;
+        if (shift > 32)
+        {
+            current = _mm_loadu_si128(words++);
+            shift -= 32;
+            value = _mm_or_si128(value, _mm_sll_epi32(current, _mm_cvtsi32_si128(width - shift)));
+        }
+        else if (shift == 32 && k + 1 < s_CodecGroupSize / 4)
+        {
+            current = _mm_loadu_si128(words++);
+            shift = 0;
+        }
+
+        _mm_storeu_si128((__m128i*)(out + k * 4), _mm_and_si128(value, mask));
+    }
+#else
+    uint32_t mask = width == 32 ? 0xffffffffu : (1u << width) - 1;
+    uint32_t current[4], word = 1;
+    memcpy(current, in, sizeof(current));
+
+    for (uint32_t k = 0; k < s_CodecGroupSize / 4; k++)
+    {
+        uint32_t value[4];
+        for (uint32_t lane = 0; lane < 4; lane++)
+            value[lane] = shift < 32 ? current[lane] >> shift : 0;
+
+        shift += width;
+        if (shift > 32)
+        {
+            memcpy(current, in + word++ * 16, sizeof(current));
+            shift -= 32;
+            for (uint32_t lane = 0; lane < 4; lane++)
+                value[lane] |= current[lane] << (width - shift);
+        }
+        else if (shift == 32 && k + 1 < s_CodecGroupSize / 4)
+        {
+            memcpy(current, in + word++ * 16, sizeof(current));
+            shift = 0;
+        }
+
+        for (uint32_t lane = 0; lane < 4; lane++)
+            out[k * 4 + lane] = value[lane] & mask;
+    }
+#endif
+}
+
+static void widenGroup(const uint32_t* in, uint64_t* out)
+{
+#ifdef CODEC_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    for (uint32_t i = 0; i < s_CodecGroupSize; i += 4)
+    {
+        __m128i value = _mm_loadu_si128((const __m128i*)(in + i));
+        _mm_storeu_si128((__m128i*)(out + i), _mm_unpacklo_epi32(value, zero));
+        _mm_storeu_si128((__m128i*)(out + i + 2), _mm_unpackhi_epi32(value, zero));
+    }
+#else
+    for (uint32_t i = 0; i < s_CodecGroupSize; i++)
+        out[i] = in[i];
+#endif
+}
+
+// channels
+
+struct CodecChannelParams
+{
+    bool angle;
+    double step; // quantization step, 0 keeps the bit pattern
+    double period;
+};
+
+static CodecChannelParams getChannelParams(const TrajectoryCodecParams* params, uint32_t channel)
+{
+    CodecChannelParams channelParams{};
+    channelParams.angle = channel == Codec_Channel_A1 || channel == Codec_Channel_A2;
+    channelParams.period = params->anglePeriod;
+    if (channel != Codec_Channel_Time)
+        channelParams.step = 2.0 * (channelParams.angle ? params->angleError : params->velocityError);
+    return channelParams;
+}
+
+// channels are read and written in place with the frame size as stride
+static size_t getChannelOffset(uint32_t channel)
+{
+    switch (channel)
+    {
+    case Codec_Channel_A1:  { return offsetof(TrajectoryFrame, a1); }
+    case Codec_Channel_A2:  { return offsetof(TrajectoryFrame, a2); }
+    case Codec_Channel_Av1: { return offsetof(TrajectoryFrame, av1); }
+    case Codec_Channel_Av2: { return offsetof(TrajectoryFrame, av2); }
+    }
+
+    return offsetof(TrajectoryFrame, t);
+}
+
+static inline float channelValue(const TrajectoryFrame* frames, size_t offset, uint32_t k)
+{
+    return *(const float*)((const uint8_t*)&frames[k] + offset);
+}
+
+static inline float* channelField(TrajectoryFrame* frames, size_t offset, uint32_t k)
+{
+    return (float*)((uint8_t*)&frames[k] + offset);
+}
+
+// false when a value does not fit the quantization, the channel then has to be stored lossless
+static bool quantizeChannel(const TrajectoryFrame* frames, uint32_t count, uint32_t channel, const CodecChannelParams* params, uint64_t* q)
+{
+    if (channel == Codec_Channel_Time)
+    {
+        for (uint32_t k = 0; k < count; k++)
+            q[k] = orderDouble(frames[k].t);
+        return true;
+    }
+
+    size_t offset = getChannelOffset(channel);
+    if (params->step == 0.0)
+    {
+        for (uint32_t k = 0; k < count; k++)
+            q[k] = orderFloat(channelValue(frames, offset, k));
+        return true;
+    }
+
+    double invStep = 1.0 / params->step;
+    if (!params->angle)
+    {
+        for (uint32_t k = 0; k < count; k++)
+        {
+            double steps = channelValue(frames, offset, k) * invStep;
+            if (!(std::fabs(steps) <= s_CodecMaxQuantized)) { return false; }
+            q[k] = (uint64_t)roundToInt(steps);
+        }
+        return true;
+    }
+
+    // unwrapped angles only ever differ from the stored ones by whole periods, so a wrong guess on a jump
+    // of more than half a period costs bits but never accuracy
+    double period = params->period, half = params->period * 0.5;
+    double previous = channelValue(frames, offset, 0), unwrapped = previous;
+    for (uint32_t k = 0; k < count; k++)
+    {
+        double angle = channelValue(frames, offset, k);
+        double delta = angle - previous;
+        if (delta > half) { delta -= period; }
+        else if (delta < -half) { delta += period; }
+
+        unwrapped += delta;
+        previous = angle;
+
+        double steps = unwrapped * invStep;
+        if (!(std::fabs(steps) <= s_CodecMaxQuantized)) { return false; }
+        q[k] = (uint64_t)roundToInt(steps);
+    }
+
+    return true;
+}
+
+static void dequantizeChannel(const uint64_t* q, uint32_t count, uint32_t channel, const CodecChannelParams* params, TrajectoryFrame* frames)
+{
+    if (channel == Codec_Channel_Time)
+    {
+        for (uint32_t k = 0; k < count; k++)
+            frames[k].t = unorderDouble(q[k]);
+        return;
+    }
+
+    size_t offset = getChannelOffset(channel);
+    if (params->step == 0.0)
+    {
+        for (uint32_t k = 0; k < count; k++)
+            *channelField(frames, offset, k) = unorderFloat(q[k]);
+        return;
+    }
+
+    double step = params->step;
+    if (!params->angle)
+    {
+        for (uint32_t k = 0; k < count; k++)
+            *channelField(frames, offset, k) = (float)((int64_t)q[k] * step);
+        return;
+    }
+
+    double period = params->period, invPeriod = 1.0 / params->period;
+    float periodFloat = (float)period;
+    for (uint32_t k = 0; k < count; k++)
+    {
+        double unwrapped = (int64_t)q[k] * step;
+        float angle = (float)(unwrapped - period * floorToDouble(unwrapped * invPeriod));
+        *channelField(frames, offset, k) = angle >= periodFloat ? angle - periodFloat : angle;
+    }
+}
+
+static uint32_t groupBytes(uint32_t width)
+{
+    return width == s_CodecWideGroup ? s_CodecGroupSize * 8 : width * 16;
+}
+
+// the predictors extrapolate with a constant value, slope or curvature, so their residuals are the first,
+// second and third differences. the first order values of a block are stored as they are
+static void encodeChannel(const uint64_t* q, uint32_t count, bool lossless, std::vector<uint8_t>* out, uint64_t* residuals, TrajectoryCodecStats* stats)
+{
+    uint32_t groups = (count + s_CodecGroupSize - 1) / s_CodecGroupSize;
+
+    // the widths every predictor would need, gathered in one pass
+    uint64_t widths[s_CodecPredictors][s_CodecMaxGroups] = {};
+    uint64_t d1 = count > 1 ? q[1] - q[0] : 0, d2 = count > 2 ? q[2] - q[1] - d1 : 0;
+    if (count > 1) { widths[0][0] |= zigzag(d1); }
+    if (count > 2) { widths[0][0] |= zigzag(d2 + d1); widths[1][0] |= zigzag(d2); }
+    d1 += d2; // the differences ending at k = 2
+
+    for (uint32_t g = 0; g < groups; g++)
+    {
+        uint64_t width1 = 0, width2 = 0, width3 = 0;
+        uint32_t end = std::min(count, (g + 1) * s_CodecGroupSize);
+        for (uint32_t k = std::max(3u, g * s_CodecGroupSize); k < end; k++)
+        {
+            uint64_t n1 = q[k] - q[k - 1];
+            uint64_t n2 = n1 - d1;
+            uint64_t n3 = n2 - d2;
+            width1 |= zigzag(n1);
+            width2 |= zigzag(n2);
+            width3 |= zigzag(n3);
+            d1 = n1;
+            d2 = n2;
+        }
+
+        widths[0][g] |= width1;
+        widths[1][g] |= width2;
+        widths[2][g] |= width3;
+    }
+
+    uint32_t best = 1;
+    uint64_t bestBytes = UINT64_MAX;
+    for (uint32_t order = 1; order <= s_CodecPredictors; order++)
+    {
+        uint64_t bytes = order * sizeof(uint64_t);
+        for (uint32_t g = 0; g < groups; g++)
+        {
+            uint32_t width = bitWidth(widths[order - 1][g]);
+            bytes += groupBytes(width > 32 ? s_CodecWideGroup : width);
+        }
+
+        if (bytes < bestBytes) { bestBytes = bytes; best = order; }
+    }
+
+    uint32_t seeds = std::min(best, count);
+    std::fill(residuals, residuals + seeds, 0);
+    std::fill(residuals + count, residuals + groups * s_CodecGroupSize, 0);
+
+    if (best == 1)
+    {
+        for (uint32_t k = 1; k < count; k++)
+            residuals[k] = zigzag(q[k] - q[k - 1]);
+    }
+    else if (best == 2)
+    {
+        for (uint32_t k = 2; k < count; k++)
+            residuals[k] = zigzag(q[k] - 2 * q[k - 1] + q[k - 2]);
+    }
+    else
+    {
+        for (uint32_t k = 3; k < count; k++)
+            residuals[k] = zigzag(q[k] - 3 * q[k - 1] + 3 * q[k - 2] - q[k - 3]);
+    }
+
+    size_t start = out->size();
+    out->resize(start + 1 + seeds * sizeof(uint64_t) + groups + bestBytes - best * sizeof(uint64_t));
+    uint8_t* write = out->data() + start;
+
+    *write++ = (uint8_t)best | (lossless ? s_CodecLosslessChannel : 0);
+    memcpy(write, q, seeds * sizeof(uint64_t));
+    write += seeds * sizeof(uint64_t);
+    uint8_t* groupWidths = write;
+    write += groups;
+
+    for (uint32_t g = 0; g < groups; g++)
+    {
+        uint32_t width = bitWidth(widths[best - 1][g]);
+        if (width > 32) { width = s_CodecWideGroup; }
+        groupWidths[g] = (uint8_t)width;
+
+        const uint64_t* group = residuals + g * s_CodecGroupSize;
+        if (width == s_CodecWideGroup) { memcpy(write, group, s_CodecGroupSize * sizeof(uint64_t)); }
+        else { packGroup(group, width, write); }
+        write += groupBytes(width);
+
+        if (stats && width == s_CodecWideGroup) { stats->wideGroups++; }
+    }
+
+    if (stats) { stats->predictorUses[best - 1]++; }
+    if (stats && lossless) { stats->losslessChannels++; }
+}
+
+static const uint8_t* decodeChannel(const uint8_t* in, const uint8_t* end, uint32_t count, uint64_t* q, uint64_t* residuals, bool* lossless)
+{
+    uint32_t groups = (count + s_CodecGroupSize - 1) / s_CodecGroupSize;
+    if (end - in < 1) { return nullptr; }
+
+    *lossless = (in[0] & s_CodecLosslessChannel) != 0;
+    uint32_t order = in[0] & ~s_CodecLosslessChannel;
+    uint32_t seeds = std::min(order, count);
+    if (order < 1 || order > s_CodecPredictors || (size_t)(end - in) < 1 + seeds * sizeof(uint64_t) + groups) { return nullptr; }
+
+    memcpy(q, in + 1, seeds * sizeof(uint64_t));
+    const uint8_t* widths = in + 1 + seeds * sizeof(uint64_t);
+    in = widths + groups;
+
+    uint32_t unpacked[s_CodecGroupSize];
+    for (uint32_t g = 0; g < groups; g++)
+    {
+        uint32_t width = widths[g];
+        if ((width > 32 && width != s_CodecWideGroup) || (size_t)(end - in) < groupBytes(width)) { return nullptr; }
+
+        uint64_t* group = residuals + g * s_CodecGroupSize;
+        if (width == s_CodecWideGroup)
+        {
+            memcpy(group, in, s_CodecGroupSize * sizeof(uint64_t));
+        }
+        else
+        {
+            unpackGroup(in, width, unpacked);
+            widenGroup(unpacked, group);
+        }
+
+        in += groupBytes(width);
+    }
+
+    // undo the differences by summing them back up, once per predictor order
+    if (count <= seeds) { return in; }
+
+    uint64_t value = q[seeds - 1];
+    uint64_t d1 = seeds >= 2 ? q[seeds - 1] - q[seeds - 2] : 0;
+    uint64_t d2 = seeds >= 3 ? d1 - (q[seeds - 2] - q[seeds - 3]) : 0;
+
+    if (order == 1)
+    {
+        for (uint32_t k = seeds; k < count; k++)
+            q[k] = value += unzigzag(residuals[k]);
+    }
+    else if (order == 2)
+    {
+        for (uint32_t k = seeds; k < count; k++)
+            q[k] = value += d1 += unzigzag(residuals[k]);
+    }
+    else
+    {
+        for (uint32_t k = seeds; k < count; k++)
+            q[k] = value += d1 += d2 += unzigzag(residuals[k]);
+    }
+
+    return in;
+}
+
+bool encodeTrajectory(const TrajectoryFrame* frames, uint64_t count, const TrajectoryCodecParams* params, std::vector<uint8_t>* encoded, TrajectoryCodecStats* stats)
+{
+    if (params->angleError < 0.0 || params->velocityError < 0.0 || (params->angleError > 0.0 && params->anglePeriod <= 0.0)) { return false; }
+
+    CodecHeader header{};
+    header.magic = CODEC_MAGIC;
+    header.version = CODEC_VERSION;
+    header.frameCount = count;
+    header.blockFrames = s_CodecBlockFrames;
+    header.angleError = params->angleError;
+    header.velocityError = params->velocityError;
+    header.anglePeriod = params->anglePeriod;
+
+    encoded->resize(sizeof(header));
+    memcpy(encoded->data(), &header, sizeof(header));
+    if (stats) { *stats = {}; }
+
+    std::vector<uint64_t> q(s_CodecBlockFrames), residuals(s_CodecBlockFrames);
+    for (uint64_t first = 0; first < count; first += s_CodecBlockFrames)
+    {
+        uint32_t blockCount = (uint32_t)std::min<uint64_t>(count - first, s_CodecBlockFrames);
+
+        size_t blockStart = encoded->size();
+        encoded->resize(blockStart + sizeof(CodecBlockHeader));
+
+        for (uint32_t channel = 0; channel < Codec_Channel_Count; channel++)
+        {
+            CodecChannelParams channelParams = getChannelParams(params, channel);
+            bool lossless = !quantizeChannel(frames + first, blockCount, channel, &channelParams, q.data());
+            if (lossless)
+            {
+                channelParams.step = 0.0;
+                quantizeChannel(frames + first, blockCount, channel, &channelParams, q.data());
+            }
+
+            encodeChannel(q.data(), blockCount, lossless, encoded, residuals.data(), stats);
+        }
+
+        CodecBlockHeader blockHeader = { blockCount, (uint32_t)(encoded->size() - blockStart - sizeof(CodecBlockHeader)) };
+        memcpy(encoded->data() + blockStart, &blockHeader, sizeof(blockHeader));
+        if (stats) { stats->blocks++; }
+    }
+
+    return true;
+}
+
+bool decodeTrajectory(const uint8_t* encoded, size_t size, std::vector<TrajectoryFrame>* frames)
+{
+    CodecHeader header;
+    if (size < sizeof(header)) { return false; }
+    memcpy(&header, encoded, sizeof(header));
+
+    if (header.magic != CODEC_MAGIC || header.version != CODEC_VERSION || header.blockFrames != s_CodecBlockFrames) { return false; }
+
+    // every block has a header, so a frame count the data cannot hold is rejected before allocating for it
+    uint64_t blocks = (header.frameCount + s_CodecBlockFrames - 1) / s_CodecBlockFrames;
+    if (blocks > (size - sizeof(header)) / sizeof(CodecBlockHeader)) { return false; }
+
+    TrajectoryCodecParams params = { header.angleError, header.velocityError, header.anglePeriod };
+    frames->resize(header.frameCount);
+
+    std::vector<uint64_t> q(s_CodecBlockFrames), residuals(s_CodecBlockFrames);
+    const uint8_t* in = encoded + sizeof(header);
+    const uint8_t* end = encoded + size;
+
+    for (uint64_t first = 0; first < header.frameCount; first += s_CodecBlockFrames)
+    {
+        CodecBlockHeader blockHeader;
+        if ((size_t)(end - in) < sizeof(blockHeader)) { return false; }
+        memcpy(&blockHeader, in, sizeof(blockHeader));
+        in += sizeof(blockHeader);
+
+        uint32_t blockCount = (uint32_t)std::min<uint64_t>(header.frameCount - first, s_CodecBlockFrames);
+        if (blockHeader.frameCount != blockCount || (size_t)(end - in) < blockHeader.size) { return false; }
+
+        const uint8_t* blockEnd = in + blockHeader.size;
+        for (uint32_t channel = 0; channel < Codec_Channel_Count; channel++)
+        {
+            bool lossless;
+            in = decodeChannel(in, blockEnd, blockCount, q.data(), residuals.data(), &lossless);
+            if (!in) { return false; }
+
+            CodecChannelParams channelParams = getChannelParams(&params, channel);
+            if (lossless) { channelParams.step = 0.0; }
+            dequantizeChannel(q.data(), blockCount, channel, &channelParams, frames->data() + first);
+        }
+
+        if (in != blockEnd) { return false; }
+    }
+
+    return true;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <vector>
+
+#include "trajectory.h"
+
+// compressed trajectory streams. every channel is turned into integers (angles are unwrapped and quantized to
+// the error bound, time and lossless channels use their bit patterns), predicted from the previous steps and
+// the zig-zag coded residuals are bit packed in groups of 128 at the width of the largest one. blocks of
+// frames are independent, each channel of a block picks whichever predictor packs smallest. a channel that cannot
+// be quantized in a block is kept lossless there
+
+struct TrajectoryCodecParams
+{
+    double angleError;    // largest difference from the original angle, modulo anglePeriod. 0 is lossless
+    double velocityError; // same for angular velocities
+    double anglePeriod;   // angles are stored wrapped into [0, anglePeriod)
+};
+
+struct TrajectoryCodecStats
+{
+    uint64_t blocks;
+    uint64_t predictorUses[3];  // delta, linear, quadratic
+    uint64_t wideGroups;        // groups whose residuals did not fit in 32 bits
+    uint64_t losslessChannels;  // block channels kept as bit patterns, a nan, inf or value too large for the bound
+};
+
+bool encodeTrajectory(const TrajectoryFrame* frames, uint64_t count, const TrajectoryCodecParams* params, std::vector<uint8_t>* encoded, TrajectoryCodecStats* stats = nullptr);
+bool decodeTrajectory(const uint8_t* encoded, size_t size, std::vector<TrajectoryFrame>* frames);
@@ -0,0 +1,664 @@
+#include "encoder.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ENCODER_SSE2
+#include <emmintrin.h>
+#endif
+
+struct EncoderJob
+{
+    uint64_t index;
+    uint64_t sequence; // submission order, stream formats are written in this order
+    std::vector<uint8_t> pixels;
+};
+
+struct Encoder
+{
+    EncoderFormat format;
+    std::string path;
+    uint32_t width, height, fps;
+    uint32_t maxQueuedFrames;
+    bool pngCompress;
+    FILE* stream; // raw and y4m, sequences open a file per frame
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable jobReady;
+    std::condition_variable slotFree;
+    std::deque<EncoderJob> jobs;
+    std::vector<std::vector<uint8_t>> freeBuffers;
+    std::map<uint64_t, std::vector<uint8_t>> completed; // encoded stream frames waiting for their turn
+    uint64_t nextStreamIndex;
+    uint32_t inFlight;
+    bool stopping;
+    bool finished;
+
+    // held while stream frames are written so only one worker drains completed at a time
+    std::mutex outputMutex;
+
+    EncoderStats stats;
+};
+
+static bool isStreamFormat(EncoderFormat format)
+{
+    return format == Encoder_Format_Raw || format == Encoder_Format_Y4m;
+}
+
+// ---------------------------------------------------------------- y4m
+
+// bt.601 limited range in 8.8 fixed point, the simd path computes exactly the same integers
+static inline uint8_t rgbToY(int r, int g, int b) { return (uint8_t)(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16); }
+static inline uint8_t rgbToU(int r, int g, int b) { return (uint8_t)(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128); }
+static inline uint8_t rgbToV(int r, int g, int b) { return (uint8_t)(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128); }
+
+// converts two rgba rows into two luma rows and one row of 2x2 averaged chroma
+static void convertRowPairScalar(const uint8_t* row0, const uint8_t* row1, uint32_t begin, uint32_t width, uint8_t* y0, uint8_t* y1, uint8_t* u, uint8_t* v)
+{
+    for (uint32_t x = begin; x < width; x++)
+    {
+        const uint8_t* p0 = row0 + x * 4;
+        const uint8_t* p1 = row1 + x * 4;
+        y0[x] = rgbToY(p0[0], p0[1], p0[2]);
+        if (y1) { y1[x] = rgbToY(p1[0], p1[1], p1[2]); }
+    }
+
+    for (uint32_t x = begin; x < width; x += 2)
+    {
+        // an odd last column pairs with itself
+        uint32_t x1 = x + 1 < width ? x + 1 : x;
+        const uint8_t* a = row0 + x * 4;
+        const uint8_t* b = row0 + x1 * 4;
+        const uint8_t* c = row1 + x * 4;
+        const uint8_t* d = row1 + x1 * 4;
+
+        int r = (a[0] + b[0] + c[0] + d[0] + 2) >> 2;
+        int g = (a[1] + b[1] + c[1] + d[1] + 2) >> 2;
+        int bl = (a[2] + b[2] + c[2] + d[2] + 2) >> 2;
+        u[x / 2] = rgbToU(r, g, bl);
+        v[x / 2] = rgbToV(r, g, bl);
+    }
+}
+
+#ifdef ENCODER_SSE2
+// splits 8 rgba pixels into 16-bit r, g and b lanes
+static inline void unpackRgb(const uint8_t* pixels, __m128i* r, __m128i* g, __m128i* b)
+{
+    const __m128i mask = _mm_set1_epi32(0xff);
+    __m128i lo = _mm_loadu_si128((const __m128i*)pixels);
+    __m128i hi = _mm_loadu_si128((const __m128i*)(pixels + 16));
+
+    *r = _mm_packs_epi32(_mm_and_si128(lo, mask), _mm_and_si128(hi, mask));
+    *g = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(lo, 8), mask), _mm_and_si128(_mm_srli_epi32(hi, 8), mask));
+    *b = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(lo, 16), mask), _mm_and_si128(_mm_srli_epi32(hi, 16), mask));
+}
+
+// the weighted sum stays below 2^16, so wrapping 16-bit math and a logical shift give the exact result
+static inline __m128i lumaSimd(__m128i r, __m128i g, __m128i b)
+{
+    __m128i sum = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(r, _mm_set1_epi16(66)), _mm_mullo_epi16(g, _mm_set1_epi16(129))), _mm_mullo_epi16(b, _mm_set1_epi16(25)));
+    sum = _mm_srli_epi16(_mm_add_epi16(sum, _mm_set1_epi16(128)), 8);
+    return _mm_add_epi16(sum, _mm_set1_epi16(16));
+}
+
+// chroma sums lie within +-28560, signed 16-bit with an arithmetic shift matches the scalar code
+static inline __m128i chromaSimd(__m128i r, __m128i g, __m128i b, short wr, short wg, short wb)
+{
+    __m128i sum = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(r, _mm_set1_epi16(wr)), _mm_mullo_epi16(g, _mm_set1_epi16(wg))), _mm_mullo_epi16(b, _mm_set1_epi16(wb)));
+    sum = _mm_srai_epi16(_mm_add_epi16(sum, _mm_set1_epi16(128)), 8);
+    return _mm_add_epi16(sum, _mm_set1_epi16(128));
+}
+
+// sums horizontal pixel pairs of two rows, 8 pixels per row in, 4 sums out as 32-bit lanes
+static inline __m128i pairSum(__m128i top, __m128i bottom)
+{
+    return _mm_madd_epi16(_mm_add_epi16(top, bottom), _mm_set1_epi16(1));
+}
+
+static void convertRowPair(const uint8_t* row0, const uint8_t* row1, uint32_t width, uint8_t* y0, uint8_t* y1, uint8_t* u, uint8_t* v)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i two = _mm_set1_epi32(2);
+    uint32_t x = 0;
+
+    // 16 pixels per step, giving 16 luma samples per row and 8 chroma samples
+    for (; x + 16 <= width; x += 16)
+    {
+        __m128i r0a, g0a, b0a, r0b, g0b, b0b, r1a, g1a, b1a, r1b, g1b, b1b;
+        unpackRgb(row0 + x * 4, &r0a, &g0a, &b0a);
+        unpackRgb(row0 + x * 4 + 32, &r0b, &g0b, &b0b);
+        unpackRgb(row1 + x * 4, &r1a, &g1a, &b1a);
+        unpackRgb(row1 + x * 4 + 32, &r1b, &g1b, &b1b);
+
+        _mm_storeu_si128((__m128i*)(y0 + x), _mm_packus_epi16(lumaSimd(r0a, g0a, b0a), lumaSimd(r0b, g0b, b0b)));
+        if (y1) { _mm_storeu_si128((__m128i*)(y1 + x), _mm_packus_epi16(lumaSimd(r1a, g1a, b1a), lumaSimd(r1b, g1b, b1b))); }
+
+        __m128i r = _mm_packs_epi32(_mm_srli_epi32(_mm_add_epi32(pairSum(r0a, r1a), two), 2), _mm_srli_epi32(_mm_add_epi32(pairSum(r0b, r1b), two), 2));
+        __m128i g = _mm_packs_epi32(_mm_srli_epi32(_mm_add_epi32(pairSum(g0a, g1a), two), 2), _mm_srli_epi32(_mm_add_epi32(pairSum(g0b, g1b), two), 2));
+        __m128i b = _mm_packs_epi32(_mm_srli_epi32(_mm_add_epi32(pairSum(b0a, b1a), two), 2), _mm_srli_epi32(_mm_add_epi32(pairSum(b0b, b1b), two), 2));
+
+        _mm_storel_epi64((__m128i*)(u + x / 2), _mm_packus_epi16(chromaSimd(r, g, b, -38, -74, 112), zero));
+        _mm_storel_epi64((__m128i*)(v + x / 2), _mm_packus_epi16(chromaSimd(r, g, b, 112, -94, -18), zero));
+    }
+
+    convertRowPairScalar(row0, row1, x, width, y0, y1, u, v);
+}
+#else
+static void convertRowPair(const uint8_t* row0, const uint8_t* row1, uint32_t width, uint8_t* y0, uint8_t* y1, uint8_t* u, uint8_t* v)
+{
+    convertRowPairScalar(row0, row1, 0, width, y0, y1, u, v);
+}
+#endif
+
+static void encodeY4mFrame(const CaptureFrame* frame, std::vector<uint8_t>* out)
+{
+    uint32_t width = frame->width, height = frame->height;
+    uint32_t chromaWidth = (width + 1) / 2, chromaHeight = (height + 1) / 2;
+    uint32_t stride = width * 4;
+
+    static const char s_FrameHeader[] = "FRAME\n";
+    size_t headerSize = sizeof(s_FrameHeader) - 1;
+    out->resize(headerSize + width * height + 2 * chromaWidth * chromaHeight);
+    memcpy(out->data(), s_FrameHeader, headerSize);
+
+    uint8_t* yPlane = out->data() + headerSize;
+    uint8_t* uPlane = yPlane + width * height;
+    uint8_t* vPlane = uPlane + chromaWidth * chromaHeight;
+
+    // gl rows are bottom up, y4m is top down
+    for (uint32_t y = 0; y < height; y += 2)
+    {
+        const uint8_t* row0 = frame->pixels.data() + (height - 1 - y) * stride;
+        bool hasRow1 = y + 1 < height;
+        const uint8_t* row1 = hasRow1 ? row0 - stride : row0;
+
+        convertRowPair(row0, row1, width, yPlane + y * width, hasRow1 ? yPlane + (y + 1) * width : nullptr, uPlane + (y / 2) * chromaWidth, vPlane + (y / 2) * chromaWidth);
+    }
+}
+
+// ---------------------------------------------------------------- ppm, raw
+
+static void encodePpmFrame(const CaptureFrame* frame, std::vector<uint8_t>* out)
+{
+    char header[64];
+    int headerSize = snprintf(header, sizeof(header), "P6\n%u %u\n255\n", frame->width, frame->height);
+
+    out->resize(headerSize + frame->width * frame->height * 3);
+    memcpy(out->data(), header, headerSize);
+
+    uint8_t* dst = out->data() + headerSize;
+    for (uint32_t y = 0; y < frame->height; y++)
+    {
+        const uint8_t* src = frame->pixels.data() + (frame->height - 1 - y) * frame->width * 4;
+        for (uint32_t x = 0; x < frame->width; x++, src += 4, dst += 3)
+        {
+            dst[0] = src[0];
+            dst[1] = src[1];
+            dst[2] = src[2];
+        }
+    }
+}
+
+static void encodeRawFrame(const CaptureFrame* frame, std::vector<uint8_t>* out)
+{
+    uint32_t stride = frame->width * 4;
+    out->resize(stride * frame->height);
+
+    for (uint32_t y = 0; y < frame->height; y++)
+        memcpy(out->data() + y * stride, frame->pixels.data() + (frame->height - 1 - y) * stride, stride);
+}
+
+// ---------------------------------------------------------------- png
+
+static uint32_t s_CrcTable[256];
+static std::once_flag s_CrcTableOnce;
+
+static void buildCrcTable()
+{
+    for (uint32_t n = 0; n < 256; n++)
+    {
+        uint32_t c = n;
+        for (int k = 0; k < 8; k++)
+            c = c & 1 ? 0xedb88320u ^ (c >> 1) : c >> 1;
+        s_CrcTable[n] = c;
+    }
+}
+
+static uint32_t crc32(const uint8_t* data, size_t size, uint32_t crc = 0)
+{
+    crc = ~crc;
+    for (size_t i = 0; i < size; i++)
+        crc = s_CrcTable[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    return ~crc;
+}
+
+static uint32_t adler32(const uint8_t* data, size_t size)
+{
+    uint32_t a = 1, b = 0;
+    while (size > 0)
+    {
+        // 5552 is the most bytes that can be summed before b overflows 32 bits
+        size_t block = size < 5552 ? size : 5552;
+        for (size_t i = 0; i < block; i++)
+        {
+            a += data[i];
+            b += a;
+        }
+        a %= 65521;
+        b %= 65521;
+        data += block;
+        size -= block;
+    }
+    return (b << 16) | a;
+}
+
+static void putBigEndian(std::vector<uint8_t>* out, uint32_t value)
+{
+    out->push_back((uint8_t)(value >> 24));
+    out->push_back((uint8_t)(value >> 16));
+    out->push_back((uint8_t)(value >> 8));
+    out->push_back((uint8_t)value);
+}
+
+static void putPngChunk(std::vector<uint8_t>* out, const char* type, const uint8_t* data, size_t size)
+{
+    putBigEndian(out, (uint32_t)size);
+    size_t start = out->size();
+    out->insert(out->end(), type, type + 4);
+    out->insert(out->end(), data, data + size);
+    putBigEndian(out, crc32(out->data() + start, out->size() - start));
+}
+
+struct DeflateBits
+{
+    std::vector<uint8_t>* out;
+    uint64_t bits;
+    uint32_t count;
+};
+
+static inline void putBits(DeflateBits* writer, uint32_t value, uint32_t count)
+{
+    writer->bits |= (uint64_t)value << writer->count;
+    writer->count += count;
+    while (writer->count >= 8)
+    {
+        writer->out->push_back((uint8_t)writer->bits);
+        writer->bits >>= 8;
+        writer->count -= 8;
+    }
+}
+
+// huffman codes are sent most significant bit first
+static inline void putHuffman(DeflateBits* writer, uint32_t code, uint32_t length)
+{
+    uint32_t reversed = 0;
+    for (uint32_t i = 0; i < length; i++)
+        reversed |= ((code >> i) & 1) << (length - 1 - i);
+    putBits(writer, reversed, length);
+}
+
+static inline void putFixedLiteral(DeflateBits* writer, uint32_t symbol)
+{
+    if (symbol < 144)      { putHuffman(writer, 0x30 + symbol, 8); }
+    else if (symbol < 256) { putHuffman(writer, 0x190 + symbol - 144, 9); }
+    else if (symbol < 280) { putHuffman(writer, symbol - 256, 7); }
+    else                   { putHuffman(writer, 0xc0 + symbol - 280, 8); }
+}
+
+static const uint16_t s_LengthBase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+static const uint8_t s_LengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+static const uint16_t s_DistanceBase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+static const uint8_t s_DistanceExtra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+static void putFixedMatch(DeflateBits* writer, uint32_t length, uint32_t distance)
+{
+    uint32_t code = 28;
+    while (s_LengthBase[code] > length) { code--; }
+    putFixedLiteral(writer, 257 + code);
+    putBits(writer, length - s_LengthBase[code], s_LengthExtra[code]);
+
+    code = 29;
+    while (s_DistanceBase[code] > distance) { code--; }
+    putHuffman(writer, code, 5);
+    putBits(writer, distance - s_DistanceBase[code], s_DistanceExtra[code]);
+}
+
+// a single fixed huffman block with greedy lz77 over a one entry hash table, fast rather than small.
+// rendered frames are mostly flat background so even this finds long runs
+static void deflateFast(const uint8_t* data, size_t size, std::vector<uint8_t>* out)
+{
+    static const uint32_t s_HashBits = 15;
+    static const size_t s_Window = 32768;
+    static const uint32_t s_MaxMatch = 258;
+
+    std::vector<int64_t> table(1u << s_HashBits, -1);
+    DeflateBits writer = { out, 0, 0 };
+    putBits(&writer, 1, 1); // final block
+    putBits(&writer, 1, 2); // fixed huffman
+
+    size_t i = 0;
+    while (i < size)
+    {
+        uint32_t matchLength = 0;
+        size_t matchDistance = 0;
+
+        if (i + 4 <= size)
+        {
+            uint32_t key;
+            memcpy(&key, data + i, 4);
+            uint32_t hash = (key * 2654435761u) >> (32 - s_HashBits);
+            int64_t candidate = table[hash];
+            table[hash] = (int64_t)i;
+
+            if (candidate >= 0 && i - (size_t)candidate <= s_Window)
+            {
+                size_t limit = size - i < s_MaxMatch ? size - i : s_MaxMatch;
+                while (matchLength < limit && data[candidate + matchLength] == data[i + matchLength]) { matchLength++; }
+                matchDistance = i - (size_t)candidate;
+            }
+        }
+
+        if (matchLength >= 4)
+        {
+            putFixedMatch(&writer, matchLength, (uint32_t)matchDistance);
+            i += matchLength;
+        }
+        else
+        {
+            putFixedLiteral(&writer, data[i]);
+            i++;
+        }
+    }
+
+    putFixedLiteral(&writer, 256);
+    if (writer.count > 0) { putBits(&writer, 0, 8 - writer.count); }
+}
+
+static void deflateStored(const uint8_t* data, size_t size, std::vector<uint8_t>* out)
+{
+    // stored blocks hold at most 65535 bytes, an empty input still needs one final block
+    size_t offset = 0;
+    do
+    {
+        size_t block = size - offset < 65535 ? size - offset : 65535;
+        bool final = offset + block == size;
+
+        out->push_back(final ? 1 : 0);
+        out->push_back((uint8_t)block);
+        out->push_back((uint8_t)(block >> 8));
+        out->push_back((uint8_t)~block);
+        out->push_back((uint8_t)(~block >> 8));
+        out->insert(out->end(), data + offset, data + offset + block);
+        offset += block;
+    } while (offset < size);
+}
+
+static void encodePngFrame(const CaptureFrame* frame, bool compress, std::vector<uint8_t>* out)
+{
+    std::call_once(s_CrcTableOnce, buildCrcTable);
+
+    uint32_t width = frame->width, height = frame->height;
+
+    // rgb scanlines top down, each prefixed by its filter type. sub turns flat runs into zeros for deflate
+    uint32_t lineSize = 1 + width * 3;
+    std::vector<uint8_t> scanlines(lineSize * height);
+    for (uint32_t y = 0; y < height; y++)
+    {
+        const uint8_t* src = frame->pixels.data() + (height - 1 - y) * width * 4;
+        uint8_t* dst = scanlines.data() + y * lineSize;
+        dst[0] = compress ? 1 : 0;
+
+        for (uint32_t x = 0; x < width; x++)
+        {
+            for (uint32_t c = 0; c < 3; c++)
+            {
+                uint8_t left = compress && x > 0 ? src[(x - 1) * 4 + c] : 0;
+                dst[1 + x * 3 + c] = (uint8_t)(src[x * 4 + c] - left);
+            }
+        }
+    }
+
+    std::vector<uint8_t> zlib = { 0x78, 0x01 };
+    if (compress) { deflateFast(scanlines.data(), scanlines.size(), &zlib); }
+    else { deflateStored(scanlines.data(), scanlines.size(), &zlib); }
+    putBigEndian(&zlib, adler32(scanlines.data(), scanlines.size()));
+
+    // 8-bit truecolor, no interlace
+    uint8_t header[13] = {};
+    header[0] = (uint8_t)(width >> 24); header[1] = (uint8_t)(width >> 16); header[2] = (uint8_t)(width >> 8); header[3] = (uint8_t)width;
+    header[4] = (uint8_t)(height >> 24); header[5] = (uint8_t)(height >> 16); header[6] = (uint8_t)(height >> 8); header[7] = (uint8_t)height;
+    header[8] = 8;
+    header[9] = 2;
+
+    static const uint8_t s_PngSignature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+    out->assign(s_PngSignature, s_PngSignature + 8);
+    putPngChunk(out, "IHDR", header, sizeof(header));
+    putPngChunk(out, "IDAT", zlib.data(), zlib.size());
+    putPngChunk(out, "IEND", nullptr, 0);
+}
+
+// ---------------------------------------------------------------- workers
+
+static std::string getSequencePath(const std::string& path, uint64_t index)
+{
+    size_t dot = path.find_last_of('.');
+    size_t slash = path.find_last_of("/\\");
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) { dot = path.size(); }
+
+    char number[32];
+    snprintf(number, sizeof(number), "_%06llu", (unsigned long long)index);
+    return path.substr(0, dot) + number + path.substr(dot);
+}
+
+static void frameWritten(Encoder* encoder, size_t bytes, bool ok)
+{
+    std::lock_guard<std::mutex> lock(encoder->mutex);
+    encoder->stats.framesWritten++;
+    encoder->stats.bytesWritten += bytes;
+    // a short write leaves a stream unreadable from that frame on, so it is reported when it happens
+    if (!ok && !encoder->stats.failed) { printf("encoder: failed to write frame %llu to %s\n", (unsigned long long)encoder->stats.framesWritten - 1, encoder->path.c_str()); }
+    if (!ok) { encoder->stats.failed = true; }
+    encoder->inFlight--;
+    encoder->slotFree.notify_all();
+}
+
+static void writeStreamFrames(Encoder* encoder)
+{
+    std::lock_guard<std::mutex> outputLock(encoder->outputMutex);
+
+    while (true)
+    {
+        std::vector<uint8_t> bytes;
+        {
+            std::lock_guard<std::mutex> lock(encoder->mutex);
+            auto next = encoder->completed.find(encoder->nextStreamIndex);
+            if (next == encoder->completed.end()) { return; }
+
+            bytes = std::move(next->second);
+            encoder->completed.erase(next);
+        }
+
+        bool ok = fwrite(bytes.data(), 1, bytes.size(), encoder->stream) == bytes.size();
+        encoder->nextStreamIndex++;
+        frameWritten(encoder, bytes.size(), ok);
+    }
+}
+
+static void encoderWorker(Encoder* encoder)
+{
+    std::vector<uint8_t> encoded;
+
+    while (true)
+    {
+        EncoderJob job;
+        {
+            std::unique_lock<std::mutex> lock(encoder->mutex);
+            encoder->jobReady.wait(lock, [encoder] { return !encoder->jobs.empty() || encoder->stopping; });
+            if (encoder->jobs.empty()) { return; }
+
+            job = std::move(encoder->jobs.front());
+            encoder->jobs.pop_front();
+        }
+
+        CaptureFrame frame = { job.index, encoder->width, encoder->height, std::move(job.pixels) };
+        switch (encoder->format)
+        {
+            case Encoder_Format_Raw: encodeRawFrame(&frame, &encoded); break;
+            case Encoder_Format_Y4m: encodeY4mFrame(&frame, &encoded); break;
+            case Encoder_Format_Ppm: encodePpmFrame(&frame, &encoded); break;
+            case Encoder_Format_Png: encodePngFrame(&frame, encoder->pngCompress, &encoded); break;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(encoder->mutex);
+            encoder->freeBuffers.push_back(std::move(frame.pixels));
+        }
+
+        if (isStreamFormat(encoder->format))
+        {
+            {
+                std::lock_guard<std::mutex> lock(encoder->mutex);
+                encoder->completed[job.sequence] = std::move(encoded);
+            }
+            encoded.clear();
+            writeStreamFrames(encoder);
+        }
+        else
+        {
+            FILE* file = fopen(getSequencePath(encoder->path, job.index).c_str(), "wb");
+            bool ok = file && fwrite(encoded.data(), 1, encoded.size(), file) == encoded.size();
+            if (file) { ok = fclose(file) == 0 && ok; }
+            frameWritten(encoder, encoded.size(), ok);
+        }
+    }
+}
+
+// ---------------------------------------------------------------- api
+
+bool encoderFormatFromPath(const char* path, EncoderFormat* format)
+{
+    std::string str = path;
+    size_t dot = str.find_last_of('.');
+    if (dot == std::string::npos) { return false; }
+
+    std::string extension = str.substr(dot + 1);
+    if (extension == "rgba")     { *format = Encoder_Format_Raw; }
+    else if (extension == "y4m") { *format = Encoder_Format_Y4m; }
+    else if (extension == "ppm") { *format = Encoder_Format_Ppm; }
+    else if (extension == "png") { *format = Encoder_Format_Png; }
+    else { return false; }
+
+    return true;
+}
+
+bool createEncoder(Encoder** encoder, EncoderCreateInfo* createInfo)
+{
+    Encoder* newEncoder = new Encoder();
+    newEncoder->format = createInfo->format;
+    newEncoder->path = createInfo->path;
+    newEncoder->width = createInfo->width;
+    newEncoder->height = createInfo->height;
+    newEncoder->fps = createInfo->fps ? createInfo->fps : 60;
+    newEncoder->maxQueuedFrames = createInfo->maxQueuedFrames ? createInfo->maxQueuedFrames : 1;
+    newEncoder->pngCompress = createInfo->pngCompress;
+
+    if (isStreamFormat(newEncoder->format))
+    {
+        newEncoder->stream = fopen(createInfo->path, "wb");
+        if (!newEncoder->stream)
+        {
+            delete newEncoder;
+            return false;
+        }
+
+        if (newEncoder->format == Encoder_Format_Y4m &&
+            fprintf(newEncoder->stream, "YUV4MPEG2 W%u H%u F%u:1 Ip A1:1 C420jpeg\n", newEncoder->width, newEncoder->height, newEncoder->fps) < 0)
+        {
+            fclose(newEncoder->stream);
+            delete newEncoder;
+            return false;
+        }
+    }
+
+    uint32_t threadCount = createInfo->threadCount ? createInfo->threadCount : 1;
+    for (uint32_t i = 0; i < threadCount; i++)
+        newEncoder->workers.emplace_back(encoderWorker, newEncoder);
+
+    *encoder = newEncoder;
+    return true;
+}
+
+void submitEncoderFrame(Encoder* encoder, const CaptureFrame* frame)
+{
+    std::unique_lock<std::mutex> lock(encoder->mutex);
+
+    if (encoder->inFlight >= encoder->maxQueuedFrames)
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+        encoder->slotFree.wait(lock, [encoder] { return encoder->inFlight < encoder->maxQueuedFrames; });
+
+        encoder->stats.submitWaits++;
+        encoder->stats.submitWaitMs += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    }
+
+    EncoderJob job;
+    job.index = frame->index;
+    job.sequence = encoder->stats.framesSubmitted;
+    if (!encoder->freeBuffers.empty())
+    {
+        job.pixels = std::move(encoder->freeBuffers.back());
+        encoder->freeBuffers.pop_back();
+    }
+
+    encoder->inFlight++;
+    encoder->stats.framesSubmitted++;
+    if (encoder->inFlight > encoder->stats.peakQueuedFrames) { encoder->stats.peakQueuedFrames = encoder->inFlight; }
+
+    // the copy happens outside the lock so workers can keep taking jobs
+    lock.unlock();
+    job.pixels.assign(frame->pixels.begin(), frame->pixels.end());
+    lock.lock();
+
+    encoder->jobs.push_back(std::move(job));
+    encoder->jobReady.notify_one();
+}
+
+void finishEncoder(Encoder* encoder)
+{
+    if (encoder->finished) { return; }
+
+    {
+        std::lock_guard<std::mutex> lock(encoder->mutex);
+        encoder->stopping = true;
+    }
+    encoder->jobReady.notify_all();
+
+    for (std::thread& worker : encoder->workers)
+        worker.join();
+
+    if (encoder->stream && fclose(encoder->stream) != 0) { encoder->stats.failed = true; }
+    encoder->stream = nullptr;
+    encoder->finished = true;
+}
+
+void destroyEncoder(Encoder* encoder)
+{
+    finishEncoder(encoder);
+    delete encoder;
+}
+
+EncoderStats getEncoderStats(Encoder* encoder)
+{
+    std::lock_guard<std::mutex> lock(encoder->mutex);
+    return encoder->stats;
+}
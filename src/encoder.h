@@ -0,0 +1,47 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "capture.h"
+
+// captured frames are encoded on a pool of worker threads. stream formats are written in frame order
+// and every frame is encoded independently, so the output is the same for any thread count
+
+struct Encoder;
+
+enum EncoderFormat
+{
+    Encoder_Format_Raw, // rgba8 frames back to back in one file
+    Encoder_Format_Y4m, // yuv4mpeg2 4:2:0 in one file
+    Encoder_Format_Ppm, // one binary ppm per frame
+    Encoder_Format_Png, // one png per frame
+};
+
+struct EncoderCreateInfo
+{
+    EncoderFormat format;
+    const char* path;         // sequences insert the frame number before the extension, frame.png -> frame_000000.png
+    uint32_t width, height;
+    uint32_t fps;
+    uint32_t threadCount;
+    uint32_t maxQueuedFrames; // frames submitted but not yet written before submitEncoderFrame blocks
+    bool pngCompress;         // fast deflate, otherwise stored blocks
+};
+
+struct EncoderStats
+{
+    uint64_t framesSubmitted;
+    uint64_t framesWritten;
+    uint64_t bytesWritten;
+    uint64_t submitWaits; // submissions that blocked because the queue was full
+    double submitWaitMs;
+    uint32_t peakQueuedFrames;
+    bool failed;
+};
+
+bool encoderFormatFromPath(const char* path, EncoderFormat* format);
+bool createEncoder(Encoder** encoder, EncoderCreateInfo* createInfo);
+void submitEncoderFrame(Encoder* encoder, const CaptureFrame* frame);
+void finishEncoder(Encoder* encoder);
+void destroyEncoder(Encoder* encoder);
+EncoderStats getEncoderStats(Encoder* encoder);
@@ -0,0 +1,337 @@
+#include "ensemble.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include "parallel.h"
+#include "physics.h"
+
+// below this many members a step stays on the calling thread
+static const uint32_t s_EnsembleParallelStep = 4096;
+
+// each member's shadow starts this far from it in the second angle and is pulled back every interval steps
+static const float s_LyapunovSeparation = 1.0e-4f;
+static const uint32_t s_LyapunovInterval = 10;
+
+struct Ensemble
+{
+    uint32_t count;
+    uint32_t threadCount;
+
+    std::vector<float> a1, a2;
+    std::vector<float> av1, av2;
+    std::vector<float> initialOffset;
+
+    std::vector<OglsVec2> positions;
+    bool positionsValid;
+    float positionsL1, positionsL2;
+
+    // restarted by a reset, new members or a step with other parameters
+    bool summariesTracked, summariesStarted;
+    std::vector<float> summaries[Ensemble_Summary_Count];
+    std::vector<float> shadowA1, shadowA2, shadowAv1, shadowAv2;
+    std::vector<float> initialEnergy, lyapunovSum;
+    EnsembleParams summaryParams;
+    float summaryDt;
+    uint64_t summarySteps;
+};
+
+static uint32_t ensembleThreads(Ensemble* ensemble)
+{
+    return ensemble->count < s_EnsembleParallelStep ? 1 : ensemble->threadCount;
+}
+
+// difference of two wrapped angles, the short way around
+static float angleDifference(float x, float y)
+{
+    float d = x - y;
+    if (d > PENDULUM_PI) { d -= 2 * PENDULUM_PI; }
+    if (d < -PENDULUM_PI) { d += 2 * PENDULUM_PI; }
+    return d;
+}
+
+// the angles are left unwrapped
+static void integrateMember(const EnsembleParams& p, float dt, float& a1, float& a2, float& av1, float& av2)
+{
+    float aa1, aa2;
+    stepPendulum(p.m1, p.m2, p.l1, p.l2, p.g, dt, a1, a2, av1, av2, aa1, aa2);
+}
+
+// kinetic plus potential energy with the pivot at height zero
+static float memberEnergy(const EnsembleParams& p, float a1, float a2, float av1, float av2)
+{
+    float v1 = p.l1 * p.l1 * av1 * av1;
+    float v2 = v1 + p.l2 * p.l2 * av2 * av2 + 2.0f * p.l1 * p.l2 * av1 * av2 * std::cos(a1 - a2);
+    float y1 = -p.l1 * std::cos(a1);
+    float y2 = y1 - p.l2 * std::cos(a2);
+    return 0.5f * (p.m1 * v1 + p.m2 * v2) + p.g * (p.m1 * y1 + p.m2 * y2);
+}
+
+// energy errors are relative to the energy it takes to lift both bobs to the pivot, which is never near zero
+// the way the total energy of a member can be
+static float energyScale(const EnsembleParams& p)
+{
+    return std::max(p.g * (p.m1 * p.l1 + p.m2 * (p.l1 + p.l2)), 1.0e-30f);
+}
+
+static void startSummaries(Ensemble* ensemble, const EnsembleParams* params, float dt)
+{
+    EnsembleParams p = *params;
+    parallelFor(ensembleThreads(ensemble), ensemble->count, [ensemble, p](uint32_t, uint32_t begin, uint32_t end)
+    {
+        for (uint32_t i = begin; i < end; i++)
+        {
+            float a1 = ensemble->a1[i], a2 = ensemble->a2[i], av1 = ensemble->av1[i], av2 = ensemble->av2[i];
+            ensemble->summaries[Ensemble_Summary_A1][i] = a1;
+            ensemble->summaries[Ensemble_Summary_A2][i] = a2;
+            ensemble->summaries[Ensemble_Summary_Av1][i] = av1;
+            ensemble->summaries[Ensemble_Summary_Av2][i] = av2;
+            ensemble->summaries[Ensemble_Summary_FlipTime][i] = -1.0f;
+            ensemble->summaries[Ensemble_Summary_EnergyError][i] = 0.0f;
+            ensemble->summaries[Ensemble_Summary_Lyapunov][i] = 0.0f;
+
+            ensemble->shadowA1[i] = a1;
+            ensemble->shadowA2[i] = wrapAngle(a2 + s_LyapunovSeparation);
+            ensemble->shadowAv1[i] = av1;
+            ensemble->shadowAv2[i] = av2;
+            ensemble->initialEnergy[i] = memberEnergy(p, a1, a2, av1, av2);
+            ensemble->lyapunovSum[i] = 0.0f;
+        }
+    });
+
+    ensemble->summariesStarted = true;
+    ensemble->summaryParams = *params;
+    ensemble->summaryDt = dt;
+    ensemble->summarySteps = 0;
+}
+
+// flips, energy drift and the shadow member for one member that just stepped from old1, old2 to the state given
+static void trackMember(Ensemble* ensemble, const EnsembleParams& p, float dt, uint32_t i, float old1, float old2,
+    float a1, float a2, float av1, float av2, float time, float scale, bool renormalize)
+{
+    // the arms are upright at half a turn, wrapped angles only cross it by going over the top
+    float top = PENDULUM_PI;
+    bool flipped = (old1 < top) != (a1 < top) || (old2 < top) != (a2 < top);
+    float& flipTime = ensemble->summaries[Ensemble_Summary_FlipTime][i];
+    if (flipped && flipTime < 0.0f) { flipTime = time; }
+
+    a1 = wrapAngle(a1);
+    a2 = wrapAngle(a2);
+
+    float& energyError = ensemble->summaries[Ensemble_Summary_EnergyError][i];
+    energyError = std::max(energyError, std::fabs(memberEnergy(p, a1, a2, av1, av2) - ensemble->initialEnergy[i]) / scale);
+
+    float sa1 = ensemble->shadowA1[i], sa2 = ensemble->shadowA2[i], sav1 = ensemble->shadowAv1[i], sav2 = ensemble->shadowAv2[i];
+    integrateMember(p, dt, sa1, sa2, sav1, sav2);
+    sa1 = wrapAngle(sa1);
+    sa2 = wrapAngle(sa2);
+
+    if (renormalize)
+    {
+        // the growth since the last renormalization is logged and the shadow is pulled back along the same direction
+        float d1 = angleDifference(sa1, a1), d2 = angleDifference(sa2, a2), dv1 = sav1 - av1, dv2 = sav2 - av2;
+        float distance = std::sqrt(d1 * d1 + d2 * d2 + dv1 * dv1 + dv2 * dv2);
+        if (distance > 0.0f && std::isfinite(distance))
+        {
+            ensemble->lyapunovSum[i] += std::log(distance / s_LyapunovSeparation);
+            float shrink = s_LyapunovSeparation / distance;
+            sa1 = wrapAngle(a1 + d1 * shrink);
+            sa2 = wrapAngle(a2 + d2 * shrink);
+            sav1 = av1 + dv1 * shrink;
+            sav2 = av2 + dv2 * shrink;
+        }
+        else
+        {
+            sa1 = a1;
+            sa2 = wrapAngle(a2 + s_LyapunovSeparation);
+            sav1 = av1;
+            sav2 = av2;
+        }
+    }
+
+    ensemble->shadowA1[i] = sa1;
+    ensemble->shadowA2[i] = sa2;
+    ensemble->shadowAv1[i] = sav1;
+    ensemble->shadowAv2[i] = sav2;
+}
+
+static void stepRange(Ensemble* ensemble, const EnsembleParams* params, float dt, uint32_t begin, uint32_t end)
+{
+    float* a1s = ensemble->a1.data();
+    float* a2s = ensemble->a2.data();
+    float* av1s = ensemble->av1.data();
+    float* av2s = ensemble->av2.data();
+
+    bool summaries = ensemble->summariesTracked;
+    uint64_t steps = ensemble->summarySteps + 1;
+    float time = (float)(steps * (double)dt);
+    float scale = energyScale(*params);
+    bool renormalize = steps % s_LyapunovInterval == 0;
+
+    for (uint32_t i = begin; i < end; i++)
+    {
+        float a1 = a1s[i], a2 = a2s[i], av1 = av1s[i], av2 = av2s[i];
+        integrateMember(*params, dt, a1, a2, av1, av2);
+
+        if (summaries) { trackMember(ensemble, *params, dt, i, a1s[i], a2s[i], a1, a2, av1, av2, time, scale, renormalize); }
+
+        a1s[i] = wrapAngle(a1);
+        a2s[i] = wrapAngle(a2);
+        av1s[i] = av1;
+        av2s[i] = av2;
+    }
+}
+
+bool createEnsemble(Ensemble** ensemble, EnsembleCreateInfo* createInfo)
+{
+    if (createInfo->count == 0) { return false; }
+
+    Ensemble* newEnsemble = new Ensemble();
+    newEnsemble->count = createInfo->count;
+    newEnsemble->threadCount = createInfo->threadCount ? createInfo->threadCount : 1;
+
+    newEnsemble->a1.resize(createInfo->count);
+    newEnsemble->a2.resize(createInfo->count);
+    newEnsemble->av1.resize(createInfo->count);
+    newEnsemble->av2.resize(createInfo->count);
+    newEnsemble->initialOffset.resize(createInfo->count);
+    newEnsemble->positions.resize(createInfo->count);
+
+    resetEnsemble(newEnsemble, createInfo->angles, createInfo->spread);
+
+    *ensemble = newEnsemble;
+    return true;
+}
+
+void resetEnsemble(Ensemble* ensemble, OglsVec2 angles, float spread)
+{
+    float step = ensemble->count > 1 ? spread / (ensemble->count - 1) : 0.0f;
+
+    for (uint32_t i = 0; i < ensemble->count; i++)
+    {
+        float offset = ensemble->count > 1 ? i * step - spread * 0.5f : 0.0f;
+        ensemble->a1[i] = angles.x;
+        ensemble->a2[i] = angles.y + offset;
+        ensemble->av1[i] = 0.0f;
+        ensemble->av2[i] = 0.0f;
+        ensemble->initialOffset[i] = offset;
+    }
+
+    ensemble->positionsValid = false;
+    ensemble->summariesStarted = false;
+}
+
+void stepEnsemble(Ensemble* ensemble, const EnsembleParams* params, float dt)
+{
+    if (ensemble->summariesTracked && (!ensemble->summariesStarted || dt != ensemble->summaryDt ||
+        memcmp(params, &ensemble->summaryParams, sizeof(EnsembleParams)) != 0))
+        startSummaries(ensemble, params, dt);
+
+    parallelFor(ensembleThreads(ensemble), ensemble->count, [ensemble, params, dt](uint32_t, uint32_t begin, uint32_t end)
+    {
+        stepRange(ensemble, params, dt, begin, end);
+    });
+
+    ensemble->positionsValid = false;
+    if (ensemble->summariesTracked) { ensemble->summarySteps++; }
+}
+
+const OglsVec2* getEnsemblePositions(Ensemble* ensemble, const EnsembleParams* params)
+{
+    if (ensemble->positionsValid && ensemble->positionsL1 == params->l1 && ensemble->positionsL2 == params->l2)
+        return ensemble->positions.data();
+
+    float l1 = params->l1, l2 = params->l2;
+    parallelFor(ensembleThreads(ensemble), ensemble->count, [ensemble, l1, l2](uint32_t, uint32_t begin, uint32_t end)
+    {
+        for (uint32_t i = begin; i < end; i++)
+        {
+            float a1 = ensemble->a1[i], a2 = ensemble->a2[i];
+            ensemble->positions[i].x = l1 * std::sin(a1) + l2 * std::sin(a2);
+            ensemble->positions[i].y = -l1 * std::cos(a1) - l2 * std::cos(a2);
+        }
+    });
+
+    ensemble->positionsValid = true;
+    ensemble->positionsL1 = l1;
+    ensemble->positionsL2 = l2;
+    return ensemble->positions.data();
+}
+
+void getEnsembleValues(Ensemble* ensemble, EnsembleValue value, const EnsembleParams* params, float* values)
+{
+    if (value == Ensemble_Value_InitialAngle)
+    {
+        std::copy(ensemble->initialOffset.begin(), ensemble->initialOffset.end(), values);
+        return;
+    }
+
+    EnsembleParams p = *params;
+    parallelFor(ensembleThreads(ensemble), ensemble->count, [ensemble, p, values](uint32_t, uint32_t begin, uint32_t end)
+    {
+        for (uint32_t i = begin; i < end; i++)
+            values[i] = memberEnergy(p, ensemble->a1[i], ensemble->a2[i], ensemble->av1[i], ensemble->av2[i]);
+    });
+}
+
+void readEnsembleMembers(Ensemble* ensemble, uint32_t first, uint32_t count, float* members)
+{
+    const std::vector<float>* arrays[ENSEMBLE_MEMBER_FLOATS] = { &ensemble->a1, &ensemble->a2, &ensemble->av1, &ensemble->av2, &ensemble->initialOffset };
+    for (uint32_t i = 0; i < ENSEMBLE_MEMBER_FLOATS; i++)
+        std::copy(arrays[i]->begin() + first, arrays[i]->begin() + first + count, members + (size_t)i * count);
+}
+
+void writeEnsembleMembers(Ensemble* ensemble, uint32_t first, uint32_t count, const float* members)
+{
+    std::vector<float>* arrays[ENSEMBLE_MEMBER_FLOATS] = { &ensemble->a1, &ensemble->a2, &ensemble->av1, &ensemble->av2, &ensemble->initialOffset };
+    for (uint32_t i = 0; i < ENSEMBLE_MEMBER_FLOATS; i++)
+        std::copy(members + (size_t)i * count, members + (size_t)(i + 1) * count, arrays[i]->begin() + first);
+
+    ensemble->positionsValid = false;
+    ensemble->summariesStarted = false;
+}
+
+void trackEnsembleSummaries(Ensemble* ensemble)
+{
+    if (ensemble->summariesTracked) { return; }
+
+    for (std::vector<float>& summary : ensemble->summaries)
+        summary.resize(ensemble->count);
+    for (std::vector<float>* values : { &ensemble->shadowA1, &ensemble->shadowA2, &ensemble->shadowAv1, &ensemble->shadowAv2, &ensemble->initialEnergy, &ensemble->lyapunovSum })
+        values->resize(ensemble->count);
+
+    ensemble->summariesTracked = true;
+    ensemble->summariesStarted = false;
+}
+
+bool getEnsembleSummaries(Ensemble* ensemble, const float** summaries, EnsembleSummaryInfo* info)
+{
+    if (!ensemble->summariesTracked || !ensemble->summariesStarted) { return false; }
+
+    // the exponent is the average growth over the steps up to the last renormalization
+    uint64_t measuredSteps = ensemble->summarySteps / s_LyapunovInterval * s_LyapunovInterval;
+    float measuredTime = (float)(measuredSteps * (double)ensemble->summaryDt);
+    float* lyapunov = ensemble->summaries[Ensemble_Summary_Lyapunov].data();
+    for (uint32_t i = 0; i < ensemble->count; i++)
+        lyapunov[i] = measuredSteps > 0 ? ensemble->lyapunovSum[i] / measuredTime : 0.0f;
+
+    for (uint32_t i = 0; i < Ensemble_Summary_Count; i++)
+        summaries[i] = ensemble->summaries[i].data();
+
+    info->params = ensemble->summaryParams;
+    info->dt = ensemble->summaryDt;
+    info->steps = ensemble->summarySteps;
+    return true;
+}
+
+uint32_t getEnsembleCount(Ensemble* ensemble)
+{
+    return ensemble->count;
+}
+
+void destroyEnsemble(Ensemble* ensemble)
+{
+    delete ensemble;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "ogls.h"
+
+// many independent double pendulums sharing one set of parameters, stored as structure of arrays and stepped
+// in parallel. members start fanned out around the same angles by a small offset of the second angle and step
+// with stepPendulum like the single pendulum in main.cpp, so a member with no offset follows it exactly
+
+struct Ensemble;
+
+enum EnsembleValue
+{
+    Ensemble_Value_InitialAngle, // offset of the second angle at the start
+    Ensemble_Value_Energy,       // total mechanical energy
+};
+
+struct EnsembleParams
+{
+    float m1, m2;
+    float l1, l2;
+    float g;
+};
+
+// per member results of a run, one array of getEnsembleCount floats each
+enum EnsembleSummary
+{
+    Ensemble_Summary_A1,          // initial conditions, radians and radians per second
+    Ensemble_Summary_A2,
+    Ensemble_Summary_Av1,
+    Ensemble_Summary_Av2,
+    Ensemble_Summary_FlipTime,    // seconds until either arm first went over the top, -1 if neither has
+    Ensemble_Summary_EnergyError, // largest energy drift so far, relative to lifting both bobs to the pivot
+    Ensemble_Summary_Lyapunov,    // largest lyapunov exponent estimated from a nearby shadow member, 1/s
+    Ensemble_Summary_Count,
+};
+
+struct EnsembleSummaryInfo
+{
+    EnsembleParams params;
+    float dt;
+    uint64_t steps; // since the summaries started
+};
+
+struct EnsembleCreateInfo
+{
+    uint32_t count;
+    OglsVec2 angles; // radians
+    float spread;    // second angles are spread evenly over [-spread, spread] / 2 around angles.y
+    uint32_t threadCount;
+};
+
+bool createEnsemble(Ensemble** ensemble, EnsembleCreateInfo* createInfo);
+void resetEnsemble(Ensemble* ensemble, OglsVec2 angles, float spread);
+void stepEnsemble(Ensemble* ensemble, const EnsembleParams* params, float dt);
+
+// second bob positions for the current state, updated by every step and reset
+const OglsVec2* getEnsemblePositions(Ensemble* ensemble, const EnsembleParams* params);
+
+// one value per member, written into values which holds at least getEnsembleCount floats
+void getEnsembleValues(Ensemble* ensemble, EnsembleValue value, const EnsembleParams* params, float* values);
+
+// members first to first + count as ENSEMBLE_MEMBER_FLOATS arrays of count floats each: a1, a2, av1, av2 and
+// the initial offset. reading and writing them back reproduces the ensemble exactly
+#define ENSEMBLE_MEMBER_FLOATS 5
+void readEnsembleMembers(Ensemble* ensemble, uint32_t first, uint32_t count, float* members);
+void writeEnsembleMembers(Ensemble* ensemble, uint32_t first, uint32_t count, const float* members);
+
+// summaries roughly triple the cost of a step, so they are only kept once asked for. they start over
+// from the current state with every reset, writeEnsembleMembers or step with other parameters or time step
+void trackEnsembleSummaries(Ensemble* ensemble);
+
+// false until the first step after tracking starts or restarts
+bool getEnsembleSummaries(Ensemble* ensemble, const float** summaries, EnsembleSummaryInfo* info);
+
+uint32_t getEnsembleCount(Ensemble* ensemble);
+void destroyEnsemble(Ensemble* ensemble);
@@ -0,0 +1,187 @@
+#include "flipmap.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <unordered_map>
+#include <vector>
+
+#include "parallel.h"
+#include "physics.h"
+#include "trajectory.h"
+
+// bumped whenever what a tile holds changes, e.g. how summaries detect flips or estimate the exponent, so old
+// tiles stop matching instead of being read as current
+#define FLIPMAP_VERSION 1
+
+static const uint32_t s_FlipMapMaxZoom = 16;
+
+// everything a tile's values depend on, stored with the tile and hashed for its file name
+struct FlipMapTileKey
+{
+    uint32_t version;
+    uint32_t kind;
+    uint32_t zoom;
+    uint32_t x, y;
+    uint32_t tileSize;
+    uint32_t integrator;
+    EnsembleParams params;
+    float dt;
+    float maxTime;
+};
+
+static_assert(sizeof(FlipMapTileKey) % sizeof(float) == 0, "tile keys are stored as is");
+
+static FlipMapTileKey makeTileKey(FlipMapKind kind, const FlipMapParams* params, uint32_t zoom, uint32_t x, uint32_t y)
+{
+    FlipMapTileKey key{};
+    key.version = FLIPMAP_VERSION;
+    key.kind = kind;
+    key.zoom = zoom;
+    key.x = x;
+    key.y = y;
+    key.tileSize = FLIPMAP_TILE_SIZE;
+    key.integrator = Trajectory_Integrator_SemiImplicitEuler;
+    key.params = params->params;
+    key.dt = params->dt;
+    key.maxTime = params->maxTime;
+    return key;
+}
+
+// one member per pixel, started at rest from the pixel's center. both kinds come out of the same run
+static bool computeTile(const FlipMapParams* params, uint32_t zoom, uint32_t x, uint32_t y, float* flipTimes, float* lyapunov)
+{
+    const uint32_t size = FLIPMAP_TILE_SIZE, count = size * size;
+    float pixel = 2.0f * PENDULUM_PI / (float)(size << zoom);
+
+    std::vector<float> members((size_t)count * ENSEMBLE_MEMBER_FLOATS, 0.0f);
+    for (uint32_t row = 0; row < size; row++)
+    {
+        for (uint32_t column = 0; column < size; column++)
+        {
+            uint32_t i = row * size + column;
+            members[i] = -PENDULUM_PI + ((x * size + column) + 0.5f) * pixel;
+            members[count + i] = -PENDULUM_PI + ((y * size + row) + 0.5f) * pixel;
+        }
+    }
+
+    Ensemble* ensemble;
+    EnsembleCreateInfo createInfo{};
+    createInfo.count = count;
+    createInfo.threadCount = 1;
+    if (!createEnsemble(&ensemble, &createInfo)) { return false; }
+
+    writeEnsembleMembers(ensemble, 0, count, members.data());
+    trackEnsembleSummaries(ensemble);
+
+    uint64_t steps = (uint64_t)std::ceil(params->maxTime / params->dt);
+    for (uint64_t step = 0; step < steps; step++)
+        stepEnsemble(ensemble, &params->params, params->dt);
+
+    const float* summaries[Ensemble_Summary_Count];
+    EnsembleSummaryInfo info;
+    bool ok = getEnsembleSummaries(ensemble, summaries, &info);
+    if (ok)
+    {
+        std::copy(summaries[Ensemble_Summary_FlipTime], summaries[Ensemble_Summary_FlipTime] + count, flipTimes);
+        std::copy(summaries[Ensemble_Summary_Lyapunov], summaries[Ensemble_Summary_Lyapunov] + count, lyapunov);
+    }
+
+    destroyEnsemble(ensemble);
+    return ok;
+}
+
+bool renderFlipMap(TileCache* cache, FlipMapKind kind, const FlipMapParams* params, const FlipMapView* view, uint32_t threadCount,
+    float* values, FlipMapStats* stats)
+{
+    if (view->width == 0 || view->height == 0 || !(view->a1Max > view->a1Min) || !(view->a2Max > view->a2Min) || !(params->dt > 0.0f))
+        return false;
+
+    const uint32_t size = FLIPMAP_TILE_SIZE;
+    float viewPixel = std::fmin((view->a1Max - view->a1Min) / view->width, (view->a2Max - view->a2Min) / view->height);
+    // a little slack so a view of exactly a level's pixels is not pushed to the next level by rounding
+    uint32_t zoom = 0;
+    while (zoom < s_FlipMapMaxZoom && 2.0f * PENDULUM_PI / (float)(size << zoom) > viewPixel * 1.01f) { zoom++; }
+
+    // the plane in pixels of this zoom level, and the tile under every pixel of the view
+    uint64_t side = (uint64_t)size << zoom;
+    std::vector<int64_t> pixelX(view->width), pixelY(view->height);
+    for (uint32_t i = 0; i < view->width; i++)
+        pixelX[i] = (int64_t)std::floor((view->a1Min + (i + 0.5) * (view->a1Max - view->a1Min) / view->width + PENDULUM_PI) / (2.0 * PENDULUM_PI) * side);
+    for (uint32_t i = 0; i < view->height; i++)
+        pixelY[i] = (int64_t)std::floor((view->a2Max - (i + 0.5) * (view->a2Max - view->a2Min) / view->height + PENDULUM_PI) / (2.0 * PENDULUM_PI) * side);
+
+    std::unordered_map<uint64_t, const float*> tiles;
+    for (int64_t y : pixelY)
+    {
+        for (int64_t x : pixelX)
+        {
+            if (x >= 0 && y >= 0 && (uint64_t)x < side && (uint64_t)y < side)
+                tiles[(uint64_t)(x / size) << 32 | (uint64_t)(y / size)] = nullptr;
+        }
+    }
+
+    std::vector<uint64_t> missing;
+    for (auto& tile : tiles)
+    {
+        FlipMapTileKey key = makeTileKey(kind, params, zoom, (uint32_t)(tile.first >> 32), (uint32_t)tile.first);
+        tile.second = cache ? loadTile(cache, &key, sizeof(key), size * size) : nullptr;
+        if (!tile.second) { missing.push_back(tile.first); }
+    }
+
+    // missing tiles are spread over the threads, each stepping its own small ensemble
+    auto computeStart = std::chrono::high_resolution_clock::now();
+    std::vector<float> flipTimes(missing.size() * size * size), lyapunov(missing.size() * size * size);
+    std::vector<uint8_t> computed(missing.size(), 0);
+    parallelFor(std::max(threadCount, 1u), (uint32_t)missing.size(), [&](uint32_t, uint32_t begin, uint32_t end)
+    {
+        for (uint32_t i = begin; i < end; i++)
+        {
+            computed[i] = computeTile(params, zoom, (uint32_t)(missing[i] >> 32), (uint32_t)missing[i],
+                flipTimes.data() + (size_t)i * size * size, lyapunov.data() + (size_t)i * size * size);
+        }
+    });
+    double computeMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - computeStart).count();
+
+    for (size_t i = 0; i < missing.size(); i++)
+    {
+        if (!computed[i]) { return false; }
+
+        uint32_t x = (uint32_t)(missing[i] >> 32), y = (uint32_t)missing[i];
+        const float* flip = flipTimes.data() + i * size * size;
+        const float* chaos = lyapunov.data() + i * size * size;
+        if (cache)
+        {
+            FlipMapTileKey flipKey = makeTileKey(FlipMap_Kind_FlipTime, params, zoom, x, y);
+            FlipMapTileKey chaosKey = makeTileKey(FlipMap_Kind_Lyapunov, params, zoom, x, y);
+            storeTile(cache, &flipKey, sizeof(flipKey), flip, size * size);
+            storeTile(cache, &chaosKey, sizeof(chaosKey), chaos, size * size);
+        }
+
+        tiles[missing[i]] = kind == FlipMap_Kind_FlipTime ? flip : chaos;
+    }
+
+    for (uint32_t row = 0; row < view->height; row++)
+    {
+        for (uint32_t column = 0; column < view->width; column++)
+        {
+            int64_t x = pixelX[column], y = pixelY[row];
+            float& value = values[(size_t)row * view->width + column];
+            if (x < 0 || y < 0 || (uint64_t)x >= side || (uint64_t)y >= side)
+            {
+                value = NAN;
+                continue;
+            }
+
+            const float* tile = tiles[(uint64_t)(x / size) << 32 | (uint64_t)(y / size)];
+            value = tile[(y % size) * size + x % size];
+        }
+    }
+
+    stats->zoom = zoom;
+    stats->tiles = (uint32_t)tiles.size();
+    stats->tilesLoaded = (uint32_t)(tiles.size() - missing.size());
+    stats->tilesComputed = (uint32_t)missing.size();
+    stats->computeMs = computeMs;
+    return true;
+}
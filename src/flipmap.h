@@ -0,0 +1,48 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "ensemble.h"
+#include "tilecache.h"
+
+// maps of the plane of starting angles (a1, a2), both pendulums at rest: how long until either arm flips over
+// the top, or how chaotic the motion is. the plane from -PI to PI on both axes is cut into a quadtree of square
+// tiles of FLIPMAP_TILE_SIZE pixels, zoom level z has 2^z by 2^z of them. a view is drawn from the coarsest
+// level whose pixels are no larger than the view's, every tile is computed once as an ensemble with summaries
+// and then kept in the tile cache, so a view that was seen before, or any view at a zoom level seen before,
+// only loads files
+
+#define FLIPMAP_TILE_SIZE 64
+
+enum FlipMapKind
+{
+    FlipMap_Kind_FlipTime, // seconds, -1 where neither arm flipped within maxTime
+    FlipMap_Kind_Lyapunov, // 1/s
+};
+
+struct FlipMapParams
+{
+    EnsembleParams params;
+    float dt;
+    float maxTime; // seconds simulated per pixel
+};
+
+struct FlipMapView
+{
+    float a1Min, a1Max; // radians, left to right
+    float a2Min, a2Max; // radians, bottom to top
+    uint32_t width, height;
+};
+
+struct FlipMapStats
+{
+    uint32_t zoom;
+    uint32_t tiles;
+    uint32_t tilesLoaded;
+    uint32_t tilesComputed;
+    double computeMs;
+};
+
+// width * height values, row 0 at the top of the view. pixels outside the plane are NaN. cache may be null
+bool renderFlipMap(TileCache* cache, FlipMapKind kind, const FlipMapParams* params, const FlipMapView* view, uint32_t threadCount,
+    float* values, FlipMapStats* stats);
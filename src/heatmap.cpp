@@ -0,0 +1,348 @@
+#include "heatmap.h"
+
+#include <glad/glad.h>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <vector>
+
+#include "parallel.h"
+
+// positions are uploaded as pixel coordinates, one batch at most this many points
+static const uint32_t s_HeatmapSplatBatch = 65536;
+
+// below this many positions a splat stays on the calling thread
+static const uint32_t s_HeatmapParallelSplat = 16384;
+
+static const char* s_HeatmapSplatVertexShaderSource = R"(
+#version 330 core
+
+layout (location = 0) in vec2 a_Pixel;
+
+uniform float u_Resolution;
+
+void main()
+{
+    // aim at the pixel center so the point lands in exactly the pixel the cpu picked
+    gl_Position = vec4((a_Pixel + 0.5) / u_Resolution * 2.0 - 1.0, 0.0, 1.0);
+}
+)";
+
+static const char* s_HeatmapSplatFragmentShaderSource = R"(
+#version 330 core
+
+out float outDensity;
+
+void main()
+{
+    outDensity = 1.0;
+}
+)";
+
+static const char* s_HeatmapDisplayVertexShaderSource = R"(
+#version 330 core
+
+uniform mat4 u_Camera;
+uniform float u_HalfExtent;
+
+out vec2 v_TexCoord;
+
+void main()
+{
+    // two triangles over the heatmap square, no vertex buffer needed
+    vec2 corners[6] = vec2[](vec2(0.0, 0.0), vec2(1.0, 0.0), vec2(1.0, 1.0), vec2(0.0, 0.0), vec2(1.0, 1.0), vec2(0.0, 1.0));
+    v_TexCoord = corners[gl_VertexID];
+    gl_Position = u_Camera * vec4((v_TexCoord * 2.0 - 1.0) * u_HalfExtent, 0.0, 1.0);
+}
+)";
+
+static const char* s_HeatmapDisplayFragmentShaderSource = R"(
+#version 330 core
+
+in vec2 v_TexCoord;
+
+uniform sampler2D u_Density;
+uniform float u_Saturation;
+
+out vec4 outColor;
+
+void main()
+{
+    float density = texture(u_Density, v_TexCoord).r;
+    float t = clamp(log2(1.0 + density) / log2(1.0 + u_Saturation), 0.0, 1.0);
+
+    // black body like ramp, premultiplied so empty pixels leave the background untouched
+    vec3 color = t < 0.5
+        ? mix(vec3(0.25, 0.05, 0.45), vec3(0.95, 0.35, 0.15), t * 2.0)
+        : mix(vec3(0.95, 0.35, 0.15), vec3(1.0, 0.98, 0.75), t * 2.0 - 1.0);
+    float alpha = sqrt(t);
+    outColor = vec4(color * alpha, alpha);
+}
+)";
+
+struct DensityHeatmap
+{
+    uint32_t resolution;
+    float halfExtent;
+    uint64_t samples;
+    bool cpu;
+
+    OglsTexture texture;
+    OglsFramebuffer framebuffer;
+    OglsShader displayShader;
+    OglsVertexArray emptyVertexArray;
+
+    // gpu path
+    OglsVertexBuffer pixelBuffer;
+    OglsVertexArray pixelVertexArray;
+    OglsShader splatShader;
+
+    // cpu path, one histogram per thread so counting needs no atomics
+    std::vector<std::vector<uint32_t>> histograms;
+    std::vector<float> resolved;
+    bool resolvedValid;
+
+    std::vector<uint16_t> pixels;
+};
+
+// the one place world positions become pixels, shared by both paths so they agree exactly
+static bool heatmapPixel(const DensityHeatmap* heatmap, OglsVec2 position, uint16_t* x, uint16_t* y)
+{
+    float scale = heatmap->resolution / (2.0f * heatmap->halfExtent);
+    float px = (position.x + heatmap->halfExtent) * scale;
+    float py = (position.y + heatmap->halfExtent) * scale;
+    if (!(px >= 0.0f && py >= 0.0f && px < heatmap->resolution && py < heatmap->resolution)) { return false; }
+
+    *x = (uint16_t)px;
+    *y = (uint16_t)py;
+    return true;
+}
+
+static void splatCpuRange(DensityHeatmap* heatmap, std::vector<uint32_t>* histogram, const OglsVec2* positions, uint32_t count)
+{
+    uint16_t x, y;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if (heatmapPixel(heatmap, positions[i], &x, &y))
+            (*histogram)[(uint32_t)y * heatmap->resolution + x]++;
+    }
+}
+
+// each thread sums every histogram over its own band of rows
+static void resolveCpuRows(DensityHeatmap* heatmap, uint32_t firstRow, uint32_t lastRow)
+{
+    uint32_t begin = firstRow * heatmap->resolution, end = lastRow * heatmap->resolution;
+    for (uint32_t i = begin; i < end; i++)
+    {
+        uint32_t count = 0;
+        for (const std::vector<uint32_t>& histogram : heatmap->histograms)
+            count += histogram[i];
+
+        // float additive blending counts exactly up to 2^24 as well
+        heatmap->resolved[i] = (float)count;
+    }
+}
+
+bool createDensityHeatmap(DensityHeatmap** heatmap, DensityHeatmapCreateInfo* createInfo)
+{
+    if (createInfo->resolution == 0 || createInfo->resolution > UINT16_MAX) { return false; }
+
+    DensityHeatmap* newHeatmap = new DensityHeatmap();
+    newHeatmap->resolution = createInfo->resolution;
+    newHeatmap->halfExtent = createInfo->halfExtent;
+    newHeatmap->cpu = createInfo->cpu;
+
+    OglsTextureCreateInfo textureCreateInfo{};
+    textureCreateInfo.width = createInfo->resolution;
+    textureCreateInfo.height = createInfo->resolution;
+    textureCreateInfo.format = Ogls_TextureFormat_R32F;
+    textureCreateInfo.filter = Ogls_TextureFilter_Nearest;
+    if (ogls::createTexture(&newHeatmap->texture, &textureCreateInfo) == Ogls_Result_Failed) { delete newHeatmap; return false; }
+    ogls::labelTexture(newHeatmap->texture, "density heatmap texture");
+
+    OglsShaderCreateInfo displayShaderCreateInfo{};
+    displayShaderCreateInfo.vertexSrc = s_HeatmapDisplayVertexShaderSource;
+    displayShaderCreateInfo.fragmentSrc = s_HeatmapDisplayFragmentShaderSource;
+    ogls::createShaderFromStr(&newHeatmap->displayShader, &displayShaderCreateInfo);
+    ogls::labelShader(newHeatmap->displayShader, "density heatmap display shader");
+
+    OglsVertexArrayCreateInfo emptyVertexArrayCreateInfo{};
+    ogls::createVertexArray(&newHeatmap->emptyVertexArray, &emptyVertexArrayCreateInfo);
+
+    if (newHeatmap->cpu)
+    {
+        uint32_t threadCount = std::max(createInfo->threadCount, 1u);
+        newHeatmap->histograms.assign(threadCount, std::vector<uint32_t>((size_t)createInfo->resolution * createInfo->resolution, 0));
+        newHeatmap->resolved.assign((size_t)createInfo->resolution * createInfo->resolution, 0.0f);
+    }
+    else
+    {
+        OglsFramebufferCreateInfo framebufferCreateInfo{};
+        framebufferCreateInfo.colorAttachment = newHeatmap->texture;
+        ogls::createFramebuffer(&newHeatmap->framebuffer, &framebufferCreateInfo);
+        ogls::labelFramebuffer(newHeatmap->framebuffer, "density heatmap framebuffer");
+
+        ogls::createVertexBuffer(&newHeatmap->pixelBuffer, nullptr, s_HeatmapSplatBatch * 2 * sizeof(uint16_t), Ogls_BufferMode_Dynamic);
+        ogls::labelVertexBuffer(newHeatmap->pixelBuffer, "density heatmap splat buffer");
+
+        // unnormalized ushort converts to float exactly, the shader gets whole pixel numbers
+        OglsVertexArrayAttribute pixelAttribute = { 0, 2, 2 * sizeof(uint16_t), Ogls_DataType_UnsignedShort, (void*)0, false };
+        OglsVertexArrayCreateInfo pixelVertexArrayCreateInfo{};
+        pixelVertexArrayCreateInfo.vertexBuffer = newHeatmap->pixelBuffer;
+        pixelVertexArrayCreateInfo.pAttributes = &pixelAttribute;
+        pixelVertexArrayCreateInfo.attributeCount = 1;
+        ogls::createVertexArray(&newHeatmap->pixelVertexArray, &pixelVertexArrayCreateInfo);
+
+        OglsShaderCreateInfo splatShaderCreateInfo{};
+        splatShaderCreateInfo.vertexSrc = s_HeatmapSplatVertexShaderSource;
+        splatShaderCreateInfo.fragmentSrc = s_HeatmapSplatFragmentShaderSource;
+        ogls::createShaderFromStr(&newHeatmap->splatShader, &splatShaderCreateInfo);
+        ogls::labelShader(newHeatmap->splatShader, "density heatmap splat shader");
+    }
+
+    clearDensityHeatmap(newHeatmap, createInfo->halfExtent, createInfo->renderTarget);
+
+    *heatmap = newHeatmap;
+    return true;
+}
+
+void clearDensityHeatmap(DensityHeatmap* heatmap, float halfExtent, OglsFramebuffer renderTarget)
+{
+    heatmap->halfExtent = halfExtent;
+    heatmap->samples = 0;
+
+    if (heatmap->cpu)
+    {
+        for (std::vector<uint32_t>& histogram : heatmap->histograms)
+            std::fill(histogram.begin(), histogram.end(), 0);
+
+        heatmap->resolvedValid = false;
+        return;
+    }
+
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+
+    ogls::bindFramebuffer(heatmap->framebuffer);
+    glViewport(0, 0, heatmap->resolution, heatmap->resolution);
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+
+    ogls::bindFramebuffer(renderTarget);
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+}
+
+void splatDensityHeatmap(DensityHeatmap* heatmap, const OglsVec2* positions, uint32_t count, OglsFramebuffer renderTarget)
+{
+    if (count == 0) { return; }
+    heatmap->samples += count;
+
+    if (heatmap->cpu)
+    {
+        uint32_t threadCount = count < s_HeatmapParallelSplat ? 1 : (uint32_t)heatmap->histograms.size();
+        parallelFor(threadCount, count, [heatmap, positions](uint32_t thread, uint32_t begin, uint32_t end)
+        {
+            splatCpuRange(heatmap, &heatmap->histograms[thread], positions + begin, end - begin);
+        });
+
+        heatmap->resolvedValid = false;
+        return;
+    }
+
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+
+    ogls::bindFramebuffer(heatmap->framebuffer);
+    glViewport(0, 0, heatmap->resolution, heatmap->resolution);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_ONE, GL_ONE);
+
+    ogls::bindShader(heatmap->splatShader);
+    glUniform1f(glGetUniformLocation(ogls::getShaderId(heatmap->splatShader), "u_Resolution"), (float)heatmap->resolution);
+    ogls::bindVertexArray(heatmap->pixelVertexArray);
+
+    for (uint32_t first = 0; first < count; first += s_HeatmapSplatBatch)
+    {
+        uint32_t batch = std::min(count - first, s_HeatmapSplatBatch);
+
+        heatmap->pixels.clear();
+        uint16_t x, y;
+        for (uint32_t i = first; i < first + batch; i++)
+        {
+            if (!heatmapPixel(heatmap, positions[i], &x, &y)) { continue; }
+            heatmap->pixels.push_back(x);
+            heatmap->pixels.push_back(y);
+        }
+
+        uint32_t points = (uint32_t)heatmap->pixels.size() / 2;
+        if (points == 0) { continue; }
+
+        ogls::bindVertexBufferSubData(heatmap->pixelBuffer, points * 2 * sizeof(uint16_t), 0, heatmap->pixels.data());
+        ogls::renderDrawInstanced(GL_POINTS, 0, points, 1);
+    }
+
+    glDisable(GL_BLEND);
+    ogls::bindFramebuffer(renderTarget);
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+}
+
+void drawDensityHeatmap(DensityHeatmap* heatmap, const glm::mat4& camera, float saturation)
+{
+    if (heatmap->cpu && !heatmap->resolvedValid)
+    {
+        parallelFor((uint32_t)heatmap->histograms.size(), heatmap->resolution, [heatmap](uint32_t, uint32_t firstRow, uint32_t lastRow)
+        {
+            resolveCpuRows(heatmap, firstRow, lastRow);
+        });
+
+        ogls::bindTextureSubData(heatmap->texture, heatmap->resolved.data());
+        heatmap->resolvedValid = true;
+    }
+
+    uint32_t id = ogls::getShaderId(heatmap->displayShader);
+    ogls::bindShader(heatmap->displayShader);
+    glUniformMatrix4fv(glGetUniformLocation(id, "u_Camera"), 1, GL_FALSE, glm::value_ptr(camera));
+    glUniform1f(glGetUniformLocation(id, "u_HalfExtent"), heatmap->halfExtent);
+    glUniform1f(glGetUniformLocation(id, "u_Saturation"), std::max(saturation, 1.0f));
+    glUniform1i(glGetUniformLocation(id, "u_Density"), 0);
+
+    ogls::bindTexture(heatmap->texture, 0);
+    ogls::bindVertexArray(heatmap->emptyVertexArray);
+
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+    ogls::renderDraw(0, 6);
+    glDisable(GL_BLEND);
+}
+
+uint64_t getDensityHeatmapSamples(DensityHeatmap* heatmap)
+{
+    return heatmap->samples;
+}
+
+float getDensityHeatmapHalfExtent(DensityHeatmap* heatmap)
+{
+    return heatmap->halfExtent;
+}
+
+bool isDensityHeatmapCpu(DensityHeatmap* heatmap)
+{
+    return heatmap->cpu;
+}
+
+void destroyDensityHeatmap(DensityHeatmap* heatmap)
+{
+    ogls::destroyTexture(heatmap->texture);
+    ogls::destroyShader(heatmap->displayShader);
+    ogls::destroyVertexArray(heatmap->emptyVertexArray);
+
+    if (!heatmap->cpu)
+    {
+        ogls::destroyFramebuffer(heatmap->framebuffer);
+        ogls::destroyVertexArray(heatmap->pixelVertexArray);
+        ogls::destroyVertexBuffer(heatmap->pixelBuffer);
+        ogls::destroyShader(heatmap->splatShader);
+    }
+
+    delete heatmap;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <glm/glm.hpp>
+
+#include "ogls.h"
+
+// occupancy density of simulated positions over a fixed square of world space. every splatted position adds one
+// to the pixel it falls in, so memory depends only on the resolution and never on how long the run is.
+// the gpu path splats points with additive blending into an r32f target, the cpu path counts into per-thread
+// histograms reduced in parallel. both map positions to pixels the same way and produce the same image
+
+struct DensityHeatmap;
+
+struct DensityHeatmapCreateInfo
+{
+    uint32_t resolution;  // pixels per side, at most 65535
+    float halfExtent;     // world space covered is [-halfExtent, halfExtent] on both axes
+    uint32_t threadCount; // cpu path only
+    bool cpu;
+    OglsFramebuffer renderTarget; // bound again after the heatmap draws into its own target
+};
+
+bool createDensityHeatmap(DensityHeatmap** heatmap, DensityHeatmapCreateInfo* createInfo);
+void clearDensityHeatmap(DensityHeatmap* heatmap, float halfExtent, OglsFramebuffer renderTarget);
+void splatDensityHeatmap(DensityHeatmap* heatmap, const OglsVec2* positions, uint32_t count, OglsFramebuffer renderTarget);
+
+// saturation is the density shown at full intensity, the tone map is logarithmic below it
+void drawDensityHeatmap(DensityHeatmap* heatmap, const glm::mat4& camera, float saturation);
+
+uint64_t getDensityHeatmapSamples(DensityHeatmap* heatmap);
+float getDensityHeatmapHalfExtent(DensityHeatmap* heatmap);
+bool isDensityHeatmapCpu(DensityHeatmap* heatmap);
+void destroyDensityHeatmap(DensityHeatmap* heatmap);
@@ -9,18 +9,42 @@
 
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <cmath>
 #include <cstdint>
 #include <string>
 #include <vector>
+#include <deque>
 #include <algorithm>
 #include <chrono>
+#include <thread>
+
+#include <unistd.h>
+#include <sys/wait.h>
 
 #include <imgui/imgui.h>
 #include <imgui/imgui_impl_glfw.h>
 #include <imgui/imgui_impl_opengl3.h>
 
 #include "ogls.h"
+#include "capture.h"
+#include "encoder.h"
+#include "heatmap.h"
+#include "ensemble.h"
+#include "sprites.h"
+#include "trajectory.h"
+#include "codec.h"
+#include "checkpoint.h"
+#include "replay.h"
+#include "random.h"
+#include "timeline.h"
+#include "stream.h"
+#include "shm.h"
+#include "scene.h"
+#include "summary.h"
+#include "flipmap.h"
+#include "tilecache.h"
+#include "physics.h"
 
 #define PENDULUM_1_MASS   10.0f
 #define PENDULUM_2_MASS   10.0f
@@ -36,54 +60,184 @@
 #define COLOR_BG 0.12, 0.11, 0.18
 #define COLOR_TRAIL 0.3f, 0.3f, 0.3f
 
-#define PI (22.0f/7.0f) /* 3.1415... */
+#define PI PENDULUM_PI /* 3.1415... */
 
 static const uint32_t s_MaxVertices = 256;
 static const uint32_t s_MaxIndices = s_MaxVertices * 8;
 static const uint32_t s_MaxTrailVertices = UINT16_MAX;
-
+static const uint32_t s_MaxPendulumInstances = 1024;
+static const uint32_t s_PendulumBobSides = 32;
+static const uint32_t s_TrailFullResPoints = 256;
+static const uint32_t s_TrailMaxRun = 64;
+static const float s_TrailTolerancePixels = 0.5f;
+
+// 8 bytes, only the position, the color of a draw is set through the u_Color uniform. positions stay full
+// floats, half floats lose whole pixels once long arms or zoom take coordinates past a few units
 struct Vertex
 {
     OglsVec2 pos;
-    OglsVec3 color;
 };
 
 struct BatchGroup
 {
-    OglsVertexBuffer* vertexBuffer;
-    OglsIndexBuffer* indexBuffer;
-    OglsVertexArray* vertexArray;
+    OglsVertexBuffer vertexBuffer;
+    OglsIndexBuffer indexBuffer;
+    OglsVertexArray vertexArray;
+    OglsShader shader;
     std::vector<Vertex> vertices;
-    std::vector<uint32_t> indices;
+    std::vector<uint16_t> indices;
+};
+
+struct TrailPoint
+{
+    uint64_t seq;
+    OglsVec2 pos;
+};
+
+struct TrailPath
+{
+    std::deque<OglsVec2> history;      // full resolution trail, oldest first
+    std::deque<TrailPoint> simplified; // decimated points taken from history
+    uint64_t pushed;                   // total points ever pushed, also the seq of the next point
+    uint64_t decimatedEnd;             // seq of the first point not yet seen by the decimator
+    float tolerance;                   // world space tolerance the simplified points were built with
+};
+
+struct TrailAccumulator
+{
+    OglsTexture texture;
+    OglsFramebuffer framebuffer;
+    OglsVec2 lastPos;
+    bool hasLastPos;
+    bool clear;
 };
 
 const char* vertexShaderSource = R"(
 #version 330 core
 
 layout (location = 0) in vec2 aPos;
-layout (location = 1) in vec3 aColor;
-
-out vec3 fragColor;
 
 uniform mat4 u_Camera;
 
 void main()
 {
     gl_Position = u_Camera * vec4(aPos, 0.0, 1.0);
-    fragColor = aColor;
 }
 )";
 
 const char* fragmentShaderSource = R"(
 #version 330 core
 
-in vec3 fragColor;
+out vec4 outColor;
+
+uniform vec3 u_Color;
+
+void main()
+{
+    outColor = vec4(u_Color, 1.0f);
+}
+)";
+
+/*
+ * vertex pulling pendulum shader, the only per pendulum input is an (a1, a2) pair fetched from a
+ * buffer texture with gl_InstanceID. u_Primitive 0 emits the two rods as GL_LINES (4 vertices),
+ * u_Primitive 1 emits both bobs as GL_TRIANGLES (2 * u_Sides * 3 vertices).
+ */
+const char* pendulumVertexShaderSource = R"(
+#version 330 core
+
+uniform samplerBuffer u_Angles;
+uniform mat4 u_Camera;
+uniform vec2 u_Lengths;
+uniform vec2 u_Radii;
+uniform int u_Sides;
+uniform int u_Primitive;
+
+const float TWO_PI = 6.28318530718;
+
+void main()
+{
+    vec2 a = texelFetch(u_Angles, gl_InstanceID).rg;
+    vec2 p1 = u_Lengths.x * vec2(sin(a.x), -cos(a.x));
+    vec2 p2 = p1 + u_Lengths.y * vec2(sin(a.y), -cos(a.y));
+
+    vec2 pos;
+    if (u_Primitive == 0)
+    {
+        int v = gl_VertexID;
+        pos = v == 0 ? vec2(0.0) : (v == 3 ? p2 : p1);
+    }
+    else
+    {
+        int verticesPerBob = u_Sides * 3;
+        int bob = gl_VertexID / verticesPerBob;
+        int tri = (gl_VertexID % verticesPerBob) / 3;
+        int corner = gl_VertexID % 3;
+
+        vec2 center = bob == 0 ? p1 : p2;
+        float radius = bob == 0 ? u_Radii.x : u_Radii.y;
+        float angle = TWO_PI * float(tri + corner - 1) / float(u_Sides);
+
+        pos = corner == 0 ? center : center + radius * vec2(cos(angle), sin(angle));
+    }
+
+    gl_Position = u_Camera * vec4(pos, 0.0, 1.0);
+}
+)";
+
+const char* pendulumFragmentShaderSource = R"(
+#version 330 core
+
+out vec4 outColor;
+
+uniform vec3 u_Color;
+
+void main()
+{
+    outColor = vec4(u_Color, 1.0);
+}
+)";
+
+// fullscreen triangle generated from gl_VertexID, drawn with an attribute-less vertex array
+const char* fullscreenVertexShaderSource = R"(
+#version 330 core
+
+out vec2 texCoord;
+
+void main()
+{
+    vec2 pos = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    texCoord = pos;
+    gl_Position = vec4(pos * 2.0 - 1.0, 0.0, 1.0);
+}
+)";
+
+// multiplies the destination by u_Fade when drawn with glBlendFunc(GL_ZERO, GL_SRC_ALPHA)
+const char* fadeFragmentShaderSource = R"(
+#version 330 core
 
 out vec4 outColor;
 
+uniform float u_Fade;
+
 void main()
 {
-    outColor = vec4(fragColor, 1.0f);
+    outColor = vec4(0.0, 0.0, 0.0, u_Fade);
+}
+)";
+
+const char* compositeFragmentShaderSource = R"(
+#version 330 core
+
+in vec2 texCoord;
+
+out vec4 outColor;
+
+uniform sampler2D u_Texture;
+
+void main()
+{
+    outColor = texture(u_Texture, texCoord);
 }
 )";
 
@@ -97,6 +251,16 @@ float radians(float deg)
     return (deg * PI * 0.005555f);
 }
 
+Vertex makeVertex(OglsVec2 pos)
+{
+    return { pos };
+}
+
+void setBatchColor(BatchGroup* batch, OglsVec3 color)
+{
+    glUniform3f(glGetUniformLocation(ogls::getShaderId(batch->shader), "u_Color"), color.r, color.g, color.b);
+}
+
 void drawPoly(BatchGroup* batch, OglsVec2 pos, OglsVec3 color, float radius, uint32_t nSides)
 {
     batch->vertices.clear();
@@ -105,7 +269,7 @@ void drawPoly(BatchGroup* batch, OglsVec2 pos, OglsVec3 color, float radius, uin
     batch->vertices.reserve(nSides + 1);
     batch->indices.reserve(nSides * 3 + 1);
 
-    batch->vertices.push_back({ pos, color });
+    batch->vertices.push_back(makeVertex(pos));
 
     float twoPi = (float)(2 * PI);
     float angle = twoPi / (float)nSides;
@@ -118,7 +282,7 @@ void drawPoly(BatchGroup* batch, OglsVec2 pos, OglsVec3 color, float radius, uin
         float posx = pos.x + (radius * circlex);
         float posy = pos.y + (radius * circley);
 
-        batch->vertices.push_back({{ posx, posy}, color });
+        batch->vertices.push_back(makeVertex({ posx, posy }));
         batch->indices.push_back(0);
         batch->indices.push_back(i + 1);
         batch->indices.push_back(i + 2);
@@ -127,12 +291,12 @@ void drawPoly(BatchGroup* batch, OglsVec2 pos, OglsVec3 color, float radius, uin
     // connect the last vertex off the last triangle to the first vertex on the circle
     batch->indices.back() = batch->indices[1];
 
-    ogls::bindVertexBufferSubData(batch->vertexBuffer, batch->vertices.size() * sizeof(Vertex), 0, (float*)batch->vertices.data());
-    ogls::bindIndexBufferSubData(batch->indexBuffer, batch->indices.size() * sizeof(uint32_t), 0, batch->indices.data());
+    ogls::bindVertexBufferSubData(batch->vertexBuffer, batch->vertices.size() * sizeof(Vertex), 0, batch->vertices.data());
+    ogls::bindIndexBufferSubData(batch->indexBuffer, batch->indices.size() * sizeof(uint16_t), 0, batch->indices.data());
 
+    setBatchColor(batch, color);
     ogls::bindVertexArray(batch->vertexArray);
-    ogls::renderDrawIndex(batch->indices.size());
-    ogls::bindVertexArray(0);
+    ogls::renderDrawIndex(batch->indices.size(), Ogls_DataType_UnsignedShort);
 }
 
 void drawLine(BatchGroup* batch, OglsVec2 pos1, OglsVec2 pos2, OglsVec3 color)
@@ -140,48 +304,950 @@ void drawLine(BatchGroup* batch, OglsVec2 pos1, OglsVec2 pos2, OglsVec3 color)
     batch->vertices.clear();
     batch->indices.clear();
 
-    batch->vertices.push_back({ pos1, color });
-    batch->vertices.push_back({ pos2, color });
-    batch->indices = { 0, 1, 2, 3 };
+    batch->vertices.push_back(makeVertex(pos1));
+    batch->vertices.push_back(makeVertex(pos2));
+    batch->indices = { 0, 1 };
 
-    ogls::bindVertexBufferSubData(batch->vertexBuffer, batch->vertices.size() * sizeof(Vertex), 0, (float*)batch->vertices.data());
-    ogls::bindIndexBufferSubData(batch->indexBuffer, batch->indices.size() * sizeof(uint32_t), 0, batch->indices.data());
+    ogls::bindVertexBufferSubData(batch->vertexBuffer, batch->vertices.size() * sizeof(Vertex), 0, batch->vertices.data());
+    ogls::bindIndexBufferSubData(batch->indexBuffer, batch->indices.size() * sizeof(uint16_t), 0, batch->indices.data());
 
+    setBatchColor(batch, color);
     ogls::bindVertexArray(batch->vertexArray);
-    ogls::renderDrawIndexMode(GL_LINES, batch->indices.size());
-    ogls::bindVertexArray(0);
+    ogls::renderDrawIndexMode(GL_LINES, batch->indices.size(), Ogls_DataType_UnsignedShort);
+}
+
+float pointSegmentDistance(OglsVec2 p, OglsVec2 a, OglsVec2 b)
+{
+    float abx = b.x - a.x, aby = b.y - a.y;
+    float apx = p.x - a.x, apy = p.y - a.y;
+    float len2 = abx * abx + aby * aby;
+    float t = len2 > 0.0f ? std::clamp((apx * abx + apy * aby) / len2, 0.0f, 1.0f) : 0.0f;
+    float dx = apx - t * abx, dy = apy - t * aby;
+    return std::sqrt(dx * dx + dy * dy);
+}
+
+void clearTrailPath(TrailPath* trail)
+{
+    trail->history.clear();
+    trail->simplified.clear();
+}
+
+/*
+ * streaming polyline simplification, older points are merged into a segment from the last kept
+ * point (anchor) as long as every skipped point stays within tolerance of it. the newest
+ * s_TrailFullResPoints points are never touched so the trail stays at full resolution near the bob.
+ */
+void pushTrailPoint(TrailPath* trail, OglsVec2 pos, float tolerance)
+{
+    trail->history.push_back(pos);
+    trail->pushed++;
+
+    if (trail->history.size() > s_MaxTrailVertices) { trail->history.pop_front(); }
+
+    uint64_t first = trail->pushed - trail->history.size();
+    while (!trail->simplified.empty() && trail->simplified.front().seq < first) { trail->simplified.pop_front(); }
+
+    // rebuild once the zoom level has changed enough for the old tolerance to be visibly wrong
+    if (trail->simplified.empty() || tolerance < trail->tolerance * 0.5f || tolerance > trail->tolerance * 2.0f)
+    {
+        trail->simplified.clear();
+        trail->simplified.push_back({ first, trail->history.front() });
+        trail->decimatedEnd = first + 1;
+        trail->tolerance = tolerance;
+    }
+
+    while (trail->decimatedEnd + s_TrailFullResPoints < trail->pushed)
+    {
+        TrailPoint anchor = trail->simplified.back();
+        OglsVec2 next = trail->history[trail->decimatedEnd - first];
+
+        bool fits = trail->decimatedEnd - anchor.seq <= s_TrailMaxRun;
+        for (uint64_t seq = anchor.seq + 1; fits && seq < trail->decimatedEnd; seq++)
+            fits = pointSegmentDistance(trail->history[seq - first], anchor.pos, next) <= trail->tolerance;
+
+        if (!fits)
+        {
+            uint64_t keep = trail->decimatedEnd - 1;
+            trail->simplified.push_back({ keep, trail->history[keep - first] });
+        }
+
+        trail->decimatedEnd++;
+    }
 }
 
-void drawTrail(BatchGroup* batch, OglsVec2 pos, OglsVec3 color)
+void drawTrail(BatchGroup* batch, TrailPath* trail, OglsVec3 color)
 {
-    if (batch->vertices.size() >= s_MaxTrailVertices) { batch->vertices.erase(batch->vertices.begin()); }
+    if (trail->history.empty()) { return; }
 
-    batch->vertices.push_back({pos, color});
+    batch->vertices.clear();
+
+    for (const TrailPoint& point : trail->simplified)
+        batch->vertices.push_back(makeVertex(point.pos));
 
-    ogls::bindVertexBufferSubData(batch->vertexBuffer, batch->vertices.size() * sizeof(Vertex), 0, (float*)batch->vertices.data());
+    // points after the last anchor have not been simplified yet
+    uint64_t first = trail->pushed - trail->history.size();
+    for (uint64_t seq = trail->simplified.back().seq + 1; seq < trail->pushed; seq++)
+        batch->vertices.push_back(makeVertex(trail->history[seq - first]));
 
+    ogls::bindVertexBufferSubData(batch->vertexBuffer, batch->vertices.size() * sizeof(Vertex), 0, batch->vertices.data());
+
+    setBatchColor(batch, color);
     ogls::bindVertexArray(batch->vertexArray);
     ogls::renderDrawMode(GL_LINE_STRIP, 0, batch->vertices.size());
-    ogls::bindVertexArray(0);
 }
 
-float clampAngle(float x)
+// draw every pendulum in angles with two instanced draws, positions are derived on the gpu
+void drawPendulumsGpu(OglsShader pendulumShader, OglsVertexBuffer angleBuffer, OglsTexture angleTexture, OglsVertexArray emptyVertexArray, const std::vector<OglsVec2>& angles, OglsVec2 lengths, OglsVec2 radii, OglsVec3 color, const glm::mat4& camera)
 {
-    float angle = std::fmod(x, 2 * PI);
-    if (angle < 0) { angle += 2 * PI; }
-    return angle;
+    uint32_t count = (uint32_t)std::min<size_t>(angles.size(), s_MaxPendulumInstances);
+    if (count == 0) { return; }
+
+    ogls::bindVertexBufferSubData(angleBuffer, count * sizeof(OglsVec2), 0, (float*)angles.data());
+
+    uint32_t id = ogls::getShaderId(pendulumShader);
+    ogls::bindShader(pendulumShader);
+    glUniformMatrix4fv(glGetUniformLocation(id, "u_Camera"), 1, GL_FALSE, glm::value_ptr(camera));
+    glUniform1i(glGetUniformLocation(id, "u_Angles"), 0);
+    glUniform2f(glGetUniformLocation(id, "u_Lengths"), lengths.x, lengths.y);
+    glUniform2f(glGetUniformLocation(id, "u_Radii"), radii.x, radii.y);
+    glUniform3f(glGetUniformLocation(id, "u_Color"), color.r, color.g, color.b);
+    glUniform1i(glGetUniformLocation(id, "u_Sides"), s_PendulumBobSides);
+
+    ogls::bindTexture(angleTexture, 0);
+    ogls::bindVertexArray(emptyVertexArray);
+
+    glUniform1i(glGetUniformLocation(id, "u_Primitive"), 0);
+    ogls::renderDrawInstanced(GL_LINES, 0, 4, count);
+
+    glUniform1i(glGetUniformLocation(id, "u_Primitive"), 1);
+    ogls::renderDrawInstanced(GL_TRIANGLES, 0, 2 * s_PendulumBobSides * 3, count);
+
+}
+
+void resizeTrailAccumulator(TrailAccumulator* accum, uint32_t width, uint32_t height)
+{
+    if (accum->texture.handle && ogls::getTextureWidth(accum->texture) == width && ogls::getTextureHeight(accum->texture) == height)
+        return;
+
+    if (accum->framebuffer.handle) { ogls::destroyFramebuffer(accum->framebuffer); accum->framebuffer = {}; }
+    if (accum->texture.handle) { ogls::destroyTexture(accum->texture); accum->texture = {}; }
+
+    // half float so the exponential fade does not get stuck on 8-bit rounding
+    OglsTextureCreateInfo textureCreateInfo{};
+    textureCreateInfo.width = width;
+    textureCreateInfo.height = height;
+    textureCreateInfo.format = Ogls_TextureFormat_RGBA16F;
+    textureCreateInfo.filter = Ogls_TextureFilter_Nearest;
+    if (ogls::createTexture(&accum->texture, &textureCreateInfo) == Ogls_Result_Failed) { accum->texture = {}; return; }
+    ogls::labelTexture(accum->texture, "trail accumulation texture");
+
+    OglsFramebufferCreateInfo framebufferCreateInfo{};
+    framebufferCreateInfo.colorAttachment = accum->texture;
+    if (ogls::createFramebuffer(&accum->framebuffer, &framebufferCreateInfo) == Ogls_Result_Failed) { accum->framebuffer = {}; return; }
+    ogls::labelFramebuffer(accum->framebuffer, "trail accumulation framebuffer");
+
+    accum->clear = true;
+}
+
+// fade the accumulated trail and draw only the newest segment into it, cost is constant in trail length
+void accumulateTrail(TrailAccumulator* accum, BatchGroup* batch, OglsShader shader, OglsShader fadeShader, OglsVertexArray fullscreenVertexArray, OglsFramebuffer renderTarget, OglsVec2 pos, OglsVec3 color, float fade)
+{
+    if (!accum->framebuffer.handle) { return; }
+
+    ogls::bindFramebuffer(accum->framebuffer);
+    glViewport(0, 0, ogls::getFramebufferWidth(accum->framebuffer), ogls::getFramebufferHeight(accum->framebuffer));
+
+    if (accum->clear)
+    {
+        glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+        glClear(GL_COLOR_BUFFER_BIT);
+        accum->hasLastPos = false;
+        accum->clear = false;
+    }
+
+    ogls::bindShader(fadeShader);
+    glUniform1f(glGetUniformLocation(ogls::getShaderId(fadeShader), "u_Fade"), fade);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_ZERO, GL_SRC_ALPHA);
+    ogls::bindVertexArray(fullscreenVertexArray);
+    ogls::renderDraw(0, 3);
+    glDisable(GL_BLEND);
+
+    ogls::bindShader(shader);
+    if (accum->hasLastPos) { drawLine(batch, accum->lastPos, pos, color); }
+
+    accum->lastPos = pos;
+    accum->hasLastPos = true;
+
+    ogls::bindFramebuffer(renderTarget);
+}
+
+// draw the accumulated trail texture under the pendulums, the texture holds premultiplied alpha
+void compositeTrail(TrailAccumulator* accum, OglsShader shader, OglsShader compositeShader, OglsVertexArray fullscreenVertexArray)
+{
+    if (!accum->texture.handle) { return; }
+
+    ogls::bindShader(compositeShader);
+    glUniform1i(glGetUniformLocation(ogls::getShaderId(compositeShader), "u_Texture"), 0);
+    ogls::bindTexture(accum->texture, 0);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+    ogls::bindVertexArray(fullscreenVertexArray);
+    ogls::renderDraw(0, 3);
+    glDisable(GL_BLEND);
+
+    ogls::bindShader(shader);
+}
+
+static const uint64_t s_HeadlessDefaultFrames = 600;
+static const uint32_t s_HeatmapResolution = 512;
+static const float s_HeatmapMargin = 1.05f;
+static const uint32_t s_MaxEnsembleMembers = 1000000;
+static const uint32_t s_DefaultEnsembleMembers = 100000;
+static const float s_DefaultCheckpointSeconds = 60.0f;
+static const uint32_t s_DefaultShmSlots = 1024;
+static const uint64_t s_ShmBenchmarkSnapshots = 10000000;
+static const uint32_t s_DefaultMapSize = 512;
+static const float s_DefaultMapSeconds = 20.0f;
+static const uint32_t s_DefaultMapCacheMb = 512;
+
+// --headless WxH renders into an offscreen framebuffer on glfw's null platform and exits after a frame or sim time limit
+struct AppOptions
+{
+    bool headless = false;
+    int width = 800, height = 600;
+    uint64_t maxFrames = 0;
+    float maxSimSeconds = 0.0f;
+    const char* capturePath = nullptr;
+    uint32_t encodeThreads = std::max(std::thread::hardware_concurrency(), 1u);
+    bool pngCompress = true;
+    bool heatmap = false;
+    bool heatmapCpu = false;
+    uint32_t ensembleMembers = 0;
+    const char* recordPath = nullptr;
+    const char* inspectPath = nullptr;
+    double inspectTime = -1.0; // negative when no --at was given
+    const char* benchmarkPath = nullptr;
+    const char* checkpointPath = nullptr;
+    uint64_t checkpointSteps = 0;
+    float checkpointSeconds = 0.0f; // wall clock
+    const char* restorePath = nullptr;
+    const char* logPath = nullptr;
+    const char* replayPath = nullptr;
+    uint64_t seed = 0;
+    bool seeded = false;
+    const char* streamTarget = nullptr;
+    StreamFormat streamFormat = Stream_Format_Csv;
+    uint32_t streamDecimation = 1;
+    const char* shmName = nullptr;
+    uint32_t shmSlots = s_DefaultShmSlots;
+    int shmBenchmarkConsumers = -1; // negative when no --shm-benchmark was given
+    const char* scenePath = nullptr;
+    const char* sidecarPath = nullptr;
+    const char* summariesPath = nullptr;
+    const char* summariesInspectPath = nullptr;
+    const char* mapPath = nullptr;
+    FlipMapKind mapKind = FlipMap_Kind_FlipTime;
+    float mapRegion[4] = { -180.0f, 180.0f, -180.0f, 180.0f }; // degrees, a1 from and to, a2 from and to
+    uint32_t mapWidth = s_DefaultMapSize, mapHeight = s_DefaultMapSize;
+    float mapSeconds = s_DefaultMapSeconds;
+    uint32_t mapCacheMb = s_DefaultMapCacheMb;
+};
+
+bool parseAppOptions(int argCount, char** args, AppOptions* options)
+{
+    *options = AppOptions{};
+
+    for (int i = 1; i < argCount; i++)
+    {
+        std::string arg = args[i];
+        bool hasValue = i + 1 < argCount;
+
+        if (arg == "--headless" && hasValue && std::sscanf(args[i + 1], "%dx%d", &options->width, &options->height) == 2 && options->width > 0 && options->height > 0)
+        {
+            options->headless = true;
+            i++;
+        }
+        else if (arg == "--frames" && hasValue)
+        {
+            options->maxFrames = std::strtoull(args[++i], nullptr, 10);
+        }
+        else if (arg == "--seconds" && hasValue)
+        {
+            options->maxSimSeconds = std::strtof(args[++i], nullptr);
+        }
+        else if (arg == "--capture" && hasValue)
+        {
+            options->capturePath = args[++i];
+        }
+        else if (arg == "--encode-threads" && hasValue)
+        {
+            options->encodeThreads = std::max((uint32_t)std::strtoul(args[++i], nullptr, 10), 1u);
+        }
+        else if (arg == "--png-uncompressed")
+        {
+            options->pngCompress = false;
+        }
+        else if (arg == "--heatmap")
+        {
+            options->heatmap = true;
+        }
+        else if (arg == "--heatmap-cpu")
+        {
+            options->heatmap = true;
+            options->heatmapCpu = true;
+        }
+        else if (arg == "--ensemble" && hasValue)
+        {
+            options->ensembleMembers = std::clamp((uint32_t)std::strtoul(args[++i], nullptr, 10), 1u, s_MaxEnsembleMembers);
+        }
+        else if (arg == "--record" && hasValue)
+        {
+            options->recordPath = args[++i];
+        }
+        else if (arg == "--inspect" && hasValue)
+        {
+            options->inspectPath = args[++i];
+        }
+        else if (arg == "--at" && hasValue)
+        {
+            options->inspectTime = std::max(std::strtod(args[++i], nullptr), 0.0);
+        }
+        else if (arg == "--codec-benchmark" && hasValue)
+        {
+            options->benchmarkPath = args[++i];
+        }
+        else if (arg == "--checkpoint" && hasValue)
+        {
+            options->checkpointPath = args[++i];
+        }
+        else if (arg == "--checkpoint-every" && hasValue)
+        {
+            options->checkpointSteps = std::strtoull(args[++i], nullptr, 10);
+        }
+        else if (arg == "--checkpoint-seconds" && hasValue)
+        {
+            options->checkpointSeconds = std::strtof(args[++i], nullptr);
+        }
+        else if (arg == "--restore" && hasValue)
+        {
+            options->restorePath = args[++i];
+        }
+        else if (arg == "--log" && hasValue)
+        {
+            options->logPath = args[++i];
+        }
+        else if (arg == "--replay" && hasValue)
+        {
+            options->replayPath = args[++i];
+        }
+        else if (arg == "--seed" && hasValue)
+        {
+            options->seed = std::strtoull(args[++i], nullptr, 10);
+            options->seeded = true;
+        }
+        else if (arg == "--stream" && hasValue)
+        {
+            options->streamTarget = args[++i];
+        }
+        else if (arg == "--stream-format" && hasValue && streamFormatFromName(args[i + 1], &options->streamFormat))
+        {
+            i++;
+        }
+        else if (arg == "--stream-every" && hasValue)
+        {
+            options->streamDecimation = std::max((uint32_t)std::strtoul(args[++i], nullptr, 10), 1u);
+        }
+        else if (arg == "--shm" && hasValue)
+        {
+            options->shmName = args[++i];
+        }
+        else if (arg == "--shm-slots" && hasValue)
+        {
+            options->shmSlots = std::max((uint32_t)std::strtoul(args[++i], nullptr, 10), 1u);
+        }
+        else if (arg == "--scene" && hasValue)
+        {
+            options->scenePath = args[++i];
+        }
+        else if (arg == "--scene-sidecar" && hasValue)
+        {
+            options->sidecarPath = args[++i];
+        }
+        else if (arg == "--summaries" && hasValue)
+        {
+            options->summariesPath = args[++i];
+        }
+        else if (arg == "--inspect-summaries" && hasValue)
+        {
+            options->summariesInspectPath = args[++i];
+        }
+        else if ((arg == "--flip-map" || arg == "--lyapunov-map") && hasValue)
+        {
+            options->mapKind = arg == "--flip-map" ? FlipMap_Kind_FlipTime : FlipMap_Kind_Lyapunov;
+            options->mapPath = args[++i];
+        }
+        else if (arg == "--map-region" && hasValue && std::sscanf(args[i + 1], "%f,%f,%f,%f", &options->mapRegion[0], &options->mapRegion[1], &options->mapRegion[2], &options->mapRegion[3]) == 4)
+        {
+            i++;
+        }
+        else if (arg == "--map-size" && hasValue && std::sscanf(args[i + 1], "%ux%u", &options->mapWidth, &options->mapHeight) == 2 && options->mapWidth > 0 && options->mapHeight > 0)
+        {
+            i++;
+        }
+        else if (arg == "--map-seconds" && hasValue)
+        {
+            options->mapSeconds = std::strtof(args[++i], nullptr);
+        }
+        else if (arg == "--map-cache-mb" && hasValue)
+        {
+            options->mapCacheMb = (uint32_t)std::strtoul(args[++i], nullptr, 10);
+        }
+        else if (arg == "--shm-benchmark" && hasValue)
+        {
+            options->shmBenchmarkConsumers = (int)std::min(std::strtoul(args[++i], nullptr, 10), 64ul);
+        }
+        else
+        {
+            // indented options only apply together with the one above them
+            printf("usage: %s [options]\n"
+                "  --headless WxH\n"
+                "  --frames N\n"
+                "  --seconds S\n"
+                "  --capture file.(rgba|y4m|ppm|png)\n"
+                "  --encode-threads N\n"
+                "  --png-uncompressed\n"
+                "  --heatmap\n"
+                "  --heatmap-cpu\n"
+                "  --ensemble N\n"
+                "  --record file.dptr\n"
+                "  --inspect file.dptr\n"
+                "      --at S\n"
+                "  --codec-benchmark file.dptr\n"
+                "  --checkpoint file.dpck\n"
+                "      --checkpoint-every STEPS\n"
+                "      --checkpoint-seconds S\n"
+                "  --restore file.dpck\n"
+                "  --log file.dprl\n"
+                "  --replay file.dprl\n"
+                "  --seed N\n"
+                "  --stream -|fd:N|path\n"
+                "      --stream-format csv|binary\n"
+                "      --stream-every N\n"
+                "  --shm name\n"
+                "      --shm-slots N\n"
+                "  --shm-benchmark CONSUMERS\n"
+                "      --shm-slots N\n"
+                "  --scene file.dps\n"
+                "      --scene-sidecar file.dpsb\n"
+                "  --summaries file.dpsm\n"
+                "  --inspect-summaries file.dpsm\n"
+                "  --flip-map|--lyapunov-map file.pgm\n"
+                "      --map-region A1,A1,A2,A2\n"
+                "      --map-size WxH\n"
+                "      --map-seconds S\n"
+                "      --map-cache-mb N\n", args[0]);
+            return false;
+        }
+    }
+
+    // the window can be resized, a capture needs the fixed size of the headless framebuffer
+    if (options->capturePath && !options->headless)
+    {
+        printf("%s\n", "--capture requires --headless");
+        return false;
+    }
+
+    if (options->sidecarPath && !options->scenePath)
+    {
+        printf("%s\n", "--scene-sidecar requires --scene");
+        return false;
+    }
+
+    if (options->checkpointPath && options->checkpointSteps == 0 && options->checkpointSeconds <= 0.0f)
+        options->checkpointSeconds = s_DefaultCheckpointSeconds;
+
+    // replays run headless until the session ends
+    if (options->replayPath)
+        options->headless = true;
+
+    if (options->headless && !options->replayPath && options->maxFrames == 0 && options->maxSimSeconds <= 0.0f)
+        options->maxFrames = s_HeadlessDefaultFrames;
+
+    return true;
+}
+
+// the null platform has no default framebuffer worth reading, so headless frames go to a texture of the requested size
+struct HeadlessTarget
+{
+    OglsTexture texture;
+    OglsFramebuffer framebuffer;
+};
+
+bool createHeadlessTarget(HeadlessTarget* target, int width, int height)
+{
+    OglsTextureCreateInfo textureCreateInfo{};
+    textureCreateInfo.width = width;
+    textureCreateInfo.height = height;
+    textureCreateInfo.format = Ogls_TextureFormat_RGBA8;
+    textureCreateInfo.filter = Ogls_TextureFilter_Nearest;
+    if (ogls::createTexture(&target->texture, &textureCreateInfo) == Ogls_Result_Failed) { return false; }
+    ogls::labelTexture(target->texture, "headless color texture");
+
+    OglsFramebufferCreateInfo framebufferCreateInfo{};
+    framebufferCreateInfo.colorAttachment = target->texture;
+    if (ogls::createFramebuffer(&target->framebuffer, &framebufferCreateInfo) == Ogls_Result_Failed) { return false; }
+    ogls::labelFramebuffer(target->framebuffer, "headless framebuffer");
+
+    return true;
+}
+
+GLFWwindow* createHeadlessWindow(int width, int height)
+{
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GLFW_TRUE);
+
+    // osmesa renders on the cpu with llvmpipe, egl picks up whatever device driver the node has
+    glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_OSMESA_CONTEXT_API);
+    GLFWwindow* window = glfwCreateWindow(width, height, "double pendulum", NULL, NULL);
+    if (window) { return window; }
+
+    glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_EGL_CONTEXT_API);
+    return glfwCreateWindow(width, height, "double pendulum", NULL, NULL);
+}
+
+void submitCapturedFrame(void* userData, const CaptureFrame* frame)
+{
+    submitEncoderFrame((Encoder*)userData, frame);
+}
+
+// prints what a recorded trajectory holds without opening a window
+int inspectTrajectory(const char* path, double time)
+{
+    TrajectoryReader* reader;
+    if (!openTrajectory(&reader, path))
+    {
+        printf("%s is not a trajectory file\n", path);
+        return -1;
+    }
+
+    TrajectoryParams params = getTrajectoryParams(reader);
+    uint64_t frameCount = getTrajectoryFrameCount(reader);
+    printf("%s: %llu frames%s, masses %g %g, lengths %g %g, gravity %g, time step %g, integrator %u\n", path, (unsigned long long)frameCount,
+        isTrajectoryIndexed(reader) ? "" : " (unfinished, no index)", params.m1, params.m2, params.l1, params.l2, params.g, params.dt, params.integrator);
+
+    if (frameCount > 0)
+    {
+        uint64_t index = time >= 0.0 ? findTrajectoryFrame(reader, time) : frameCount - 1;
+        const TrajectoryFrame* frame = getTrajectoryFrame(reader, index);
+        printf("frame %llu: t %.4f, angles %f %f, angular velocities %f %f\n", (unsigned long long)index, frame->t, frame->a1, frame->a2, frame->av1, frame->av2);
+    }
+
+    closeTrajectory(reader);
+    return 0;
+}
+
+// compresses a recorded trajectory at several error bounds and reports size, speed and the largest error seen
+int benchmarkTrajectoryCodec(const char* path)
+{
+    TrajectoryReader* reader;
+    if (!openTrajectory(&reader, path) || getTrajectoryFrameCount(reader) == 0)
+    {
+        printf("%s is not a trajectory file or has no frames\n", path);
+        return -1;
+    }
+
+    const TrajectoryFrame* frames = getTrajectoryFrame(reader, 0);
+    uint64_t count = getTrajectoryFrameCount(reader);
+    double rawMb = count * sizeof(TrajectoryFrame) / 1.0e6;
+    double period = 2.0 * PI;
+
+    printf("%llu frames, %.1f MB raw\n", (unsigned long long)count, rawMb);
+    printf("%12s %8s %12s %12s %12s %12s\n", "error bound", "ratio", "encode MB/s", "decode MB/s", "angle error", "vel. error");
+
+    std::vector<uint8_t> encoded;
+    std::vector<TrajectoryFrame> decoded;
+    const double errors[] = { 0.0, 1.0e-7, 1.0e-6, 1.0e-5, 1.0e-4, 1.0e-3 };
+    for (double error : errors)
+    {
+        TrajectoryCodecParams params = { error, error, period };
+
+        // best of a few runs, the first also pays for growing the buffers
+        double encodeSeconds = 1.0e9, decodeSeconds = 1.0e9;
+        for (int run = 0; run < 3; run++)
+        {
+            auto start = std::chrono::high_resolution_clock::now();
+            encodeTrajectory(frames, count, &params, &encoded);
+            auto encodedTime = std::chrono::high_resolution_clock::now();
+            decodeTrajectory(encoded.data(), encoded.size(), &decoded);
+            auto decodedTime = std::chrono::high_resolution_clock::now();
+
+            encodeSeconds = std::min(encodeSeconds, std::chrono::duration<double>(encodedTime - start).count());
+            decodeSeconds = std::min(decodeSeconds, std::chrono::duration<double>(decodedTime - encodedTime).count());
+        }
+
+        double angleError = 0.0, velocityError = 0.0;
+        for (uint64_t i = 0; i < count; i++)
+        {
+            double d1 = std::fabs((double)frames[i].a1 - decoded[i].a1), d2 = std::fabs((double)frames[i].a2 - decoded[i].a2);
+            angleError = std::max(angleError, std::max(std::min(d1, period - d1), std::min(d2, period - d2)));
+            velocityError = std::max(velocityError, (double)std::max(std::fabs(frames[i].av1 - decoded[i].av1), std::fabs(frames[i].av2 - decoded[i].av2)));
+        }
+
+        char bound[32];
+        if (error == 0.0) { std::snprintf(bound, sizeof(bound), "lossless"); }
+        else { std::snprintf(bound, sizeof(bound), "%g", error); }
+
+        printf("%12s %8.2f %12.0f %12.0f %12.3g %12.3g\n", bound, (double)count * sizeof(TrajectoryFrame) / encoded.size(),
+            rawMb / encodeSeconds, rawMb / decodeSeconds, angleError, velocityError);
+    }
+
+    closeTrajectory(reader);
+    return 0;
+}
+
+// follows a ring from another process until the last snapshot, checking every one it gets belongs to the
+// sequence number it was read as
+static int followShmRing(const char* name, uint32_t consumer, uint64_t count, int readyFd)
+{
+    ShmRingReader* reader;
+    if (!openShmRingReader(&reader, name)) { return -1; }
+
+    char ready = 1;
+    if (write(readyFd, &ready, 1) != 1) { return -1; }
+    close(readyFd);
+
+    uint64_t sequence = 0, read = 0, overwritten = 0, torn = 0;
+    CheckpointState state;
+    while (sequence < count)
+    {
+        ShmRingRead result = readShmRing(reader, sequence, &state);
+        if (result == ShmRing_Read_NotYet) { continue; }
+
+        if (result == ShmRing_Read_Ok)
+        {
+            if (state.step != sequence || state.time != sequence * (double)state.dt) { torn++; }
+            read++;
+            sequence++;
+            continue;
+        }
+
+        // lapped, carry on half a ring behind the writer rather than at the oldest slot it is about to reuse
+        uint64_t published = getShmRingSequence(reader);
+        uint64_t behind = std::max(getShmRingSlotCount(reader) / 2, 1u);
+        uint64_t next = std::max(sequence + 1, published > behind ? published - behind : 0);
+        overwritten += next - sequence;
+        sequence = next;
+    }
+
+    printf("consumer %u: read %llu, overwritten %llu, torn %llu\n", consumer, (unsigned long long)read,
+        (unsigned long long)overwritten, (unsigned long long)torn);
+    closeShmRingReader(reader);
+    return torn == 0 ? 0 : 1;
+}
+
+// publishes synthetic snapshots into a shared memory ring while forked consumers follow it
+int benchmarkShmRing(uint32_t consumers, uint32_t slots)
+{
+    std::string name = "/doublePendulum-benchmark-" + std::to_string(getpid());
+
+    ShmRingWriterCreateInfo createInfo{};
+    createInfo.name = name.c_str();
+    createInfo.slotSize = sizeof(CheckpointState);
+    createInfo.slotCount = slots;
+
+    ShmRingWriter* writer;
+    if (!createShmRingWriter(&writer, &createInfo))
+    {
+        printf("failed to create the shared memory ring %s!\n", name.c_str());
+        return -1;
+    }
+
+    // each consumer writes a byte once it has the ring open so none of them starts behind
+    int readyPipe[2];
+    if (pipe(readyPipe) != 0)
+    {
+        destroyShmRingWriter(writer);
+        return -1;
+    }
+
+    std::fflush(stdout);
+    std::vector<pid_t> children;
+    for (uint32_t i = 0; i < consumers; i++)
+    {
+        pid_t child = fork();
+        if (child == 0)
+        {
+            close(readyPipe[0]);
+            int result = followShmRing(name.c_str(), i, s_ShmBenchmarkSnapshots, readyPipe[1]);
+            std::fflush(stdout);
+            _exit(result == 0 ? 0 : 1);
+        }
+        if (child > 0) { children.push_back(child); }
+    }
+
+    close(readyPipe[1]);
+    char ready;
+    uint32_t readyCount = 0;
+    while (readyCount < children.size() && read(readyPipe[0], &ready, 1) == 1) { readyCount++; }
+    close(readyPipe[0]);
+
+    CheckpointState state{};
+    state.dt = 0.01f;
+
+    auto start = std::chrono::high_resolution_clock::now();
+    for (uint64_t i = 0; i < s_ShmBenchmarkSnapshots; i++)
+    {
+        state.step = i;
+        state.time = i * (double)state.dt;
+        publishShmRing(writer, &state);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+    bool ok = readyCount == consumers;
+    for (pid_t child : children)
+    {
+        int status = 0;
+        waitpid(child, &status, 0);
+        ok = ok && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    }
+
+    printf("published %llu snapshots of %zu bytes into %u slots with %u consumers, %.1f ns each%s\n", (unsigned long long)s_ShmBenchmarkSnapshots,
+        sizeof(CheckpointState), slots, consumers, seconds * 1.0e9 / s_ShmBenchmarkSnapshots, ok ? "" : ", a consumer failed!");
+
+    destroyShmRingWriter(writer);
+    return ok ? 0 : -1;
+}
+
+// prints the range of every summary column from the index alone, then counts flipped members reading only the
+// flip times of row groups whose range says some member flipped
+int inspectSummaries(const char* path)
+{
+    SummaryReader* reader;
+    if (!openSummaryFile(&reader, path))
+    {
+        printf("%s is not a summary file or is truncated\n", path);
+        return -1;
+    }
+
+    SummaryInfo info = getSummaryInfo(reader);
+    printf("%s: %llu members in %u row groups, %llu steps of %g s, masses %g %g, lengths %g %g, gravity %g\n", path, (unsigned long long)info.rows,
+        info.rowGroups, (unsigned long long)info.steps, info.dt, info.params.m1, info.params.m2, info.params.l1, info.params.l2, info.params.g);
+
+    for (uint32_t column = 0; column < Ensemble_Summary_Count; column++)
+    {
+        float min = INFINITY, max = -INFINITY;
+        for (uint32_t group = 0; group < info.rowGroups; group++)
+        {
+            SummaryColumn chunk = getSummaryColumn(reader, group, (EnsembleSummary)column);
+            min = std::fmin(min, chunk.min);
+            max = std::fmax(max, chunk.max);
+        }
+        printf("%14s %12g %12g\n", getSummaryColumnName((EnsembleSummary)column), min, max);
+    }
+
+    uint64_t flipped = 0;
+    uint32_t groupsRead = 0;
+    for (uint32_t group = 0; group < info.rowGroups; group++)
+    {
+        SummaryColumn chunk = getSummaryColumn(reader, group, Ensemble_Summary_FlipTime);
+        if (chunk.max < 0.0f) { continue; }
+
+        groupsRead++;
+        for (uint32_t i = 0; i < chunk.rows; i++)
+            flipped += chunk.values[i] >= 0.0f;
+    }
+
+    printf("%llu members flipped, %u of %u row groups read to count them\n", (unsigned long long)flipped, groupsRead, info.rowGroups);
+    closeSummaryFile(reader);
+    return 0;
+}
+
+// draws a flip time or lyapunov map of the starting angles as a grayscale image, tiles computed by earlier runs
+// are loaded from the mapcache directory and only the missing ones are simulated
+int writeFlipMapImage(const AppOptions* options)
+{
+    FlipMapParams params{};
+    params.params = { PENDULUM_1_MASS, PENDULUM_2_MASS, PENDULUM_1_LENGTH, PENDULUM_2_LENGTH, GRAVITY_CONSTANT };
+    params.dt = TIME_STEP;
+    params.maxTime = options->mapSeconds;
+
+    if (options->scenePath)
+    {
+        Scene* scene;
+        if (!loadScene(&scene, options->scenePath)) { return -1; }
+
+        const SceneSettings* settings = getSceneSettings(scene);
+        params.params = { settings->m1, settings->m2, settings->l1, settings->l2, settings->g };
+        params.dt = settings->dt;
+        destroyScene(scene);
+    }
+
+    FlipMapView view{};
+    view.a1Min = radians(options->mapRegion[0]); view.a1Max = radians(options->mapRegion[1]);
+    view.a2Min = radians(options->mapRegion[2]); view.a2Max = radians(options->mapRegion[3]);
+    view.width = options->mapWidth;
+    view.height = options->mapHeight;
+
+    TileCache* cache = nullptr;
+    TileCacheCreateInfo cacheCreateInfo{};
+    cacheCreateInfo.directory = "mapcache";
+    cacheCreateInfo.maxBytes = (uint64_t)options->mapCacheMb << 20;
+    if (options->mapCacheMb == 0 || !createTileCache(&cache, &cacheCreateInfo)) { cache = nullptr; }
+
+    auto start = std::chrono::high_resolution_clock::now();
+    std::vector<float> values((size_t)view.width * view.height);
+    FlipMapStats stats{};
+    bool ok = renderFlipMap(cache, options->mapKind, &params, &view, std::max(std::thread::hardware_concurrency(), 1u), values.data(), &stats);
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+    if (!ok)
+    {
+        printf("%s\n", "the map region or time step is empty!");
+        if (cache) { destroyTileCache(cache); }
+        return -1;
+    }
+
+    // flips are bright when early and fade with the log of the time, members that never flipped are black.
+    // lyapunov exponents are scaled to the largest in the view
+    float largest = 0.0f;
+    for (float value : values)
+        largest = std::fmax(largest, value);
+
+    std::vector<uint8_t> pixels(values.size());
+    for (size_t i = 0; i < values.size(); i++)
+    {
+        float value = values[i], shade = 0.0f;
+        if (std::isnan(value)) { shade = 0.0f; }
+        else if (options->mapKind == FlipMap_Kind_FlipTime) { shade = value < 0.0f ? 0.0f : 1.0f - std::log1p(value) / std::log1p(params.maxTime); }
+        else if (largest > 0.0f) { shade = std::clamp(value / largest, 0.0f, 1.0f); }
+        pixels[i] = (uint8_t)std::lround(shade * 255.0f);
+    }
+
+    FILE* file = fopen(options->mapPath, "wb");
+    bool written = file && fprintf(file, "P5\n%u %u\n255\n", view.width, view.height) > 0 && fwrite(pixels.data(), 1, pixels.size(), file) == pixels.size();
+    written = file && fclose(file) == 0 && written;
+
+    printf("%s %s: zoom %u, %u tiles, %u from the cache, %u computed in %.0f ms, %.0f ms in total\n", written ? "wrote" : "failed to write",
+        options->mapPath, stats.zoom, stats.tiles, stats.tilesLoaded, stats.tilesComputed, stats.computeMs, ms);
+
+    if (cache)
+    {
+        TileCacheStats cacheStats = getTileCacheStats(cache);
+        printf("map cache: %llu tiles, %.1f MB, %llu evicted\n", (unsigned long long)cacheStats.tiles, cacheStats.bytes / 1.0e6, (unsigned long long)cacheStats.evicted);
+        destroyTileCache(cache);
+    }
+
+    return written ? 0 : -1;
+}
+
+// writes every member of a scene into a sidecar, which a scene can then load with a single members line
+int writeSceneSidecarFile(const char* scenePath, const char* sidecarPath)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+    Scene* scene;
+    if (!loadScene(&scene, scenePath)) { return -1; }
+    double loadMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+    uint32_t count = getSceneMemberCount(scene);
+    bool ok = writeSceneSidecar(scene, sidecarPath);
+    if (ok) { printf("wrote %u members of %s to %s, the scene took %.0f ms to load\n", count, scenePath, sidecarPath, loadMs); }
+    else { printf("failed to write %s%s!\n", sidecarPath, count == 0 ? ", the scene has no members" : ""); }
+
+    destroyScene(scene);
+    return ok ? 0 : -1;
+}
+
+// the heatmap covers the disk the second bob can reach, which only changes with the lengths
+DensityHeatmap* createAppHeatmap(bool cpu, float l1, float l2, OglsFramebuffer renderTarget)
+{
+    DensityHeatmapCreateInfo createInfo{};
+    createInfo.resolution = s_HeatmapResolution;
+    createInfo.halfExtent = (l1 + l2) * s_HeatmapMargin;
+    createInfo.threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+    createInfo.cpu = cpu;
+    createInfo.renderTarget = renderTarget;
+
+    DensityHeatmap* heatmap = nullptr;
+    if (!createDensityHeatmap(&heatmap, &createInfo))
+        printf("%s\n", "failed to create the density heatmap!");
+
+    return heatmap;
+}
+
+void glfwErrorCallback(int error, const char* description)
+{
+    printf("glfw error 0x%x: %s\n", error, description);
 }
 
 int main(int argv, char** argc)
 {
     GLFWwindow* window;
 
+    AppOptions options;
+    if (!parseAppOptions(argv, argc, &options))
+        return -1;
+
+    if (options.inspectPath)
+        return inspectTrajectory(options.inspectPath, options.inspectTime);
+
+    if (options.benchmarkPath)
+        return benchmarkTrajectoryCodec(options.benchmarkPath);
+
+    if (options.mapPath)
+        return writeFlipMapImage(&options);
+
+    if (options.summariesInspectPath)
+        return inspectSummaries(options.summariesInspectPath);
+
+    if (options.sidecarPath)
+        return writeSceneSidecarFile(options.scenePath, options.sidecarPath);
+
+    if (options.shmBenchmarkConsumers >= 0)
+        return benchmarkShmRing((uint32_t)options.shmBenchmarkConsumers, options.shmSlots);
+
+    Stream* stream = nullptr;
+    if (options.streamTarget)
+    {
+        StreamCreateInfo streamCreateInfo{};
+        streamCreateInfo.target = options.streamTarget;
+        streamCreateInfo.format = options.streamFormat;
+        streamCreateInfo.decimation = options.streamDecimation;
+
+        if (!createStream(&stream, &streamCreateInfo))
+        {
+            printf("failed to open stream %s!\n", options.streamTarget);
+            return -1;
+        }
+
+        // stdout carries the records now, everything else that is printed goes to stderr
+        if (std::strcmp(options.streamTarget, "-") == 0)
+        {
+            std::fflush(stdout);
+            dup2(STDERR_FILENO, STDOUT_FILENO);
+        }
+    }
+
+    glfwSetErrorCallback(glfwErrorCallback);
+    if (options.headless)
+        glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+
     if (!glfwInit())
         return -1;
 
     printf("%s\n", "glfw Initialized");
 
-    window = glfwCreateWindow(800, 600, "double pendulum", NULL, NULL);
+#ifdef OGLS_DEBUG
+    glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GLFW_TRUE);
+#endif
+
+    if (options.headless)
+        window = createHeadlessWindow(options.width, options.height);
+    else
+        window = glfwCreateWindow(options.width, options.height, "double pendulum", NULL, NULL);
     if (!window)
     {
         printf("failed to initialize glfw!");
@@ -192,6 +1258,10 @@ int main(int argv, char** argc)
     glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
     glfwMakeContextCurrent(window);
 
+    // headless runs measure throughput, so frames are never held back for a display
+    if (options.headless)
+        glfwSwapInterval(0);
+
     if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
     {
         printf("failed to initialize glad!");
@@ -200,6 +1270,14 @@ int main(int argv, char** argc)
 
     printf("%s\n", "glad Initialized");
 
+#ifdef OGLS_DEBUG
+    if (ogls::enableDebugOutput(Ogls_DebugSeverity_Low) == Ogls_Result_Success)
+        printf("%s\n", "ogl debug output enabled");
+#endif
+
+    if (ogls::setShaderCacheDirectory("shadercache") == Ogls_Result_Failed)
+        printf("%s\n", "shader binary cache unavailable, compiling shaders from source");
+
     // Setup Dear ImGui context
     IMGUI_CHECKVERSION();
     ImGui::CreateContext();
@@ -214,16 +1292,17 @@ int main(int argv, char** argc)
     // setup opengl buffers
     std::vector<OglsVertexArrayAttribute> attributePtrs =
     {
-        { 0, 2, sizeof(Vertex), Ogls_DataType_Float, (void*)0 },
-        { 1, 3, sizeof(Vertex), Ogls_DataType_Float, (void*)(2 * sizeof(float)) },
+        { 0, 2, sizeof(Vertex), Ogls_DataType_Float, (void*)0, false },
     };
 
 
-    OglsVertexBuffer* vertexBuffer;
+    OglsVertexBuffer vertexBuffer;
     ogls::createVertexBuffer(&vertexBuffer, nullptr, sizeof(Vertex) * s_MaxVertices, Ogls_BufferMode_Dynamic);
+    ogls::labelVertexBuffer(vertexBuffer, "batch vertex buffer");
 
-    OglsIndexBuffer* indexBuffer;
-    ogls::createIndexBuffer(&indexBuffer, nullptr, sizeof(uint32_t) * s_MaxIndices, Ogls_BufferMode_Dynamic);
+    OglsIndexBuffer indexBuffer;
+    ogls::createIndexBuffer(&indexBuffer, nullptr, sizeof(uint16_t) * s_MaxIndices, Ogls_BufferMode_Dynamic, Ogls_DataType_UnsignedShort);
+    ogls::labelIndexBuffer(indexBuffer, "batch index buffer");
 
     OglsVertexArrayCreateInfo vertexArrayCreatInfo{};
     vertexArrayCreatInfo.vertexBuffer = vertexBuffer;
@@ -231,30 +1310,80 @@ int main(int argv, char** argc)
     vertexArrayCreatInfo.pAttributes = attributePtrs.data();
     vertexArrayCreatInfo.attributeCount = attributePtrs.size();
 
-    OglsVertexArray* vertexArray;
+    OglsVertexArray vertexArray;
     ogls::createVertexArray(&vertexArray, &vertexArrayCreatInfo);
+    ogls::labelVertexArray(vertexArray, "batch vertex array");
 
 
-    OglsVertexBuffer* trailVertexBuffer;
+    OglsVertexBuffer trailVertexBuffer;
     ogls::createVertexBuffer(&trailVertexBuffer, nullptr, sizeof(Vertex) * s_MaxTrailVertices, Ogls_BufferMode_Dynamic);
+    ogls::labelVertexBuffer(trailVertexBuffer, "trail vertex buffer");
 
     OglsVertexArrayCreateInfo trailVertexArrayCreatInfo{};
     trailVertexArrayCreatInfo.vertexBuffer = trailVertexBuffer;
-    trailVertexArrayCreatInfo.indexBuffer = nullptr;
+    trailVertexArrayCreatInfo.indexBuffer = {};
     trailVertexArrayCreatInfo.pAttributes = attributePtrs.data();
     trailVertexArrayCreatInfo.attributeCount = attributePtrs.size();
 
-    OglsVertexArray* trailVertexArray;
-    ogls::createVertexArray(&trailVertexArray, &trailVertexArrayCreatInfo);
+    OglsVertexArray trailVertexArray;
+    ogls::createVertexArray(&trailVertexArray, &trailVertexArrayCreatInfo);
+    ogls::labelVertexArray(trailVertexArray, "trail vertex array");
+
+
+    // setup opengl shader
+    OglsShaderCreateInfo shaderCreateInfo{};
+    shaderCreateInfo.vertexSrc = vertexShaderSource;
+    shaderCreateInfo.fragmentSrc = fragmentShaderSource;
+
+    OglsShader shader;
+    ogls::createShaderFromStr(&shader, &shaderCreateInfo);
+    ogls::labelShader(shader, "batch shader");
+
+
+    // setup accumulation trail resources
+    OglsVertexArrayCreateInfo fullscreenVertexArrayCreateInfo{};
+
+    OglsVertexArray fullscreenVertexArray;
+    ogls::createVertexArray(&fullscreenVertexArray, &fullscreenVertexArrayCreateInfo);
+    ogls::labelVertexArray(fullscreenVertexArray, "attribute-less vertex array");
+
+    OglsShaderCreateInfo fadeShaderCreateInfo{};
+    fadeShaderCreateInfo.vertexSrc = fullscreenVertexShaderSource;
+    fadeShaderCreateInfo.fragmentSrc = fadeFragmentShaderSource;
+
+    OglsShader fadeShader;
+    ogls::createShaderFromStr(&fadeShader, &fadeShaderCreateInfo);
+    ogls::labelShader(fadeShader, "trail fade shader");
+
+    OglsShaderCreateInfo compositeShaderCreateInfo{};
+    compositeShaderCreateInfo.vertexSrc = fullscreenVertexShaderSource;
+    compositeShaderCreateInfo.fragmentSrc = compositeFragmentShaderSource;
+
+    OglsShader compositeShader;
+    ogls::createShaderFromStr(&compositeShader, &compositeShaderCreateInfo);
+    ogls::labelShader(compositeShader, "trail composite shader");
+
+    TrailAccumulator trailAccum{};
+
+
+    // setup vertex pulling pendulum resources, only (a1, a2) pairs are uploaded per pendulum
+    OglsVertexBuffer angleBuffer;
+    ogls::createVertexBuffer(&angleBuffer, nullptr, sizeof(OglsVec2) * s_MaxPendulumInstances, Ogls_BufferMode_Dynamic);
+    ogls::labelVertexBuffer(angleBuffer, "pendulum angle buffer");
+
+    OglsTexture angleTexture;
+    ogls::createBufferTexture(&angleTexture, angleBuffer, Ogls_TextureFormat_RG32F);
+    ogls::labelTexture(angleTexture, "pendulum angle buffer texture");
 
+    OglsShaderCreateInfo pendulumShaderCreateInfo{};
+    pendulumShaderCreateInfo.vertexSrc = pendulumVertexShaderSource;
+    pendulumShaderCreateInfo.fragmentSrc = pendulumFragmentShaderSource;
 
-    // setup opengl shader
-    OglsShaderCreateInfo shaderCreateInfo{};
-    shaderCreateInfo.vertexSrc = vertexShaderSource;
-    shaderCreateInfo.fragmentSrc = fragmentShaderSource;
+    OglsShader pendulumShader;
+    ogls::createShaderFromStr(&pendulumShader, &pendulumShaderCreateInfo);
+    ogls::labelShader(pendulumShader, "pendulum shader");
 
-    OglsShader* shader;
-    ogls::createShaderFromStr(&shader, &shaderCreateInfo);
+    std::vector<OglsVec2> pendulumAngles;
 
 
     /*
@@ -296,19 +1425,379 @@ int main(int argv, char** argc)
     batch.vertexBuffer = vertexBuffer;
     batch.indexBuffer = indexBuffer;
     batch.vertexArray = vertexArray;
+    batch.shader = shader;
 
     BatchGroup batchTrail{};
     batchTrail.vertexBuffer = trailVertexBuffer;
     batchTrail.vertexArray = trailVertexArray;
+    batchTrail.shader = shader;
+
+    TrailPath trailPath{};
 
     // imgui settings window
-    bool p_open = false, pressOnce = false, gravityOn = true, pause = false, drawTrailPath = false;
-    float gChange = g, fov = 60.0f, distance = 50.0f;
+    bool p_open = false, pressOnce = false, gravityOn = true, pause = false, drawTrailPath = false, accumulateTrailPath = false, gpuPendulums = true;
+    float gChange = g, fov = 60.0f, distance = 50.0f, trailFade = 0.995f;
+    float lastFov = fov, lastDistance = distance;
     std::string playpause = "play";
+    OglsStateCacheStats lastStateStats{};
+
+    ogls::setProfilerEnabled(true);
+
+    HeadlessTarget headlessTarget{};
+    if (options.headless && !createHeadlessTarget(&headlessTarget, options.width, options.height))
+    {
+        printf("%s\n", "failed to create the headless framebuffer!");
+        glfwTerminate();
+        return -1;
+    }
+
+    Encoder* encoder = nullptr;
+    FrameCapture* capture = nullptr;
+    if (options.capturePath)
+    {
+        EncoderCreateInfo encoderCreateInfo{};
+        encoderCreateInfo.path = options.capturePath;
+        encoderCreateInfo.width = options.width;
+        encoderCreateInfo.height = options.height;
+        encoderCreateInfo.fps = (uint32_t)std::lround(1.0f / dt);
+        encoderCreateInfo.threadCount = options.encodeThreads;
+        encoderCreateInfo.maxQueuedFrames = options.encodeThreads * 2;
+        encoderCreateInfo.pngCompress = options.pngCompress;
+
+        if (!encoderFormatFromPath(options.capturePath, &encoderCreateInfo.format))
+        {
+            printf("unknown capture format %s, use .rgba, .y4m, .ppm or .png\n", options.capturePath);
+            glfwTerminate();
+            return -1;
+        }
+
+        if (!createEncoder(&encoder, &encoderCreateInfo))
+        {
+            printf("failed to open %s for writing!\n", options.capturePath);
+            glfwTerminate();
+            return -1;
+        }
+
+        FrameCaptureCreateInfo captureCreateInfo{};
+        captureCreateInfo.width = options.width;
+        captureCreateInfo.height = options.height;
+        captureCreateInfo.readbackDepth = 3;
+        captureCreateInfo.maxQueuedFrames = 8;
+        captureCreateInfo.write = submitCapturedFrame;
+        captureCreateInfo.userData = encoder;
+
+        if (!createFrameCapture(&capture, &captureCreateInfo))
+        {
+            printf("failed to start capturing to %s!\n", options.capturePath);
+            destroyEncoder(encoder);
+            glfwTerminate();
+            return -1;
+        }
+    }
+
+    DensityHeatmap* heatmap = nullptr;
+    bool drawHeatmap = options.heatmap, heatmapCpu = options.heatmapCpu;
+    float heatmapSaturation = 256.0f;
+
+    Ensemble* ensemble = nullptr;
+    PointSprites* ensembleSprites = nullptr;
+    std::vector<float> ensembleValues;
+    bool drawEnsemble = options.ensembleMembers > 0, ensembleValuesDirty = true;
+    int ensembleMembers = options.ensembleMembers ? (int)options.ensembleMembers : (int)s_DefaultEnsembleMembers;
+    int ensembleValue = Ensemble_Value_InitialAngle, ensembleColormap = PointSprite_Colormap_Viridis;
+    float ensembleSpread = 0.01f, ensemblePointSize = 1.0f;
+    double ensembleCpuMs = 0.0;
+    uint64_t ensembleFrames = 0;
+
+    uint64_t frameCount = 0, simSteps = 0;
+    double simTime = 0.0;
+
+    // drives the randomize buttons, sessions started with the same --seed randomize the same way
+    Random random = { options.seeded ? options.seed : (uint64_t)std::chrono::high_resolution_clock::now().time_since_epoch().count() };
+
+    // everything the physics step reads, restoring it continues the run exactly where the checkpoint was taken
+    auto makeCheckpointState = [&]()
+    {
+        CheckpointState state{};
+        state.step = simSteps;
+        state.time = simTime;
+        state.rngState = random.state;
+        state.integrator = Trajectory_Integrator_SemiImplicitEuler;
+        state.flags = (gravityOn ? Checkpoint_Flag_GravityOn : 0) | (pause ? Checkpoint_Flag_Paused : 0);
+        state.dt = dt;
+        state.m1 = m1; state.m2 = m2;
+        state.l1 = l1; state.l2 = l2;
+        state.g = gChange;
+        state.a1 = a1; state.a2 = a2;
+        state.av1 = av1; state.av2 = av2;
+        state.aa1 = aa1; state.aa2 = aa2;
+        state.ensembleSpread = ensembleSpread;
+        return state;
+    };
+
+    auto applyCheckpointState = [&](const CheckpointState& state)
+    {
+        simSteps = state.step;
+        simTime = state.time;
+        random.state = state.rngState;
+        gravityOn = (state.flags & Checkpoint_Flag_GravityOn) != 0;
+        pause = (state.flags & Checkpoint_Flag_Paused) != 0;
+        dt = state.dt;
+        m1 = state.m1; m2 = state.m2;
+        l1 = state.l1; l2 = state.l2;
+        gChange = state.g;
+        a1 = state.a1; a2 = state.a2;
+        av1 = state.av1; av2 = state.av2;
+        aa1 = state.aa1; aa2 = state.aa2;
+        ensembleSpread = state.ensembleSpread;
+    };
+
+    // a scene replaces the defines above and brings its own ensemble members, a restore still overrides it
+    if (options.scenePath)
+    {
+        auto loadStart = std::chrono::high_resolution_clock::now();
+        Scene* scene;
+        if (!loadScene(&scene, options.scenePath))
+        {
+            glfwTerminate();
+            return -1;
+        }
+
+        const SceneSettings* settings = getSceneSettings(scene);
+        m1 = settings->m1; m2 = settings->m2;
+        l1 = settings->l1; l2 = settings->l2;
+        gChange = settings->g;
+        dt = settings->dt;
+        a1 = settings->a1; a2 = settings->a2;
+        av1 = settings->av1; av2 = settings->av2;
+
+        uint32_t members = getSceneMemberCount(scene);
+        if (members > 0)
+        {
+            EnsembleCreateInfo ensembleCreateInfo{};
+            ensembleCreateInfo.count = members;
+            ensembleCreateInfo.angles = { a1, a2 };
+            ensembleCreateInfo.threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+            if (!createEnsemble(&ensemble, &ensembleCreateInfo)) { ensemble = nullptr; }
+        }
+
+        if (ensemble)
+        {
+            writeSceneMembers(scene, ensemble);
+            drawEnsemble = true;
+            ensembleMembers = (int)members;
+        }
+
+        destroyScene(scene);
+        printf("loaded %s: %u ensemble members in %.0f ms\n", options.scenePath, members,
+            std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - loadStart).count());
+    }
+
+    if (options.restorePath)
+    {
+        CheckpointState state;
+        Ensemble* restored = nullptr;
+        if (!readCheckpoint(options.restorePath, &state, &restored, std::max(std::thread::hardware_concurrency(), 1u)) ||
+            state.integrator != Trajectory_Integrator_SemiImplicitEuler)
+        {
+            printf("%s is not a checkpoint or is damaged!\n", options.restorePath);
+            if (restored) { destroyEnsemble(restored); }
+            glfwTerminate();
+            return -1;
+        }
+
+        applyCheckpointState(state);
+        if (ensemble) { destroyEnsemble(ensemble); }
+        ensemble = restored;
+        drawEnsemble = ensemble != nullptr;
+        if (ensemble) { ensembleMembers = (int)getEnsembleCount(ensemble); }
+
+        printf("restored step %llu (%.2f sim seconds, %u ensemble members) from %s\n", (unsigned long long)simSteps, simTime,
+            ensemble ? getEnsembleCount(ensemble) : 0, options.restorePath);
+    }
+
+    Checkpointer* checkpointer = nullptr;
+    if (options.checkpointPath)
+    {
+        CheckpointerCreateInfo checkpointerCreateInfo{};
+        checkpointerCreateInfo.path = options.checkpointPath;
+
+        if (!createCheckpointer(&checkpointer, &checkpointerCreateInfo))
+        {
+            printf("failed to checkpoint to %s!\n", options.checkpointPath);
+            glfwTerminate();
+            return -1;
+        }
+    }
+
+    auto lastCheckpoint = std::chrono::high_resolution_clock::now();
+
+    // the values settings window edits are logged for, a replay sets them back in the same order
+    auto readReplayValues = [&](float* values)
+    {
+        values[Replay_Field_Mass1] = m1;
+        values[Replay_Field_Mass2] = m2;
+        values[Replay_Field_Length1] = l1;
+        values[Replay_Field_Length2] = l2;
+        values[Replay_Field_Angle1] = a1;
+        values[Replay_Field_Angle2] = a2;
+        values[Replay_Field_AngularVelocity1] = av1;
+        values[Replay_Field_AngularVelocity2] = av2;
+        values[Replay_Field_AngularAcceleration1] = aa1;
+        values[Replay_Field_AngularAcceleration2] = aa2;
+        values[Replay_Field_GravityConstant] = gChange;
+        values[Replay_Field_GravityOn] = gravityOn ? 1.0f : 0.0f;
+        values[Replay_Field_TimeStep] = dt;
+        values[Replay_Field_EnsembleOn] = drawEnsemble ? 1.0f : 0.0f;
+        values[Replay_Field_EnsembleMembers] = (float)ensembleMembers;
+        values[Replay_Field_EnsembleSpread] = ensembleSpread;
+        values[Replay_Field_EnsembleReset] = 0.0f;
+    };
+
+    auto applyReplayEdit = [&](const ReplayEdit& edit)
+    {
+        switch (edit.field)
+        {
+        case Replay_Field_Mass1: m1 = edit.value; break;
+        case Replay_Field_Mass2: m2 = edit.value; break;
+        case Replay_Field_Length1: l1 = edit.value; break;
+        case Replay_Field_Length2: l2 = edit.value; break;
+        case Replay_Field_Angle1: a1 = edit.value; break;
+        case Replay_Field_Angle2: a2 = edit.value; break;
+        case Replay_Field_AngularVelocity1: av1 = edit.value; break;
+        case Replay_Field_AngularVelocity2: av2 = edit.value; break;
+        case Replay_Field_AngularAcceleration1: aa1 = edit.value; break;
+        case Replay_Field_AngularAcceleration2: aa2 = edit.value; break;
+        case Replay_Field_GravityConstant: gChange = edit.value; break;
+        case Replay_Field_GravityOn: gravityOn = edit.value != 0.0f; break;
+        case Replay_Field_TimeStep: dt = edit.value; break;
+        case Replay_Field_EnsembleOn: drawEnsemble = edit.value != 0.0f; break;
+        case Replay_Field_EnsembleMembers: ensembleMembers = (int)edit.value; break;
+        case Replay_Field_EnsembleSpread: ensembleSpread = edit.value; break;
+        case Replay_Field_EnsembleReset:
+            if (ensemble)
+            {
+                resetEnsemble(ensemble, { a1, a2 }, ensembleSpread);
+                ensembleValuesDirty = true;
+            }
+            break;
+        }
+    };
+
+    // appends an edit for every value that is no longer bit for bit what was read into values
+    auto diffReplayValues = [&](float* values, std::vector<ReplayEdit>* edits)
+    {
+        float current[Replay_Field_Count];
+        readReplayValues(current);
+        for (uint32_t i = 0; i < Replay_Field_Count; i++)
+        {
+            if (std::memcmp(&current[i], &values[i], sizeof(float)) == 0) { continue; }
+            edits->push_back({ i, current[i] });
+            values[i] = current[i];
+        }
+    };
+
+    Replay* replay = nullptr;
+    std::vector<ReplayEdit> replayEdits;
+    if (options.replayPath)
+    {
+        if (!openReplay(&replay, options.replayPath))
+        {
+            printf("%s is not a session log!\n", options.replayPath);
+            glfwTerminate();
+            return -1;
+        }
+
+        // a session started from a checkpoint starts from its ensemble too, the rest of the state is in the log
+        const ReplaySession* session = getReplaySession(replay);
+        if (session->state.step > 0 && !options.restorePath)
+            printf("the session started at step %llu, replay it with the --restore it was started with\n", (unsigned long long)session->state.step);
+
+        applyCheckpointState(session->state);
+        drawEnsemble = session->ensembleMembers > 0;
+        if (drawEnsemble) { ensembleMembers = (int)session->ensembleMembers; }
+
+        printf("replaying %llu edits from step %llu to %llu\n", (unsigned long long)getReplayGroupCount(replay),
+            (unsigned long long)session->state.step, (unsigned long long)getReplayEndStep(replay));
+    }
+
+    ReplayLog* replayLog = nullptr;
+    float replayValues[Replay_Field_Count];
+    if (options.logPath)
+    {
+        ReplaySession session{};
+        session.state = makeCheckpointState();
+        session.ensembleMembers = drawEnsemble ? (uint32_t)ensembleMembers : 0;
+
+        if (!createReplayLog(&replayLog, options.logPath, &session))
+        {
+            printf("failed to open %s for writing!\n", options.logPath);
+            glfwTerminate();
+            return -1;
+        }
+    }
+
+    // rewinding shows an earlier step of the pendulum, the state it was rewound from is kept to go back to
+    Timeline* timeline = nullptr;
+    TimelineCreateInfo timelineCreateInfo{};
+    if (!createTimeline(&timeline, &timelineCreateInfo)) { timeline = nullptr; }
+
+    CheckpointState liveState{};
+    uint64_t scrubStep = 0;
+    bool scrubbing = false;
+
+    // the parameters are the ones the run starts with, later edits in the settings window are not part of the file
+    TrajectoryWriter* trajectory = nullptr;
+    if (options.recordPath)
+    {
+        TrajectoryWriterCreateInfo trajectoryCreateInfo{};
+        trajectoryCreateInfo.path = options.recordPath;
+        // g only follows the settings inside the loop, a scene, checkpoint or replay has set gChange and gravityOn by now
+        trajectoryCreateInfo.params = { m1, m2, l1, l2, gravityOn ? gChange : 0.0f, dt, Trajectory_Integrator_SemiImplicitEuler };
+
+        if (!createTrajectoryWriter(&trajectory, &trajectoryCreateInfo))
+        {
+            printf("failed to open %s for writing!\n", options.recordPath);
+            glfwTerminate();
+            return -1;
+        }
+
+        TrajectoryFrame frame = { simTime, a1, a2, av1, av2 };
+        writeTrajectoryFrame(trajectory, &frame);
+    }
+
+    if (stream)
+    {
+        StreamRecord record = { simSteps, simTime, a1, a2, av1, av2 };
+        pushStreamRecord(stream, &record);
+    }
+
+    // other processes follow the state through shared memory, one snapshot per step
+    ShmRingWriter* shmRing = nullptr;
+    if (options.shmName)
+    {
+        ShmRingWriterCreateInfo shmRingCreateInfo{};
+        shmRingCreateInfo.name = options.shmName;
+        shmRingCreateInfo.slotSize = sizeof(CheckpointState);
+        shmRingCreateInfo.slotCount = options.shmSlots;
+
+        if (!createShmRingWriter(&shmRing, &shmRingCreateInfo))
+        {
+            printf("failed to create the shared memory ring %s!\n", options.shmName);
+            glfwTerminate();
+            return -1;
+        }
+
+        CheckpointState state = makeCheckpointState();
+        publishShmRing(shmRing, &state);
+    }
 
     auto timer = std::chrono::high_resolution_clock::now();
 
-    printf("Press the \'c\' key on the keyboard to open the settings\n");
+    if (options.headless)
+        printf("rendering headless at %dx%d\n", options.width, options.height);
+    else
+        printf("Press the \'c\' key on the keyboard to open the settings\n");
 
     while (!glfwWindowShouldClose(window))
     {
@@ -339,47 +1828,277 @@ int main(int argv, char** argc)
         x2 = x1 + l2 * std::sin(a2);
         y2 = y1 - l2 * std::cos(a2);
 
+        // ensemble members share the parameters of the pendulum above and fan out around its angles
+        if (drawEnsemble && (!ensemble || getEnsembleCount(ensemble) != (uint32_t)ensembleMembers))
+        {
+            if (ensemble) { destroyEnsemble(ensemble); }
+
+            EnsembleCreateInfo ensembleCreateInfo{};
+            ensembleCreateInfo.count = (uint32_t)ensembleMembers;
+            ensembleCreateInfo.angles = { a1, a2 };
+            ensembleCreateInfo.spread = ensembleSpread;
+            ensembleCreateInfo.threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+            if (!createEnsemble(&ensemble, &ensembleCreateInfo)) { ensemble = nullptr; drawEnsemble = false; }
+            ensembleValuesDirty = true;
+        }
+        else if (!drawEnsemble && ensemble)
+        {
+            destroyEnsemble(ensemble);
+            ensemble = nullptr;
+        }
+
+        // members that are recreated or reset start their summaries over
+        if (ensemble && options.summariesPath) { trackEnsembleSummaries(ensemble); }
+
+        EnsembleParams ensembleParams = { m1, m2, l1, l2, g };
+
+        // a replay holds the simulation on the step the next group was logged at, as the session was paused there
+        if (replay)
+        {
+            uint64_t nextStep;
+            bool pending = peekReplayStep(replay, &nextStep);
+            if (pending && nextStep < simSteps)
+            {
+                printf("%s does not match the state it is replayed from!\n", options.replayPath);
+                break;
+            }
+
+            // the session ends once the frame after its last edit has set up the ensemble for it
+            if (!pending && simSteps >= getReplayEndStep(replay)) { break; }
+            pause = pending && nextStep == simSteps;
+        }
+
+        // playing from a rewound step continues from it, a recorded or logged run goes back to where it was instead
+        if (scrubbing && !pause)
+        {
+            if (trajectory || replayLog)
+            {
+                applyCheckpointState(liveState);
+                pause = false;
+            }
+            scrubbing = false;
+        }
+
         // if pause, skip caululation and render
         if (!pause) 
         {
-        float daa1 = (-g * (2 * m1 + m2) * std::sin(a1) - m2 * g * std::sin(a1 - 2 * a2) - 2 * std::sin(a1 - a2) * m2 * (av2 * av2 * l2 + av1 * av1 * l1 * std::cos(a1 - a2))) / (l1 * (2 * m1 + m2 - m2 * std::cos(2 * a1 - 2 * a2)));
-        float daa2 = (2 * std::sin(a1 - a2) * (av1 * av1 * l1 * (m1 + m2) + g * (m1 + m2) * std::cos(a1) + av2 * av2 * l2 * m2 * std::cos(a1 - a2))) / (l2 * (2 * m1 + m2 - m2 * std::cos(2 * a1 - 2 * a2)));
-        aa1 = daa1 * dt;
-        aa2 = daa2 * dt;
-        av1 += aa1;
-        av2 += aa2;
-        a1 += av1 * dt;
-        a2 += av2 * dt;
-        a1 = clampAngle(a1);
-        a2 = clampAngle(a2);
+        if (timeline)
+        {
+            CheckpointState state = makeCheckpointState();
+            recordTimelineState(timeline, &state);
+        }
+        stepPendulum(m1, m2, l1, l2, g, dt, a1, a2, av1, av2, aa1, aa2);
+        a1 = wrapAngle(a1);
+        a2 = wrapAngle(a2);
+        simTime += dt;
+        simSteps++;
+        if (trajectory)
+        {
+            TrajectoryFrame frame = { simTime, a1, a2, av1, av2 };
+            writeTrajectoryFrame(trajectory, &frame);
+        }
+        if (stream)
+        {
+            StreamRecord record = { simSteps, simTime, a1, a2, av1, av2 };
+            pushStreamRecord(stream, &record);
+        }
+        if (shmRing)
+        {
+            CheckpointState state = makeCheckpointState();
+            publishShmRing(shmRing, &state);
+        }
+        if (ensemble)
+        {
+            auto stepStart = std::chrono::high_resolution_clock::now();
+            stepEnsemble(ensemble, &ensembleParams, dt);
+            ensembleCpuMs += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - stepStart).count();
+        }
+        if (checkpointer)
+        {
+            // a checkpoint still being written skips this one, the wall clock interval retries on the next step
+            auto now = std::chrono::high_resolution_clock::now();
+            bool due = (options.checkpointSteps && simSteps % options.checkpointSteps == 0) ||
+                (options.checkpointSeconds > 0.0f && std::chrono::duration<float>(now - lastCheckpoint).count() >= options.checkpointSeconds);
+
+            if (due)
+            {
+                CheckpointState state = makeCheckpointState();
+                if (writeCheckpoint(checkpointer, &state, ensemble)) { lastCheckpoint = now; }
+            }
+        }
         }
 
 
 
         // begin render
+        ogls::beginProfilerFrame();
+        ogls::beginProfilerScope("frame");
+        // headless frames go to the offscreen target, whose size the window callbacks never report
+        int fbWidth, fbHeight;
+        if (options.headless)
+        {
+            fbWidth = options.width;
+            fbHeight = options.height;
+        }
+        else { glfwGetFramebufferSize(window, &fbWidth, &fbHeight); }
+
+        ogls::bindFramebuffer(headlessTarget.framebuffer);
+        glViewport(0, 0, fbWidth, fbHeight);
         glClearColor(COLOR_BG, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT);
 
-        int width, height;
-        glfwGetWindowSize(window, &width, &height);
-
-        glm::mat4 proj = glm::perspective(glm::radians(fov), (float)width / (float)height, 0.1f, distance + 10.0f);
+        glm::mat4 proj = glm::perspective(glm::radians(fov), (float)fbWidth / (float)std::max(fbHeight, 1), 0.1f, distance + 10.0f);
         glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 0.0f, distance), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
         glm::mat4 model = glm::mat4(1.0f);
         glm::mat4 camera = proj * view * model;
 
+        // density heatmap, the second bob of the pendulum and of every ensemble member is splatted once per simulated step
+        OGLS_PUSH_DEBUG_GROUP("heatmap");
+        ogls::beginProfilerScope("heatmap");
+        if (drawHeatmap)
+        {
+            if (heatmap && isDensityHeatmapCpu(heatmap) != heatmapCpu)
+            {
+                destroyDensityHeatmap(heatmap);
+                heatmap = nullptr;
+            }
+
+            float heatmapExtent = (l1 + l2) * s_HeatmapMargin;
+            if (!heatmap) { heatmap = createAppHeatmap(heatmapCpu, l1, l2, headlessTarget.framebuffer); }
+            else if (heatmapExtent != getDensityHeatmapHalfExtent(heatmap)) { clearDensityHeatmap(heatmap, heatmapExtent, headlessTarget.framebuffer); }
+
+            if (heatmap)
+            {
+                OglsVec2 bob = { x2, y2 };
+                if (!pause) { splatDensityHeatmap(heatmap, &bob, 1, headlessTarget.framebuffer); }
+                if (!pause && ensemble) { splatDensityHeatmap(heatmap, getEnsemblePositions(ensemble, &ensembleParams), getEnsembleCount(ensemble), headlessTarget.framebuffer); }
+                drawDensityHeatmap(heatmap, camera, heatmapSaturation);
+            }
+        }
+        ogls::endProfilerScope();
+        OGLS_POP_DEBUG_GROUP();
+
+        // ensemble, one point sprite per second bob streamed from a single buffer
+        OGLS_PUSH_DEBUG_GROUP("ensemble");
+        ogls::beginProfilerScope("ensemble");
+        // a scene can hold more members than the slider goes up to, the buffer grows to whatever the ensemble has
+        if (ensemble && ensembleSprites && getPointSpriteMaxPoints(ensembleSprites) < getEnsembleCount(ensemble))
+        {
+            destroyPointSprites(ensembleSprites);
+            ensembleSprites = nullptr;
+        }
+
+        if (ensemble && !ensembleSprites)
+        {
+            PointSpritesCreateInfo spritesCreateInfo{};
+            spritesCreateInfo.maxPoints = std::max(getEnsembleCount(ensemble), s_MaxEnsembleMembers);
+            spritesCreateInfo.colormap = (PointSpriteColormap)ensembleColormap;
+            if (!createPointSprites(&ensembleSprites, &spritesCreateInfo))
+            {
+                printf("could not draw %u ensemble members, turning the ensemble off!\n", spritesCreateInfo.maxPoints);
+                ensembleSprites = nullptr;
+                drawEnsemble = false;
+            }
+            ensembleValuesDirty = true;
+        }
+
+        if (ensemble && ensembleSprites)
+        {
+            auto uploadStart = std::chrono::high_resolution_clock::now();
+            uint32_t members = getEnsembleCount(ensemble);
+            updatePointSpritePositions(ensembleSprites, getEnsemblePositions(ensemble, &ensembleParams), members);
+
+            // initial angles never change, energy does every step
+            if (ensembleValuesDirty || ensembleValue == Ensemble_Value_Energy)
+            {
+                ensembleValues.resize(members);
+                getEnsembleValues(ensemble, (EnsembleValue)ensembleValue, &ensembleParams, ensembleValues.data());
+                updatePointSpriteValues(ensembleSprites, ensembleValues.data(), members);
+                ensembleValuesDirty = false;
+            }
+
+            ensembleCpuMs += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - uploadStart).count();
+            ensembleFrames++;
+
+            drawPointSprites(ensembleSprites, camera, ensemblePointSize);
+        }
+        ogls::endProfilerScope();
+        OGLS_POP_DEBUG_GROUP();
+
         ogls::bindShader(shader);
         glUniformMatrix4fv(glGetUniformLocation(ogls::getShaderId(shader), "u_Camera"), 1, GL_FALSE, glm::value_ptr(camera));
 
         // draw trail path
-        if (drawTrailPath) { drawTrail(&batchTrail, {x2, y2}, {COLOR_TRAIL}); }
+        OGLS_PUSH_DEBUG_GROUP("trail");
+        ogls::beginProfilerScope("trail");
+        if (drawTrailPath && accumulateTrailPath)
+        {
+            resizeTrailAccumulator(&trailAccum, fbWidth, fbHeight);
+
+            // the accumulated trail is in screen space, so it is invalid once the camera moves
+            if (fov != lastFov || distance != lastDistance) { trailAccum.clear = true; }
+
+            if (!pause || trailAccum.clear)
+                accumulateTrail(&trailAccum, &batch, shader, fadeShader, fullscreenVertexArray, headlessTarget.framebuffer, {x2, y2}, {COLOR_TRAIL}, trailFade);
+
+            glViewport(0, 0, fbWidth, fbHeight);
+            compositeTrail(&trailAccum, shader, compositeShader, fullscreenVertexArray);
+        }
+        else if (drawTrailPath)
+        {
+            // size of one pixel on the z = 0 plane the pendulums are drawn on
+            float worldPerPixel = 2.0f * distance * std::tan(glm::radians(fov) * 0.5f) / (float)std::max(fbHeight, 1);
+
+            if (!pause) { pushTrailPoint(&trailPath, {x2, y2}, s_TrailTolerancePixels * worldPerPixel); }
+            drawTrail(&batchTrail, &trailPath, {COLOR_TRAIL});
+        }
+
+        ogls::endProfilerScope();
+        OGLS_POP_DEBUG_GROUP();
+
+        lastFov = fov;
+        lastDistance = distance;
 
         // draw pendulums
-        drawLine(&batch, {0, 0}, {x1, y1}, {COLOR_FG});
-        drawLine(&batch, {x1, y1}, {x2, y2}, {COLOR_FG});
-        drawPoly(&batch, {x1, y1}, {COLOR_FG}, std::clamp(m1 * 0.1f, 0.1f, 2.0f), 32);
-        drawPoly(&batch, {x2, y2}, {COLOR_FG}, std::clamp(m2 * 0.1f, 0.1f, 2.0f), 32);
+        OGLS_PUSH_DEBUG_GROUP("pendulums");
+        ogls::beginProfilerScope("pendulums");
+        if (gpuPendulums)
+        {
+            pendulumAngles.clear();
+            pendulumAngles.push_back({ a1, a2 });
+
+            OglsVec2 radii = { std::clamp(m1 * 0.1f, 0.1f, 2.0f), std::clamp(m2 * 0.1f, 0.1f, 2.0f) };
+            drawPendulumsGpu(pendulumShader, angleBuffer, angleTexture, fullscreenVertexArray, pendulumAngles, { l1, l2 }, radii, {COLOR_FG}, camera);
+            ogls::bindShader(shader);
+        }
+        else
+        {
+            drawLine(&batch, {0, 0}, {x1, y1}, {COLOR_FG});
+            drawLine(&batch, {x1, y1}, {x2, y2}, {COLOR_FG});
+            drawPoly(&batch, {x1, y1}, {COLOR_FG}, std::clamp(m1 * 0.1f, 0.1f, 2.0f), s_PendulumBobSides);
+            drawPoly(&batch, {x2, y2}, {COLOR_FG}, std::clamp(m2 * 0.1f, 0.1f, 2.0f), s_PendulumBobSides);
+        }
+        ogls::endProfilerScope();
+        OGLS_POP_DEBUG_GROUP();
+
+
+        // edits take effect where the settings window would make them, after this frame's step
+        if (replay)
+        {
+            uint64_t nextStep;
+            if (peekReplayStep(replay, &nextStep) && nextStep == simSteps && readReplayEdits(replay, &replayEdits))
+            {
+                for (const ReplayEdit& edit : replayEdits) { applyReplayEdit(edit); }
+            }
+        }
 
+        // rewinding is not an edit, frames spent on a rewound step are left out of the log
+        bool wasScrubbing = scrubbing;
+        if (replayLog && p_open)
+        {
+            readReplayValues(replayValues);
+            replayEdits.clear();
+        }
 
         if(p_open)
         {
@@ -411,6 +2130,55 @@ int main(int argv, char** argc)
             ImGui::Checkbox("gravity", &gravityOn);
             ImGui::SameLine();
             ImGui::Checkbox("trails", &drawTrailPath);
+            ImGui::SameLine();
+            if (ImGui::Checkbox("accumulate trails", &accumulateTrailPath)) { trailAccum.clear = true; }
+            ImGui::SameLine();
+            ImGui::Checkbox("gpu pendulums", &gpuPendulums);
+            if (accumulateTrailPath) { ImGui::SliderFloat("trail fade", &trailFade, 0.9f, 1.0f, "%.4f"); }
+            else if (drawTrailPath) { ImGui::Text("trail vertices: %zu drawn / %zu points", batchTrail.vertices.size(), trailPath.history.size()); }
+
+            ImGui::Checkbox("density heatmap", &drawHeatmap);
+            ImGui::SameLine();
+            ImGui::Checkbox("cpu heatmap", &heatmapCpu);
+            if (drawHeatmap && heatmap)
+            {
+                ImGui::SliderFloat("heatmap saturation", &heatmapSaturation, 1.0f, 65536.0f, "%.0f", ImGuiSliderFlags_Logarithmic);
+                ImGui::Text("heatmap samples: %llu", (unsigned long long)getDensityHeatmapSamples(heatmap));
+            }
+
+            ImGui::Spacing();
+            ImGui::Text("Ensemble:");
+            // the ensemble is not part of a rewound state and edits are not logged while scrubbing, so anything that
+            // recreates or resets it waits until the run is live again
+            ImGui::BeginDisabled(scrubbing);
+            ImGui::Checkbox("ensemble", &drawEnsemble);
+            ImGui::EndDisabled();
+            if (drawEnsemble)
+            {
+                ImGui::BeginDisabled(scrubbing);
+                ImGui::SliderInt("members", &ensembleMembers, 1, (int)s_MaxEnsembleMembers, "%d", ImGuiSliderFlags_Logarithmic);
+                ImGui::SliderFloat("angle spread", &ensembleSpread, 0.0f, 2.0f * PI, "%.4f", ImGuiSliderFlags_Logarithmic);
+                ImGui::EndDisabled();
+                ImGui::SliderFloat("point size", &ensemblePointSize, 1.0f, 16.0f, "%.1f");
+                if (ImGui::Combo("color by", &ensembleValue, "initial angle\0energy\0")) { ensembleValuesDirty = true; }
+                if (ImGui::Combo("colormap", &ensembleColormap, "viridis\0twilight\0") && ensembleSprites) { setPointSpriteColormap(ensembleSprites, (PointSpriteColormap)ensembleColormap); }
+                ImGui::BeginDisabled(scrubbing);
+                bool resetEnsembleClicked = ImGui::Button("reset ensemble");
+                ImGui::EndDisabled();
+                if (resetEnsembleClicked && ensemble)
+                {
+                    // the reset uses the angles and spread as they are now, edits before it in this frame go first
+                    if (replayLog)
+                    {
+                        diffReplayValues(replayValues, &replayEdits);
+                        replayEdits.push_back({ Replay_Field_EnsembleReset, 0.0f });
+                    }
+
+                    resetEnsemble(ensemble, { a1, a2 }, ensembleSpread);
+                    ensembleValuesDirty = true;
+                }
+                ImGui::Text("  - step, positions and upload: %.2f ms per frame", ensembleCpuMs / std::max<uint64_t>(ensembleFrames, 1));
+            }
 
             if (ImGui::Button(playpause.c_str()))
             {
@@ -420,34 +2188,34 @@ int main(int argv, char** argc)
 
             if (ImGui::Button("randomize length"))
             {
-                l1 = 0.1f + (rand() % 50);
-                l2 = 0.1f + (rand() % 50);
+                l1 = 0.1f + randomBelow(&random, 50);
+                l2 = 0.1f + randomBelow(&random, 50);
             }
 
             ImGui::SameLine();
 
             if (ImGui::Button("randomize mass"))
             {
-                m1 = 0.1f + (rand() % 100);
-                m2 = 0.1f + (rand() % 100);
+                m1 = 0.1f + randomBelow(&random, 100);
+                m2 = 0.1f + randomBelow(&random, 100);
             }
 
             ImGui::SameLine();
 
             if (ImGui::Button("randomize angles"))
             {
-                a1 = static_cast<float>(rand()) / (static_cast<float>(RAND_MAX/(2 * PI)));
-                a2 = static_cast<float>(rand()) / (static_cast<float>(RAND_MAX/(2 * PI)));
+                a1 = randomFloat(&random) * (2 * PI);
+                a2 = randomFloat(&random) * (2 * PI);
             }
 
             if (ImGui::Button("randomize"))
             {
-                m1 = 0.1f + (rand() % 100);
-                m2 = 0.1f + (rand() % 100);
-                l1 = 0.1f + (rand() % 50);
-                l2 = 0.1f + (rand() % 50);
-                a1 = static_cast<float>(rand()) / (static_cast<float>(RAND_MAX/(2 * PI)));
-                a2 = static_cast<float>(rand()) / (static_cast<float>(RAND_MAX/(2 * PI)));
+                m1 = 0.1f + randomBelow(&random, 100);
+                m2 = 0.1f + randomBelow(&random, 100);
+                l1 = 0.1f + randomBelow(&random, 50);
+                l2 = 0.1f + randomBelow(&random, 50);
+                a1 = randomFloat(&random) * (2 * PI);
+                a2 = randomFloat(&random) * (2 * PI);
             }
 
             if (ImGui::Button("reset angular velocity"))
@@ -467,6 +2235,9 @@ int main(int argv, char** argc)
             if (ImGui::Button("reset trail path"))
             {
                 batchTrail.vertices.clear();
+                clearTrailPath(&trailPath);
+                trailAccum.clear = true;
+                if (heatmap) { clearDensityHeatmap(heatmap, getDensityHeatmapHalfExtent(heatmap), headlessTarget.framebuffer); }
             }
 
             if (ImGui::Button("reset"))
@@ -482,11 +2253,61 @@ int main(int argv, char** argc)
             ImGui::Spacing();
             ImGui::DragFloat("time step", &dt, 0.001f, 0.0001f, 1.0f, "%.4f");
 
+            uint64_t firstStep, lastStep;
+            if (timeline && getTimelineRange(timeline, &firstStep, &lastStep))
+            {
+                ImGui::Spacing();
+                ImGui::Text("Timeline:");
+
+                // the slider pauses on the step it is dragged to, play continues from there
+                uint64_t shownStep = scrubbing ? scrubStep : simSteps;
+                if (ImGui::SliderScalar("step", ImGuiDataType_U64, &shownStep, &firstStep, &lastStep))
+                {
+                    CheckpointState state;
+                    if (!scrubbing) { liveState = makeCheckpointState(); }
+                    if (getTimelineState(timeline, shownStep, &state))
+                    {
+                        applyCheckpointState(state);
+                        scrubbing = true;
+                        scrubStep = shownStep;
+                        pause = true;
+                    }
+                }
+
+                if (scrubbing)
+                {
+                    ImGui::SameLine();
+                    if (ImGui::Button("back to live"))
+                    {
+                        applyCheckpointState(liveState);
+                        scrubbing = false;
+                    }
+                }
+
+                TimelineStats timelineStats = getTimelineStats(timeline);
+                ImGui::Text("  - %llu keyframes (%zu KB), last rewind stepped %u times in %.3f ms", (unsigned long long)timelineStats.keyframes,
+                    timelineStats.bytes / 1024, timelineStats.lastRebuildSteps, timelineStats.lastRebuildMs);
+            }
+
             ImGui::Spacing();
             ImGui::Text("Camera:");
             ImGui::SliderFloat("FOV", &fov, 10.0f, 90.0f);
             ImGui::DragFloat("scale", &distance, 1.0f, 1.0f, 4096.0f);
 
+            ImGui::Spacing();
+            ImGui::Text("Render:");
+            ImGui::Text("  - gl binds issued: %llu, skipped: %llu", (unsigned long long)lastStateStats.callsIssued, (unsigned long long)lastStateStats.callsSkipped);
+            ImGui::Text("  - direct state access: %s", ogls::isDirectStateAccessEnabled() ? "on" : "off");
+            ImGui::Text("  - shaders loaded from cache: %u, compiled: %u", ogls::getShaderCacheStats().programsLoaded, ogls::getShaderCacheStats().programsCompiled);
+
+            bool profilerEnabled = ogls::isProfilerEnabled();
+            if (ImGui::Checkbox("gpu profiler", &profilerEnabled)) { ogls::setProfilerEnabled(profilerEnabled); }
+            for (uint32_t i = 0; profilerEnabled && i < ogls::getProfilerScopeCount(); i++)
+            {
+                OglsProfilerScopeStats scope = ogls::getProfilerScopeStats(i);
+                ImGui::Text("  %*s- %s: %.3f ms (avg %.3f, max %.3f)", (int)scope.depth * 2, "", scope.name, scope.lastMs, scope.averageMs, scope.maxMs);
+            }
+
             ImGui::Spacing();
             ImGui::Text("Info:");
             ImGui::Text("Double Pendulum rendered in OpenGL");
@@ -494,26 +2315,158 @@ int main(int argv, char** argc)
             ImGui::Text("  - Note: degrees/radians start from 0 at the bottom and increase counter-clockwise");
 
             ImGui::End();
+
+            if (replayLog && !wasScrubbing && !scrubbing)
+            {
+                diffReplayValues(replayValues, &replayEdits);
+                logReplayEdits(replayLog, simSteps, replayEdits.data(), (uint32_t)replayEdits.size());
+            }
         }
 
 
         ImGui::Render();
+        OGLS_PUSH_DEBUG_GROUP("imgui");
+        ogls::beginProfilerScope("imgui");
         ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+        ogls::endProfilerScope();
+        OGLS_POP_DEBUG_GROUP();
+
+        ogls::endProfilerScope();
+        ogls::endProfilerFrame();
+
+        if (capture) { captureFrame(capture, headlessTarget.framebuffer); }
+
+        // imgui restores the bindings it touches, so the ogls state cache stays valid across frames
+        lastStateStats = ogls::getStateCacheStats();
+        ogls::resetStateCacheStats();
 
         glfwSwapBuffers(window);
         glfwPollEvents();
+
+        frameCount++;
+        if (options.headless && ((options.maxFrames && frameCount >= options.maxFrames) || (options.maxSimSeconds > 0.0f && simTime >= options.maxSimSeconds)))
+            break;
+    }
+
+    // a rewound step that was never played from is not where the run is
+    if (scrubbing)
+        applyCheckpointState(liveState);
+
+    if (capture)
+    {
+        finishFrameCapture(capture);
+        finishEncoder(encoder);
+    }
+
+    if (options.headless)
+    {
+        glFinish();
+        double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - timer).count();
+        printf("rendered %llu frames (%.2f sim seconds) in %.3f s, %.1f fps\n", (unsigned long long)frameCount, simTime, seconds, frameCount / seconds);
+
+        for (uint32_t i = 0; i < ogls::getProfilerScopeCount(); i++)
+        {
+            OglsProfilerScopeStats scope = ogls::getProfilerScopeStats(i);
+            printf("  %*sgpu %s: avg %.3f ms, max %.3f ms\n", (int)scope.depth * 2, "", scope.name, scope.averageMs, scope.maxMs);
+        }
+
+        if (ensemble)
+            printf("ensemble of %u members, step, positions and upload %.2f ms per frame\n", getEnsembleCount(ensemble), ensembleCpuMs / std::max<uint64_t>(ensembleFrames, 1));
+
+        if (heatmap)
+            printf("density heatmap splatted %llu samples on the %s\n", (unsigned long long)getDensityHeatmapSamples(heatmap), isDensityHeatmapCpu(heatmap) ? "cpu" : "gpu");
+    }
+
+    if (capture)
+    {
+        FrameCaptureStats captureStats = getFrameCaptureStats(capture);
+        printf("captured %llu frames, wrote %llu, capture cost %.3f ms/frame, readback waits %llu, writer waits %llu\n",
+            (unsigned long long)captureStats.framesCaptured, (unsigned long long)captureStats.framesWritten,
+            captureStats.captureMs / std::max<uint64_t>(captureStats.framesCaptured, 1),
+            (unsigned long long)captureStats.readbackWaits, (unsigned long long)captureStats.queueWaits);
+
+        EncoderStats encoderStats = getEncoderStats(encoder);
+        printf("encoded %llu frames (%.1f MB) on %u threads, encoder full %llu times for %.1f ms, peak queue %u%s\n",
+            (unsigned long long)encoderStats.framesWritten, encoderStats.bytesWritten / 1.0e6, options.encodeThreads,
+            (unsigned long long)encoderStats.submitWaits, encoderStats.submitWaitMs, encoderStats.peakQueuedFrames,
+            encoderStats.failed ? ", some frames failed to write!" : "");
+
+        destroyFrameCapture(capture);
+        destroyEncoder(encoder);
+    }
+
+    if (trajectory)
+    {
+        if (!finishTrajectoryWriter(trajectory)) { printf("failed to write %s!\n", options.recordPath); }
+        else { printf("recorded %llu frames to %s\n", (unsigned long long)getTrajectoryWriterFrameCount(trajectory), options.recordPath); }
+        destroyTrajectoryWriter(trajectory);
+    }
+
+    if (stream)
+    {
+        finishStream(stream);
+        StreamStats streamStats = getStreamStats(stream);
+        printf("streamed %llu of %llu records to %s (%.1f MB), dropped %llu%s\n", (unsigned long long)streamStats.recordsWritten,
+            (unsigned long long)streamStats.recordsKept, options.streamTarget, streamStats.bytesWritten / 1.0e6,
+            (unsigned long long)streamStats.recordsDropped, streamStats.connected ? "" : ", no reader connected");
+        destroyStream(stream);
+    }
+
+    if (shmRing)
+    {
+        printf("published %llu snapshots to %s\n", (unsigned long long)getShmRingWriterSequence(shmRing), options.shmName);
+        destroyShmRingWriter(shmRing);
+    }
+
+    if (replayLog)
+    {
+        if (!finishReplayLog(replayLog, simSteps)) { printf("failed to write %s!\n", options.logPath); }
+        else { printf("logged the session to %s (%llu bytes)\n", options.logPath, (unsigned long long)getReplayLogBytes(replayLog)); }
+        destroyReplayLog(replayLog);
+    }
+
+    // printed with enough digits to compare replays bit for bit
+    if (replay)
+    {
+        printf("replayed to step %llu (%.2f sim seconds), angles %.9g %.9g, angular velocities %.9g %.9g\n", (unsigned long long)simSteps, simTime, a1, a2, av1, av2);
+        closeReplay(replay);
     }
 
+    if (checkpointer)
+    {
+        // the last state always makes it to disk, waiting for a periodic checkpoint still in flight first
+        CheckpointState state = makeCheckpointState();
+        finishCheckpointer(checkpointer);
+        writeCheckpoint(checkpointer, &state, ensemble);
+
+        bool ok = finishCheckpointer(checkpointer);
+        CheckpointerStats checkpointStats = getCheckpointerStats(checkpointer);
+        printf("wrote %llu checkpoints to %s (%.1f MB), skipped %llu, last took %.2f ms to copy and %.1f ms to write%s\n",
+            (unsigned long long)checkpointStats.written, options.checkpointPath, checkpointStats.bytesWritten / 1.0e6,
+            (unsigned long long)checkpointStats.skipped, checkpointStats.snapshotMs, checkpointStats.writeMs, ok ? "" : ", some failed!");
+        destroyCheckpointer(checkpointer);
+    }
+
+    if (options.summariesPath)
+    {
+        if (ensemble && writeSummaryFile(options.summariesPath, ensemble, 0))
+            printf("wrote summaries of %u ensemble members to %s\n", getEnsembleCount(ensemble), options.summariesPath);
+        else
+            printf("no ensemble summaries to write to %s!\n", options.summariesPath);
+    }
+
+    if (timeline) { destroyTimeline(timeline); }
+    if (heatmap) { destroyDensityHeatmap(heatmap); }
+    if (ensembleSprites) { destroyPointSprites(ensembleSprites); }
+    if (ensemble) { destroyEnsemble(ensemble); }
+
+    ogls::disableDebugOutput();
+
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
     ImGui::DestroyContext();
 
-    ogls::destroyShader(shader);
-    ogls::destroyVertexArray(vertexArray);
-    ogls::destroyIndexBuffer(indexBuffer);
-    ogls::destroyVertexBuffer(vertexBuffer);
-    ogls::destroyVertexBuffer(trailVertexBuffer);
-    ogls::destroyVertexArray(trailVertexArray);
+    ogls::destroyAllResources();
 
     glfwTerminate();
     return 0;
@@ -1,36 +1,209 @@
 #include "ogls.h"
 
 #include <stdio.h>
+#include <vector>
+#include <deque>
+#include <string>
+#include <filesystem>
+#include <algorithm>
+#include <random>
 #include <glad/glad.h>
 
-struct OglsVertexBuffer
+struct OglsVertexBufferData
 {
     float* vertices;
     uint32_t id, size, count;
     GLenum bufferMode;
 };
 
-struct OglsIndexBuffer
+struct OglsIndexBufferData
 {
-    uint32_t* indices;
+    void* indices;
     uint32_t id, size, count;
     GLenum bufferMode;
+    OglsDataType indexType;
 };
 
-struct OglsVertexArray
+struct OglsVertexArrayData
 {
     uint32_t id, vboId, iboId;
 };
 
-struct OglsShader
+struct OglsShaderData
 {
     uint32_t id;
 };
 
+struct OglsTextureData
+{
+    uint32_t id, width, height;
+    OglsTextureFormat format;
+    GLenum target;
+};
+
+struct OglsFramebufferData
+{
+    uint32_t id, width, height;
+    OglsTexture colorAttachment;
+};
+
+struct OglsReadbackData
+{
+    uint32_t width, height, size, depth;
+    uint32_t buffers[OGLS_READBACK_MAX_DEPTH];
+    GLsync fences[OGLS_READBACK_MAX_DEPTH];
+    uint32_t head, pending; // head is the next buffer written, the oldest pending one is head - pending
+    bool mapped;
+};
+
+// handles pack a slot index with the slot's generation, the generation is bumped on every remove
+// so a handle kept past its destroy no longer matches and is rejected instead of reading a reused slot
+#define OGLS_HANDLE_INDEX_BITS 20
+#define OGLS_HANDLE_INDEX_MASK ((1u << OGLS_HANDLE_INDEX_BITS) - 1)
+#define OGLS_HANDLE_GENERATION_MASK ((1u << (32 - OGLS_HANDLE_INDEX_BITS)) - 1)
+
+// items are kept dense so iterating a pool touches contiguous memory, slots map a handle to its item
+template<typename T>
+struct OglsPool
+{
+    std::vector<T> items;
+    std::vector<uint32_t> itemSlots;
+    std::vector<uint32_t> slotItems;
+    std::vector<uint32_t> slotGenerations;
+    std::vector<uint32_t> freeSlots;
+};
+
+static OglsPool<OglsVertexBufferData> s_VertexBuffers;
+static OglsPool<OglsIndexBufferData> s_IndexBuffers;
+static OglsPool<OglsVertexArrayData> s_VertexArrays;
+static OglsPool<OglsShaderData> s_Shaders;
+static OglsPool<OglsTextureData> s_Textures;
+static OglsPool<OglsFramebufferData> s_Framebuffers;
+static OglsPool<OglsReadbackData> s_Readbacks;
+
+// shadow of the gl binding state, OGLS_STATE_UNKNOWN forces the next bind to be issued
+#define OGLS_STATE_UNKNOWN UINT32_MAX
+#define OGLS_STATE_MAX_TEXTURE_UNITS 16
+
+struct OglsStateCache
+{
+    uint32_t program;
+    uint32_t vertexArray;
+    uint32_t arrayBuffer;
+    uint32_t elementBuffer; // part of the bound vertex array's state
+    uint32_t copyWriteBuffer;
+    uint32_t framebuffer;
+    uint32_t activeTexture;
+    uint32_t texture2D[OGLS_STATE_MAX_TEXTURE_UNITS];
+    uint32_t textureBuffer[OGLS_STATE_MAX_TEXTURE_UNITS];
+};
+
+static OglsStateCache s_StateCache =
+{
+    OGLS_STATE_UNKNOWN, OGLS_STATE_UNKNOWN, OGLS_STATE_UNKNOWN, OGLS_STATE_UNKNOWN,
+    OGLS_STATE_UNKNOWN, OGLS_STATE_UNKNOWN, OGLS_STATE_UNKNOWN,
+    {}, {}, // filled in when s_StateCacheTexturesValid is first set
+};
+static OglsStateCacheStats s_StateCacheStats{};
+static bool s_StateCacheTexturesValid = false;
+static bool s_DebugOutputEnabled = false;
+static int s_DirectStateAccess = -1; // -1 until the context has been checked for gl 4.5
+
+// program binaries are only valid for the driver that produced them, the header lets a load reject anything else
+#define OGLS_SHADER_CACHE_MAGIC 0x4250474f // "OGPB"
+#define OGLS_SHADER_CACHE_VERSION 1
+
+struct OglsShaderCacheHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t key;
+    uint32_t binaryFormat;
+    uint32_t binaryLength;
+};
+
+// binaries of old drivers and edited shaders are never asked for again, the least recently used go past this size
+#define OGLS_SHADER_CACHE_MAX_BYTES (32ull << 20)
+
+static std::string s_ShaderCacheDirectory;
+static uint64_t s_ShaderCacheTempSuffix;
+static OglsShaderCacheStats s_ShaderCacheStats{};
+
+// a frame's queries are read back OGLS_PROFILER_FRAMES frames later, by then the gpu has normally finished them
+#define OGLS_PROFILER_FRAMES 4
+#define OGLS_PROFILER_MAX_SCOPES 32
+#define OGLS_PROFILER_HISTORY 64
+
+struct OglsProfilerRecord
+{
+    uint32_t scope;
+    uint32_t beginQuery, endQuery;
+};
+
+struct OglsProfilerFrame
+{
+    uint32_t queries[OGLS_PROFILER_MAX_SCOPES * 2];
+    OglsProfilerRecord records[OGLS_PROFILER_MAX_SCOPES];
+    uint32_t recordCount;
+    bool pending;
+};
+
+struct OglsProfilerScope
+{
+    std::string name;
+    uint32_t depth;
+    uint32_t samples;
+    float history[OGLS_PROFILER_HISTORY];
+};
+
+struct OglsProfiler
+{
+    OglsProfilerFrame frames[OGLS_PROFILER_FRAMES];
+    std::deque<OglsProfilerScope> scopes; // a deque so names handed out by getProfilerScopeStats never move
+    uint32_t stack[OGLS_PROFILER_MAX_SCOPES];
+    uint32_t stackDepth;
+    uint32_t frameIndex;
+    bool inFrame;
+    bool queriesCreated;
+    bool enabled;
+};
+
+static OglsProfiler s_Profiler{};
+
 namespace ogls
 {
     static GLenum getOglDataTypeEnum(OglsDataType dataType);
     static GLenum getBufferMode(OglsBufferMode bufferMode);
+    static void getTextureFormat(OglsTextureFormat format, GLint* internalFormat, GLenum* dataFormat, GLenum* dataType);
+    static uint32_t getTextureFormatSize(OglsTextureFormat format);
+    static bool stateChanged(uint32_t* cached, uint32_t value);
+    static uint32_t* getCachedBuffer(GLenum target);
+    static void cacheBindBuffer(GLenum target, uint32_t id);
+    static void cacheBindVertexArray(uint32_t id);
+    static void cacheUseProgram(uint32_t id);
+    static void cacheBindTexture(uint32_t unit, GLenum target, uint32_t id);
+    static void cacheBindFramebuffer(uint32_t id);
+    static void cacheForget(uint32_t* cached, uint32_t id);
+    static const char* getDebugSourceStr(GLenum source);
+    static const char* getDebugTypeStr(GLenum type);
+    static const char* getDebugSeverityStr(GLenum severity);
+    static void APIENTRY debugMessageCallback(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, const GLchar* message, const void*);
+    static void labelObject(GLenum identifier, uint32_t id, const char* label);
+    static bool checkShaderCompile(uint32_t shader, const char* stage);
+    static bool checkProgramLink(uint32_t program);
+    static uint64_t hashShaderSources(OglsShaderCreateInfo* shaderStrings);
+    static std::string getShaderCachePath(uint64_t key);
+    static uint32_t loadProgramBinary(uint64_t key);
+    static void saveProgramBinary(uint32_t program, uint64_t key);
+    static void trimShaderCache();
+    static uint32_t findProfilerScope(const char* name, uint32_t depth);
+    static void collectProfilerFrame(OglsProfilerFrame* frame);
+    static bool useDirectStateAccess();
+    template<typename T> static uint32_t poolAdd(OglsPool<T>* pool, const T& item);
+    template<typename T> static T* poolLookup(OglsPool<T>* pool, uint32_t handle, const char* name);
+    template<typename T> static void poolRemove(OglsPool<T>* pool, uint32_t handle);
+    template<typename T> static void poolClear(OglsPool<T>* pool);
+    static void deleteReadbackObjects(OglsReadbackData* readbackData);
 
     static GLenum getOglDataTypeEnum(OglsDataType dataType)
     {
@@ -55,290 +228,1733 @@ namespace ogls
         {
         case Ogls_BufferMode_Static: { return GL_STATIC_DRAW; }
         case Ogls_BufferMode_Dynamic: { return GL_DYNAMIC_DRAW; }
+        case Ogls_BufferMode_Stream: { return GL_STREAM_DRAW; }
         }
 
         return GL_STATIC_DRAW;
     }
 
-    OglsResult printErrorCodeMsg(const char* file, int line)
+    static void getTextureFormat(OglsTextureFormat format, GLint* internalFormat, GLenum* dataFormat, GLenum* dataType)
     {
-        GLenum err;
-        while((err = glGetError()) != GL_NO_ERROR)
+        switch (format)
         {
-            switch (err)
-            {
-            case GL_INVALID_ENUM: { printf("%s", "ogl error: invalid enum value"); break; }
-            case GL_INVALID_VALUE: { printf("%s", "ogl error: invalid parameter value"); break; }
-            case GL_INVALID_INDEX: { printf("%s", "ogl error: invalid operation, state for a command is invalid for its given parameters"); break; }
-            case GL_STACK_OVERFLOW: { printf("%s", "ogl error: stack overflow, stack pushing operation causes stack overflow"); }
-            case GL_STACK_UNDERFLOW: { printf("%s", "ogl error: stack underflow, stach popping operation occurs while stack is at its lowest point"); break; }
-            case GL_OUT_OF_MEMORY: { printf("%s", "ogl error: out of memory, memory allocation cannot allocate enough memory"); break; }
-            case GL_INVALID_FRAMEBUFFER_OPERATION: { printf("%s", "ogl error: reading or writing to a frambuffer is not complete"); break; }
-            }
+        case Ogls_TextureFormat_RGBA8:   { *internalFormat = GL_RGBA8; *dataFormat = GL_RGBA; *dataType = GL_UNSIGNED_BYTE; return; }
+        case Ogls_TextureFormat_RGBA16F: { *internalFormat = GL_RGBA16F; *dataFormat = GL_RGBA; *dataType = GL_HALF_FLOAT; return; }
+        case Ogls_TextureFormat_RGBA32F: { *internalFormat = GL_RGBA32F; *dataFormat = GL_RGBA; *dataType = GL_FLOAT; return; }
+        case Ogls_TextureFormat_RG32F:   { *internalFormat = GL_RG32F; *dataFormat = GL_RG; *dataType = GL_FLOAT; return; }
+        case Ogls_TextureFormat_R32F:    { *internalFormat = GL_R32F; *dataFormat = GL_RED; *dataType = GL_FLOAT; return; }
         }
 
-        return err == 0 ? Ogls_Result_Success : Ogls_Result_Failed;
+        *internalFormat = GL_RGBA8;
+        *dataFormat = GL_RGBA;
+        *dataType = GL_UNSIGNED_BYTE;
     }
 
-    OglsResult createVertexBuffer(OglsVertexBuffer** vertexBuffer, float* vertices, uint32_t size, OglsBufferMode bufferMode)
+    static uint32_t getTextureFormatSize(OglsTextureFormat format)
     {
-        GLenum vertexBufferMode = getBufferMode(bufferMode);
+        switch (format)
+        {
+        case Ogls_TextureFormat_RGBA8:   { return 4; }
+        case Ogls_TextureFormat_RGBA16F: { return 8; }
+        case Ogls_TextureFormat_RGBA32F: { return 16; }
+        case Ogls_TextureFormat_RG32F:   { return 8; }
+        case Ogls_TextureFormat_R32F:    { return 4; }
+        }
 
-        uint32_t vbo;
-        glGenBuffers(1, &vbo);
-        glBindBuffer(GL_ARRAY_BUFFER, vbo);
-        glBufferData(GL_ARRAY_BUFFER, size, vertices, vertexBufferMode);
-        if (OGLS_CHECK_ERROR() == Ogls_Result_Failed) { return Ogls_Result_Failed; }
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-        *vertexBuffer = new OglsVertexBuffer();
-        OglsVertexBuffer* vertexBufferPtr = *vertexBuffer;
-        vertexBufferPtr->vertices = vertices;
-        vertexBufferPtr->count = size / sizeof(float);
-        vertexBufferPtr->size = size;
-        vertexBufferPtr->id = vbo;
-        vertexBufferPtr->bufferMode = vertexBufferMode;
+        return 4;
+    }
 
-        return Ogls_Result_Success;
+    static bool stateChanged(uint32_t* cached, uint32_t value)
+    {
+        if (*cached == value)
+        {
+            s_StateCacheStats.callsSkipped++;
+            return false;
+        }
+
+        *cached = value;
+        s_StateCacheStats.callsIssued++;
+        return true;
     }
 
-    OglsResult createIndexBuffer(OglsIndexBuffer** indexBuffer, uint32_t* indices, uint32_t size, OglsBufferMode bufferMode)
+    static uint32_t* getCachedBuffer(GLenum target)
     {
-        GLenum indexBufferMode = getBufferMode(bufferMode);
+        switch (target)
+        {
+        case GL_ARRAY_BUFFER:         { return &s_StateCache.arrayBuffer; }
+        case GL_ELEMENT_ARRAY_BUFFER: { return &s_StateCache.elementBuffer; }
+        case GL_COPY_WRITE_BUFFER:    { return &s_StateCache.copyWriteBuffer; }
+        }
 
-        uint32_t ibo;
-        glGenBuffers(1, &ibo);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, size, indices, indexBufferMode);
-        if (OGLS_CHECK_ERROR() == Ogls_Result_Failed) { return Ogls_Result_Failed; }
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-
-        *indexBuffer = new OglsIndexBuffer();
-        OglsIndexBuffer* indexBufferPtr = *indexBuffer;
-        indexBufferPtr->indices = indices;
-        indexBufferPtr->count = size / sizeof(uint32_t);
-        indexBufferPtr->size = size;
-        indexBufferPtr->id = ibo;
-        indexBufferPtr->bufferMode = indexBufferMode;
+        return nullptr;
+    }
 
-        return Ogls_Result_Success;
+    static void cacheBindBuffer(GLenum target, uint32_t id)
+    {
+        if (stateChanged(getCachedBuffer(target), id)) { glBindBuffer(target, id); }
     }
 
-    OglsResult createVertexArray(OglsVertexArray** vertexArray, OglsVertexArrayCreateInfo* createInfo)
+    static void cacheBindVertexArray(uint32_t id)
     {
-        uint32_t vao;
-        glGenVertexArrays(1, &vao);
-        glBindVertexArray(vao);
-        
-        glBindBuffer(GL_ARRAY_BUFFER, createInfo->vertexBuffer->id);
-        glBufferData(GL_ARRAY_BUFFER, createInfo->vertexBuffer->size, createInfo->vertexBuffer->vertices, createInfo->vertexBuffer->bufferMode);
-        if (OGLS_CHECK_ERROR() == Ogls_Result_Failed) { return Ogls_Result_Failed; }
-    
-        if (createInfo->indexBuffer)
+        if (stateChanged(&s_StateCache.vertexArray, id))
         {
-            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, createInfo->indexBuffer->id);
-            glBufferData(GL_ELEMENT_ARRAY_BUFFER, createInfo->indexBuffer->size, createInfo->indexBuffer->indices, createInfo->indexBuffer->bufferMode);
-            if (OGLS_CHECK_ERROR() == Ogls_Result_Failed) { return Ogls_Result_Failed; }
+            glBindVertexArray(id);
+            s_StateCache.elementBuffer = OGLS_STATE_UNKNOWN;
         }
+    }
+
+    static void cacheUseProgram(uint32_t id)
+    {
+        if (stateChanged(&s_StateCache.program, id)) { glUseProgram(id); }
+    }
 
-        for (uint32_t i = 0; i < createInfo->attributeCount; i++)
-        { 
-            glEnableVertexAttribArray(createInfo->pAttributes[i].index);
-            glVertexAttribPointer(
-                createInfo->pAttributes[i].index,
-                createInfo->pAttributes[i].components,
-                getOglDataTypeEnum(createInfo->pAttributes[i].dataType),
-                GL_FALSE,
-                createInfo->pAttributes[i].stride,
-                createInfo->pAttributes[i].offset);
+    static void cacheBindTexture(uint32_t unit, GLenum target, uint32_t id)
+    {
+        if (!s_StateCacheTexturesValid)
+        {
+            for (uint32_t i = 0; i < OGLS_STATE_MAX_TEXTURE_UNITS; i++)
+            {
+                s_StateCache.texture2D[i] = OGLS_STATE_UNKNOWN;
+                s_StateCache.textureBuffer[i] = OGLS_STATE_UNKNOWN;
+            }
+            s_StateCacheTexturesValid = true;
         }
 
-        glBindVertexArray(0);
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+        if (unit >= OGLS_STATE_MAX_TEXTURE_UNITS)
+        {
+            s_StateCache.activeTexture = unit;
+            s_StateCacheStats.callsIssued += 2;
+            glActiveTexture(GL_TEXTURE0 + unit);
+            glBindTexture(target, id);
+            return;
+        }
 
-        *vertexArray = new OglsVertexArray();
-        OglsVertexArray* vertexArrayPtr = *vertexArray;
-        vertexArrayPtr->vboId = createInfo->vertexBuffer->id;
-        if (createInfo->indexBuffer) vertexArrayPtr->iboId = createInfo->indexBuffer->id;
-        vertexArrayPtr->id = vao;
+        uint32_t* cached = target == GL_TEXTURE_BUFFER ? &s_StateCache.textureBuffer[unit] : &s_StateCache.texture2D[unit];
+        if (*cached == id) { s_StateCacheStats.callsSkipped++; return; }
 
-        return Ogls_Result_Success;
+        // binding a unit directly leaves the active texture alone, binding 0 clears every target of the unit
+        if (useDirectStateAccess())
+        {
+            stateChanged(cached, id);
+            glBindTextureUnit(unit, id);
+            if (id == 0) { s_StateCache.texture2D[unit] = 0; s_StateCache.textureBuffer[unit] = 0; }
+            return;
+        }
+
+        if (stateChanged(&s_StateCache.activeTexture, unit)) { glActiveTexture(GL_TEXTURE0 + unit); }
+        stateChanged(cached, id);
+        glBindTexture(target, id);
+    }
+
+    static void cacheBindFramebuffer(uint32_t id)
+    {
+        if (stateChanged(&s_StateCache.framebuffer, id)) { glBindFramebuffer(GL_FRAMEBUFFER, id); }
     }
 
-    OglsResult createShaderFromStr(OglsShader** shader, OglsShaderCreateInfo* shaderStrings)
+    // gl unbinds deleted objects and may hand out their names again, so drop them from the cache
+    static void cacheForget(uint32_t* cached, uint32_t id)
     {
-        uint32_t vertexShader, fragmentShader;
+        if (*cached == id) { *cached = OGLS_STATE_UNKNOWN; }
+    }
 
-        vertexShader = glCreateShader(GL_VERTEX_SHADER);
-        glShaderSource(vertexShader, 1, &shaderStrings->vertexSrc, NULL);
-        glCompileShader(vertexShader);
+    static bool useDirectStateAccess()
+    {
+        if (s_DirectStateAccess < 0)
+            s_DirectStateAccess = GLAD_GL_VERSION_4_5 && glCreateBuffers ? 1 : 0;
 
-        fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-        glShaderSource(fragmentShader, 1, &shaderStrings->fragmentSrc, NULL);
-        glCompileShader(fragmentShader);
+        return s_DirectStateAccess == 1;
+    }
 
-        uint32_t shaderProgram;
-        shaderProgram = glCreateProgram();
-        glAttachShader(shaderProgram, vertexShader);
-        glAttachShader(shaderProgram, fragmentShader);
-        glLinkProgram(shaderProgram);
+    template<typename T>
+    static uint32_t poolAdd(OglsPool<T>* pool, const T& item)
+    {
+        uint32_t slot;
+        if (!pool->freeSlots.empty())
+        {
+            slot = pool->freeSlots.back();
+            pool->freeSlots.pop_back();
+        }
+        else
+        {
+            if (pool->slotItems.size() >= OGLS_HANDLE_INDEX_MASK) { return 0; }
 
-        glDeleteShader(vertexShader);
-        glDeleteShader(fragmentShader);
+            slot = (uint32_t)pool->slotItems.size();
+            pool->slotItems.push_back(0);
+            pool->slotGenerations.push_back(1);
+        }
 
-        *shader = new OglsShader();
-        OglsShader* shaderPtr = *shader;
-        shaderPtr->id = shaderProgram;
+        pool->slotItems[slot] = (uint32_t)pool->items.size();
+        pool->items.push_back(item);
+        pool->itemSlots.push_back(slot);
 
-        return Ogls_Result_Success;
+        // slot indices are stored off by one so no live handle is ever zero
+        return (pool->slotGenerations[slot] << OGLS_HANDLE_INDEX_BITS) | (slot + 1);
     }
 
+    template<typename T>
+    static T* poolLookup(OglsPool<T>* pool, uint32_t handle, const char* name)
+    {
+        uint32_t slot = (handle & OGLS_HANDLE_INDEX_MASK) - 1;
+        uint32_t generation = handle >> OGLS_HANDLE_INDEX_BITS;
+
+        if (!handle || slot >= pool->slotGenerations.size() || pool->slotGenerations[slot] != generation)
+        {
+            printf("ogls error: invalid or stale %s handle 0x%x\n", name, handle);
+            return nullptr;
+        }
+
+        return &pool->items[pool->slotItems[slot]];
+    }
 
-    float* getVertexBufferVertices(OglsVertexBuffer* vertexBuffer)
+    template<typename T>
+    static void poolRemove(OglsPool<T>* pool, uint32_t handle)
     {
-        return vertexBuffer->vertices;
+        uint32_t slot = (handle & OGLS_HANDLE_INDEX_MASK) - 1;
+        uint32_t item = pool->slotItems[slot];
+
+        // swap the last item into the hole to keep the array dense
+        uint32_t last = (uint32_t)pool->items.size() - 1;
+        if (item != last)
+        {
+            pool->items[item] = pool->items[last];
+            pool->itemSlots[item] = pool->itemSlots[last];
+            pool->slotItems[pool->itemSlots[item]] = item;
+        }
+        pool->items.pop_back();
+        pool->itemSlots.pop_back();
+
+        // generation 0 is skipped so a recycled slot never hands out a zero handle
+        uint32_t generation = (pool->slotGenerations[slot] + 1) & OGLS_HANDLE_GENERATION_MASK;
+        pool->slotGenerations[slot] = generation ? generation : 1;
+        pool->freeSlots.push_back(slot);
     }
 
-    uint32_t getVertexBufferCount(OglsVertexBuffer* vertexBuffer)
+    OglsResult setDirectStateAccess(bool enabled)
     {
-        return vertexBuffer->count;
+        if (enabled && !(GLAD_GL_VERSION_4_5 && glCreateBuffers)) { return Ogls_Result_Failed; }
+
+        s_DirectStateAccess = enabled ? 1 : 0;
+        return Ogls_Result_Success;
     }
 
-    uint32_t getVertexBufferSize(OglsVertexBuffer* vertexBuffer)
+    bool isDirectStateAccessEnabled()
     {
-        return vertexBuffer->size;
+        return useDirectStateAccess();
     }
 
-    uint32_t getVertexBufferId(OglsVertexBuffer* vertexBuffer)
+    void invalidateStateCache()
     {
-        return vertexBuffer->id;
+        s_StateCache.program = OGLS_STATE_UNKNOWN;
+        s_StateCache.vertexArray = OGLS_STATE_UNKNOWN;
+        s_StateCache.arrayBuffer = OGLS_STATE_UNKNOWN;
+        s_StateCache.elementBuffer = OGLS_STATE_UNKNOWN;
+        s_StateCache.copyWriteBuffer = OGLS_STATE_UNKNOWN;
+        s_StateCache.framebuffer = OGLS_STATE_UNKNOWN;
+        s_StateCache.activeTexture = OGLS_STATE_UNKNOWN;
+        s_StateCacheTexturesValid = false;
     }
 
-    uint32_t* getIndexBufferIndices(OglsIndexBuffer* indexBuffer)
+    OglsStateCacheStats getStateCacheStats()
     {
-        return indexBuffer->indices;
+        return s_StateCacheStats;
     }
 
-    uint32_t getIndexBufferCount(OglsIndexBuffer* indexBuffer)
+    void resetStateCacheStats()
     {
-        return indexBuffer->count;
+        s_StateCacheStats = {};
     }
 
-    uint32_t getIndexBufferSize(OglsIndexBuffer* indexBuffer)
+    static const char* getDebugSourceStr(GLenum source)
     {
-        return indexBuffer->size;
+        switch (source)
+        {
+        case GL_DEBUG_SOURCE_API:             { return "api"; }
+        case GL_DEBUG_SOURCE_WINDOW_SYSTEM:   { return "window system"; }
+        case GL_DEBUG_SOURCE_SHADER_COMPILER: { return "shader compiler"; }
+        case GL_DEBUG_SOURCE_THIRD_PARTY:     { return "third party"; }
+        case GL_DEBUG_SOURCE_APPLICATION:     { return "application"; }
+        }
+
+        return "other";
     }
 
-    uint32_t getVertexBufferId(OglsIndexBuffer* indexBuffer)
+    static const char* getDebugTypeStr(GLenum type)
     {
-        return indexBuffer->id;
+        switch (type)
+        {
+        case GL_DEBUG_TYPE_ERROR:               { return "error"; }
+        case GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR: { return "deprecated behavior"; }
+        case GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR:  { return "undefined behavior"; }
+        case GL_DEBUG_TYPE_PORTABILITY:         { return "portability"; }
+        case GL_DEBUG_TYPE_PERFORMANCE:         { return "performance"; }
+        case GL_DEBUG_TYPE_MARKER:              { return "marker"; }
+        }
+
+        return "other";
     }
 
-    uint32_t getVertexArrayId(OglsVertexArray* vertexArray)
+    static const char* getDebugSeverityStr(GLenum severity)
     {
-        return vertexArray->id;
+        switch (severity)
+        {
+        case GL_DEBUG_SEVERITY_HIGH:   { return "high"; }
+        case GL_DEBUG_SEVERITY_MEDIUM: { return "medium"; }
+        case GL_DEBUG_SEVERITY_LOW:    { return "low"; }
+        }
+
+        return "notification";
     }
 
-    uint32_t getShaderId(OglsShader* shader)
+    // may be called from a driver thread, so it only formats and prints
+    static void APIENTRY debugMessageCallback(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, const GLchar* message, const void*)
     {
-        return shader->id;
+        printf("ogl %s [%s, %s, id %u]: %.*s\n", getDebugTypeStr(type), getDebugSeverityStr(severity), getDebugSourceStr(source), id, (int)length, message);
     }
 
+    static void labelObject(GLenum identifier, uint32_t id, const char* label)
+    {
+        if (!s_DebugOutputEnabled) { return; }
+
+        glObjectLabel(identifier, id, -1, label);
+    }
 
-    void bindVertexBuffer(OglsVertexBuffer* vertexBuffer)
+    OglsResult printErrorCodeMsg(const char* file, int line)
     {
-        if (!vertexBuffer)
+        // gl still raises its error flags with debug output on, they are polled either way so callers see the failure.
+        // debugMessageCallback has already printed those errors with more detail than the flags carry
+        GLenum err, lastErr = GL_NO_ERROR;
+        while((err = glGetError()) != GL_NO_ERROR)
         {
-            glBindBuffer(GL_ARRAY_BUFFER, 0);
-            return;
+            lastErr = err;
+            if (s_DebugOutputEnabled) { continue; }
+
+            switch (err)
+            {
+            case GL_INVALID_ENUM: { printf("%s:%d: %s\n", file, line, "ogl error: invalid enum value"); break; }
+            case GL_INVALID_VALUE: { printf("%s:%d: %s\n", file, line, "ogl error: invalid parameter value"); break; }
+            case GL_INVALID_OPERATION: { printf("%s:%d: %s\n", file, line, "ogl error: invalid operation, state for a command is invalid for its given parameters"); break; }
+            case GL_STACK_OVERFLOW: { printf("%s:%d: %s\n", file, line, "ogl error: stack overflow, stack pushing operation causes stack overflow"); break; }
+            case GL_STACK_UNDERFLOW: { printf("%s:%d: %s\n", file, line, "ogl error: stack underflow, stach popping operation occurs while stack is at its lowest point"); break; }
+            case GL_OUT_OF_MEMORY: { printf("%s:%d: %s\n", file, line, "ogl error: out of memory, memory allocation cannot allocate enough memory"); break; }
+            case GL_INVALID_FRAMEBUFFER_OPERATION: { printf("%s:%d: %s\n", file, line, "ogl error: reading or writing to a frambuffer is not complete"); break; }
+            default: { printf("%s:%d: ogl error: unknown error 0x%x\n", file, line, err); break; }
+            }
         }
 
-        glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer->id);
+        return lastErr == GL_NO_ERROR ? Ogls_Result_Success : Ogls_Result_Failed;
     }
 
-    void bindIndexBuffer(OglsIndexBuffer* indexBuffer)
+    OglsResult enableDebugOutput(OglsDebugSeverity minSeverity)
     {
-        if (!indexBuffer)
-        {
-            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-            return;
-        }
+        if (!GLAD_GL_VERSION_4_3 || !glDebugMessageCallback) { return Ogls_Result_Failed; }
+
+        glEnable(GL_DEBUG_OUTPUT);
+        glDebugMessageCallback(debugMessageCallback, nullptr);
 
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer->id);
+        GLenum severities[] = { GL_DEBUG_SEVERITY_NOTIFICATION, GL_DEBUG_SEVERITY_LOW, GL_DEBUG_SEVERITY_MEDIUM, GL_DEBUG_SEVERITY_HIGH };
+        for (uint32_t i = 0; i < 4; i++)
+            glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, severities[i], 0, nullptr, i >= (uint32_t)minSeverity ? GL_TRUE : GL_FALSE);
+
+        // debug group push/pop notifications are only interesting to frame debuggers
+        glDebugMessageControl(GL_DONT_CARE, GL_DEBUG_TYPE_PUSH_GROUP, GL_DONT_CARE, 0, nullptr, GL_FALSE);
+        glDebugMessageControl(GL_DONT_CARE, GL_DEBUG_TYPE_POP_GROUP, GL_DONT_CARE, 0, nullptr, GL_FALSE);
+
+        s_DebugOutputEnabled = true;
+        return Ogls_Result_Success;
     }
 
-    void bindVertexArray(OglsVertexArray* vertexArray)
+    void disableDebugOutput()
     {
-        if (!vertexArray)
-        {
-            glBindVertexArray(0);
-            return;
-        }
+        if (!s_DebugOutputEnabled) { return; }
 
-        glBindVertexArray(vertexArray->id);
+        glDisable(GL_DEBUG_OUTPUT);
+        glDebugMessageCallback(nullptr, nullptr);
+        s_DebugOutputEnabled = false;
     }
 
-    void bindShader(OglsShader* shader)
+    void pushDebugGroup(const char* name, const char* file, int line)
     {
-        glUseProgram(shader->id);
+        if (!s_DebugOutputEnabled) { return; }
+
+        char message[256];
+        int length = snprintf(message, sizeof(message), "%s (%s:%d)", name, file, line);
+        glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 0, length < (int)sizeof(message) ? length : (int)sizeof(message) - 1, message);
     }
 
-    void bindVertexBufferSubData(OglsVertexBuffer* vertexBuffer, uint32_t size, uint32_t offset, float* data)
+    void popDebugGroup()
     {
-        glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer->id);
-        glBufferSubData(GL_ARRAY_BUFFER, offset, size, data);
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        if (!s_DebugOutputEnabled) { return; }
+
+        glPopDebugGroup();
     }
-    
-    void bindIndexBufferSubData(OglsIndexBuffer* indexBuffer, uint32_t size, uint32_t offset, uint32_t* data)
+
+    void labelVertexBuffer(OglsVertexBuffer vertexBuffer, const char* label)
     {
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer->id);
-        glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, offset, size, data);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+        OglsVertexBufferData* vertexBufferData = poolLookup(&s_VertexBuffers, vertexBuffer.handle, "vertex buffer");
+        if (!vertexBufferData) { return; }
+
+        labelObject(GL_BUFFER, vertexBufferData->id, label);
     }
 
-    void destroyVertexBuffer(OglsVertexBuffer* vertexBuffer)
+    void labelIndexBuffer(OglsIndexBuffer indexBuffer, const char* label)
     {
-        glDeleteBuffers(1, &vertexBuffer->id);
-        delete vertexBuffer;
+        OglsIndexBufferData* indexBufferData = poolLookup(&s_IndexBuffers, indexBuffer.handle, "index buffer");
+        if (!indexBufferData) { return; }
+
+        labelObject(GL_BUFFER, indexBufferData->id, label);
     }
 
-    void destroyIndexBuffer(OglsIndexBuffer* indexBuffer)
+    void labelVertexArray(OglsVertexArray vertexArray, const char* label)
     {
-        glDeleteBuffers(1, &indexBuffer->id);
-        delete indexBuffer;
+        OglsVertexArrayData* vertexArrayData = poolLookup(&s_VertexArrays, vertexArray.handle, "vertex array");
+        if (!vertexArrayData) { return; }
+
+        labelObject(GL_VERTEX_ARRAY, vertexArrayData->id, label);
     }
 
-    void destroyVertexArray(OglsVertexArray* vertexArray)
+    void labelShader(OglsShader shader, const char* label)
     {
-        glDeleteVertexArrays(1, &vertexArray->id);
-        delete vertexArray;
+        OglsShaderData* shaderData = poolLookup(&s_Shaders, shader.handle, "shader");
+        if (!shaderData) { return; }
+
+        labelObject(GL_PROGRAM, shaderData->id, label);
     }
 
-    void destroyShader(OglsShader* shader)
+    void labelTexture(OglsTexture texture, const char* label)
     {
-        glDeleteShader(shader->id);
-        delete shader;
+        OglsTextureData* textureData = poolLookup(&s_Textures, texture.handle, "texture");
+        if (!textureData) { return; }
+
+        labelObject(GL_TEXTURE, textureData->id, label);
     }
 
-    void renderDraw(uint32_t first, uint32_t count)
+    void labelFramebuffer(OglsFramebuffer framebuffer, const char* label)
     {
-        glDrawArrays(GL_TRIANGLES, first, count);
+        OglsFramebufferData* framebufferData = poolLookup(&s_Framebuffers, framebuffer.handle, "framebuffer");
+        if (!framebufferData) { return; }
+
+        labelObject(GL_FRAMEBUFFER, framebufferData->id, label);
     }
 
-    void renderDrawIndex(uint32_t count)
+    OglsResult createVertexBuffer(OglsVertexBuffer* vertexBuffer, float* vertices, uint32_t size, OglsBufferMode bufferMode)
     {
-        glDrawElements(GL_TRIANGLES, count, GL_UNSIGNED_INT, 0);
+        GLenum vertexBufferMode = getBufferMode(bufferMode);
+
+        uint32_t vbo;
+        if (useDirectStateAccess())
+        {
+            glCreateBuffers(1, &vbo);
+            glNamedBufferData(vbo, size, vertices, vertexBufferMode);
+        }
+        else
+        {
+            glGenBuffers(1, &vbo);
+            cacheBindBuffer(GL_ARRAY_BUFFER, vbo);
+            glBufferData(GL_ARRAY_BUFFER, size, vertices, vertexBufferMode);
+        }
+        if (OGLS_CHECK_ERROR() == Ogls_Result_Failed)
+        {
+            cacheForget(&s_StateCache.arrayBuffer, vbo);
+            glDeleteBuffers(1, &vbo);
+            return Ogls_Result_Failed;
+        }
+
+        OglsVertexBufferData vertexBufferData{};
+        vertexBufferData.vertices = vertices;
+        vertexBufferData.count = size / sizeof(float);
+        vertexBufferData.size = size;
+        vertexBufferData.id = vbo;
+        vertexBufferData.bufferMode = vertexBufferMode;
+
+        vertexBuffer->handle = poolAdd(&s_VertexBuffers, vertexBufferData);
+        if (!vertexBuffer->handle)
+        {
+            printf("%s\n", "ogls error: vertex buffer pool is full");
+            cacheForget(&s_StateCache.arrayBuffer, vbo);
+            glDeleteBuffers(1, &vbo);
+            return Ogls_Result_Failed;
+        }
+
+        return Ogls_Result_Success;
     }
 
-    void renderDrawMode(uint32_t mode, uint32_t first, uint32_t count)
+    OglsResult createIndexBuffer(OglsIndexBuffer* indexBuffer, void* indices, uint32_t size, OglsBufferMode bufferMode, OglsDataType indexType)
     {
-        glDrawArrays(mode, first, count);
+        GLenum indexBufferMode = getBufferMode(bufferMode);
+
+        uint32_t ibo;
+        if (useDirectStateAccess())
+        {
+            glCreateBuffers(1, &ibo);
+            glNamedBufferData(ibo, size, indices, indexBufferMode);
+        }
+        else
+        {
+            // uploads go through the copy write target so the bound vertex array's element buffer is left alone
+            glGenBuffers(1, &ibo);
+            cacheBindBuffer(GL_COPY_WRITE_BUFFER, ibo);
+            glBufferData(GL_COPY_WRITE_BUFFER, size, indices, indexBufferMode);
+        }
+        if (OGLS_CHECK_ERROR() == Ogls_Result_Failed)
+        {
+            cacheForget(&s_StateCache.copyWriteBuffer, ibo);
+            glDeleteBuffers(1, &ibo);
+            return Ogls_Result_Failed;
+        }
+
+        OglsIndexBufferData indexBufferData{};
+        indexBufferData.indices = indices;
+        indexBufferData.count = size / (indexType == Ogls_DataType_UnsignedShort ? sizeof(uint16_t) : sizeof(uint32_t));
+        indexBufferData.size = size;
+        indexBufferData.id = ibo;
+        indexBufferData.bufferMode = indexBufferMode;
+        indexBufferData.indexType = indexType;
+
+        indexBuffer->handle = poolAdd(&s_IndexBuffers, indexBufferData);
+        if (!indexBuffer->handle)
+        {
+            printf("%s\n", "ogls error: index buffer pool is full");
+            cacheForget(&s_StateCache.copyWriteBuffer, ibo);
+            glDeleteBuffers(1, &ibo);
+            return Ogls_Result_Failed;
+        }
+
+        return Ogls_Result_Success;
     }
-    
-    void renderDrawIndexMode(uint32_t mode, uint32_t count)
+
+    OglsResult createVertexArray(OglsVertexArray* vertexArray, OglsVertexArrayCreateInfo* createInfo)
+    {
+        // the buffers already hold their data, a vertex array only records where to source it from.
+        // a vertex array without a vertex buffer is valid for attribute-less draws (e.g. fullscreen passes)
+        uint32_t vboId = 0, iboId = 0;
+        if (createInfo->vertexBuffer.handle)
+        {
+            OglsVertexBufferData* vertexBufferData = poolLookup(&s_VertexBuffers, createInfo->vertexBuffer.handle, "vertex buffer");
+            if (!vertexBufferData) { return Ogls_Result_Failed; }
+            vboId = vertexBufferData->id;
+        }
+        if (createInfo->indexBuffer.handle)
+        {
+            OglsIndexBufferData* indexBufferData = poolLookup(&s_IndexBuffers, createInfo->indexBuffer.handle, "index buffer");
+            if (!indexBufferData) { return Ogls_Result_Failed; }
+            iboId = indexBufferData->id;
+        }
+
+        uint32_t vao;
+
+        if (useDirectStateAccess())
+        {
+            glCreateVertexArrays(1, &vao);
+
+            for (uint32_t i = 0; i < createInfo->attributeCount && vboId; i++)
+            {
+                // one binding point per attribute keeps the per attribute stride and offset of glVertexAttribPointer
+                OglsVertexArrayAttribute* attribute = &createInfo->pAttributes[i];
+                glVertexArrayVertexBuffer(vao, i, vboId, (GLintptr)attribute->offset, attribute->stride);
+                glVertexArrayAttribFormat(vao, attribute->index, attribute->components, getOglDataTypeEnum(attribute->dataType), attribute->normalized ? GL_TRUE : GL_FALSE, 0);
+                glVertexArrayAttribBinding(vao, attribute->index, i);
+                glEnableVertexArrayAttrib(vao, attribute->index);
+            }
+
+            if (iboId) { glVertexArrayElementBuffer(vao, iboId); }
+            if (OGLS_CHECK_ERROR() == Ogls_Result_Failed) { glDeleteVertexArrays(1, &vao); return Ogls_Result_Failed; }
+        }
+        else
+        {
+            glGenVertexArrays(1, &vao);
+            cacheBindVertexArray(vao);
+
+            if (vboId) { cacheBindBuffer(GL_ARRAY_BUFFER, vboId); }
+            if (iboId) { cacheBindBuffer(GL_ELEMENT_ARRAY_BUFFER, iboId); }
+
+            for (uint32_t i = 0; i < createInfo->attributeCount; i++)
+            {
+                glEnableVertexAttribArray(createInfo->pAttributes[i].index);
+                glVertexAttribPointer(
+                    createInfo->pAttributes[i].index,
+                    createInfo->pAttributes[i].components,
+                    getOglDataTypeEnum(createInfo->pAttributes[i].dataType),
+                    createInfo->pAttributes[i].normalized ? GL_TRUE : GL_FALSE,
+                    createInfo->pAttributes[i].stride,
+                    createInfo->pAttributes[i].offset);
+            }
+
+            cacheBindVertexArray(0);
+            if (OGLS_CHECK_ERROR() == Ogls_Result_Failed) { glDeleteVertexArrays(1, &vao); return Ogls_Result_Failed; }
+        }
+
+        OglsVertexArrayData vertexArrayData{};
+        vertexArrayData.id = vao;
+        vertexArrayData.vboId = vboId;
+        vertexArrayData.iboId = iboId;
+
+        vertexArray->handle = poolAdd(&s_VertexArrays, vertexArrayData);
+        if (!vertexArray->handle)
+        {
+            printf("%s\n", "ogls error: vertex array pool is full");
+            cacheForget(&s_StateCache.vertexArray, vao);
+            glDeleteVertexArrays(1, &vao);
+            return Ogls_Result_Failed;
+        }
+
+        return Ogls_Result_Success;
+    }
+
+    static bool checkShaderCompile(uint32_t shader, const char* stage)
+    {
+        GLint status;
+        glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+        if (status == GL_TRUE) { return true; }
+
+        GLint length = 0;
+        glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &length);
+        std::string log(length > 0 ? length : 1, '\0');
+        glGetShaderInfoLog(shader, (GLsizei)log.size(), NULL, &log[0]);
+        printf("ogls error: %s shader failed to compile\n%s\n", stage, log.c_str());
+        return false;
+    }
+
+    static bool checkProgramLink(uint32_t program)
+    {
+        GLint status;
+        glGetProgramiv(program, GL_LINK_STATUS, &status);
+        if (status == GL_TRUE) { return true; }
+
+        GLint length = 0;
+        glGetProgramiv(program, GL_INFO_LOG_LENGTH, &length);
+        std::string log(length > 0 ? length : 1, '\0');
+        glGetProgramInfoLog(program, (GLsizei)log.size(), NULL, &log[0]);
+        printf("ogls error: shader program failed to link\n%s\n", log.c_str());
+        return false;
+    }
+
+    static uint64_t hashShaderSources(OglsShaderCreateInfo* shaderStrings)
+    {
+        // fnv-1a over the driver identity and both sources, a driver update changes the key and misses the cache
+        const char* parts[] =
+        {
+            (const char*)glGetString(GL_VENDOR),
+            (const char*)glGetString(GL_RENDERER),
+            (const char*)glGetString(GL_VERSION),
+            shaderStrings->vertexSrc,
+            shaderStrings->fragmentSrc,
+        };
+
+        uint64_t hash = 14695981039346656037ull;
+        for (const char* part : parts)
+        {
+            for (const char* c = part ? part : ""; *c; c++)
+            {
+                hash ^= (uint8_t)*c;
+                hash *= 1099511628211ull;
+            }
+
+            // separator so moving text between parts changes the hash
+            hash ^= 0xff;
+            hash *= 1099511628211ull;
+        }
+
+        return hash;
+    }
+
+    static std::string getShaderCachePath(uint64_t key)
+    {
+        char name[32];
+        snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)key);
+        return (std::filesystem::path(s_ShaderCacheDirectory) / name).string();
+    }
+
+    static uint32_t loadProgramBinary(uint64_t key)
+    {
+        FILE* file = fopen(getShaderCachePath(key).c_str(), "rb");
+        if (!file) { return 0; }
+
+        OglsShaderCacheHeader header;
+        std::vector<uint8_t> binary;
+        bool valid = fread(&header, sizeof(header), 1, file) == 1
+            && header.magic == OGLS_SHADER_CACHE_MAGIC
+            && header.version == OGLS_SHADER_CACHE_VERSION
+            && header.key == key
+            && header.binaryLength > 0;
+
+        if (valid)
+        {
+            binary.resize(header.binaryLength);
+            valid = fread(binary.data(), 1, binary.size(), file) == binary.size();
+        }
+        fclose(file);
+
+        if (!valid) { return 0; }
+
+        uint32_t program = glCreateProgram();
+        glProgramBinary(program, header.binaryFormat, binary.data(), (GLsizei)binary.size());
+
+        // drivers reject binaries silently through the link status, e.g. after an update that kept the version string
+        GLint status;
+        glGetProgramiv(program, GL_LINK_STATUS, &status);
+        if (status != GL_TRUE)
+        {
+            glDeleteProgram(program);
+            return 0;
+        }
+
+        // the modification time orders the files for trimming
+        std::error_code error;
+        std::filesystem::last_write_time(getShaderCachePath(key), std::filesystem::file_time_type::clock::now(), error);
+        return program;
+    }
+
+    static void saveProgramBinary(uint32_t program, uint64_t key)
+    {
+        GLint length = 0;
+        glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (length <= 0) { return; }
+
+        OglsShaderCacheHeader header{};
+        std::vector<uint8_t> binary(length);
+        GLenum binaryFormat;
+        glGetProgramBinary(program, length, &length, &binaryFormat, binary.data());
+
+        header.magic = OGLS_SHADER_CACHE_MAGIC;
+        header.version = OGLS_SHADER_CACHE_VERSION;
+        header.key = key;
+        header.binaryFormat = binaryFormat;
+        header.binaryLength = (uint32_t)length;
+
+        // written to a temporary file of this process and renamed, so a concurrent launch never reads a partial
+        // binary and two launches saving the same program never write into one file
+        char suffix[32];
+        snprintf(suffix, sizeof(suffix), ".%016llx.tmp", (unsigned long long)s_ShaderCacheTempSuffix);
+        std::string path = getShaderCachePath(key);
+        std::string tempPath = path + suffix;
+
+        FILE* file = fopen(tempPath.c_str(), "wb");
+        if (!file) { return; }
+
+        bool written = fwrite(&header, sizeof(header), 1, file) == 1
+            && fwrite(binary.data(), 1, header.binaryLength, file) == header.binaryLength;
+        written = fclose(file) == 0 && written;
+
+        std::error_code error;
+        if (written) { std::filesystem::rename(tempPath, path, error); }
+        if (!written || error) { std::filesystem::remove(tempPath, error); }
+    }
+
+    static void trimShaderCache()
+    {
+        struct CacheFile
+        {
+            std::filesystem::path path;
+            std::filesystem::file_time_type used;
+            uint64_t bytes;
+        };
+
+        std::error_code error;
+        std::vector<CacheFile> files;
+        uint64_t bytes = 0;
+        for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(s_ShaderCacheDirectory, error))
+        {
+            if (entry.path().extension() != ".bin" || !entry.is_regular_file(error)) { continue; }
+
+            CacheFile file = { entry.path(), entry.last_write_time(error), entry.file_size(error) };
+            if (error) { continue; }
+
+            files.push_back(file);
+            bytes += file.bytes;
+        }
+
+        std::sort(files.begin(), files.end(), [](const CacheFile& a, const CacheFile& b) { return a.used < b.used; });
+        for (size_t i = 0; i < files.size() && bytes > OGLS_SHADER_CACHE_MAX_BYTES; i++)
+        {
+            std::filesystem::remove(files[i].path, error);
+            bytes -= files[i].bytes;
+        }
+    }
+
+    OglsResult setShaderCacheDirectory(const char* path)
+    {
+        if (!path)
+        {
+            s_ShaderCacheDirectory.clear();
+            return Ogls_Result_Success;
+        }
+
+        // without any binary formats the driver cannot round trip programs
+        GLint formatCount = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+        if (formatCount <= 0) { return Ogls_Result_Failed; }
+
+        std::error_code error;
+        std::filesystem::create_directories(path, error);
+        if (error)
+        {
+            printf("ogls error: could not create shader cache directory %s\n", path);
+            return Ogls_Result_Failed;
+        }
+
+        s_ShaderCacheDirectory = path;
+        s_ShaderCacheTempSuffix = ((uint64_t)std::random_device{}() << 32) | std::random_device{}();
+        trimShaderCache();
+        return Ogls_Result_Success;
+    }
+
+    OglsShaderCacheStats getShaderCacheStats()
+    {
+        return s_ShaderCacheStats;
+    }
+
+    static uint32_t findProfilerScope(const char* name, uint32_t depth)
+    {
+        for (uint32_t i = 0; i < s_Profiler.scopes.size(); i++)
+        {
+            if (s_Profiler.scopes[i].name == name) { return i; }
+        }
+
+        OglsProfilerScope scope{};
+        scope.name = name;
+        scope.depth = depth;
+        s_Profiler.scopes.push_back(scope);
+        return (uint32_t)s_Profiler.scopes.size() - 1;
+    }
+
+    static void collectProfilerFrame(OglsProfilerFrame* frame)
+    {
+        // results that are still in flight are dropped rather than waited on
+        for (uint32_t i = 0; i < frame->recordCount; i++)
+        {
+            GLuint available = GL_FALSE;
+            glGetQueryObjectuiv(frame->records[i].endQuery, GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available) { return; }
+        }
+
+        for (uint32_t i = 0; i < frame->recordCount; i++)
+        {
+            OglsProfilerRecord* record = &frame->records[i];
+            GLuint64 begin, end;
+            glGetQueryObjectui64v(record->beginQuery, GL_QUERY_RESULT, &begin);
+            glGetQueryObjectui64v(record->endQuery, GL_QUERY_RESULT, &end);
+
+            OglsProfilerScope* scope = &s_Profiler.scopes[record->scope];
+            scope->history[scope->samples % OGLS_PROFILER_HISTORY] = (float)((end - begin) / 1.0e6);
+            scope->samples++;
+        }
+    }
+
+    void setProfilerEnabled(bool enabled)
+    {
+        s_Profiler.enabled = enabled;
+    }
+
+    bool isProfilerEnabled()
+    {
+        return s_Profiler.enabled;
+    }
+
+    void beginProfilerFrame()
+    {
+        if (!s_Profiler.enabled) { return; }
+
+        if (!s_Profiler.queriesCreated)
+        {
+            for (uint32_t i = 0; i < OGLS_PROFILER_FRAMES; i++)
+                glGenQueries(OGLS_PROFILER_MAX_SCOPES * 2, s_Profiler.frames[i].queries);
+
+            s_Profiler.queriesCreated = true;
+        }
+
+        OglsProfilerFrame* frame = &s_Profiler.frames[s_Profiler.frameIndex % OGLS_PROFILER_FRAMES];
+        if (frame->pending) { collectProfilerFrame(frame); }
+
+        frame->recordCount = 0;
+        frame->pending = false;
+        s_Profiler.stackDepth = 0;
+        s_Profiler.inFrame = true;
+    }
+
+    void endProfilerFrame()
+    {
+        if (!s_Profiler.inFrame) { return; }
+
+        OglsProfilerFrame* frame = &s_Profiler.frames[s_Profiler.frameIndex % OGLS_PROFILER_FRAMES];
+        frame->pending = frame->recordCount > 0;
+        s_Profiler.frameIndex++;
+        s_Profiler.inFrame = false;
+    }
+
+    void beginProfilerScope(const char* name)
+    {
+        if (!s_Profiler.inFrame || s_Profiler.stackDepth >= OGLS_PROFILER_MAX_SCOPES) { return; }
+
+        // a full frame still tracks nesting so the matching end pops the right entry
+        OglsProfilerFrame* frame = &s_Profiler.frames[s_Profiler.frameIndex % OGLS_PROFILER_FRAMES];
+        if (frame->recordCount >= OGLS_PROFILER_MAX_SCOPES)
+        {
+            s_Profiler.stack[s_Profiler.stackDepth++] = UINT32_MAX;
+            return;
+        }
+
+        uint32_t recordIndex = frame->recordCount++;
+        OglsProfilerRecord* record = &frame->records[recordIndex];
+        record->scope = findProfilerScope(name, s_Profiler.stackDepth);
+        record->beginQuery = frame->queries[recordIndex * 2];
+        record->endQuery = frame->queries[recordIndex * 2 + 1];
+        glQueryCounter(record->beginQuery, GL_TIMESTAMP);
+
+        s_Profiler.stack[s_Profiler.stackDepth++] = recordIndex;
+    }
+
+    void endProfilerScope()
+    {
+        if (!s_Profiler.inFrame || s_Profiler.stackDepth == 0) { return; }
+
+        uint32_t recordIndex = s_Profiler.stack[--s_Profiler.stackDepth];
+        if (recordIndex == UINT32_MAX) { return; }
+
+        OglsProfilerFrame* frame = &s_Profiler.frames[s_Profiler.frameIndex % OGLS_PROFILER_FRAMES];
+        glQueryCounter(frame->records[recordIndex].endQuery, GL_TIMESTAMP);
+    }
+
+    void resetProfiler()
+    {
+        for (OglsProfilerScope& scope : s_Profiler.scopes) { scope.samples = 0; }
+    }
+
+    uint32_t getProfilerScopeCount()
+    {
+        return (uint32_t)s_Profiler.scopes.size();
+    }
+
+    OglsProfilerScopeStats getProfilerScopeStats(uint32_t index)
+    {
+        OglsProfilerScopeStats stats{};
+        if (index >= s_Profiler.scopes.size()) { return stats; }
+
+        OglsProfilerScope* scope = &s_Profiler.scopes[index];
+        stats.name = scope->name.c_str();
+        stats.depth = scope->depth;
+        stats.samples = scope->samples;
+        if (scope->samples == 0) { return stats; }
+
+        uint32_t count = scope->samples < OGLS_PROFILER_HISTORY ? scope->samples : OGLS_PROFILER_HISTORY;
+        for (uint32_t i = 0; i < count; i++)
+        {
+            stats.averageMs += scope->history[i];
+            if (scope->history[i] > stats.maxMs) { stats.maxMs = scope->history[i]; }
+        }
+
+        stats.averageMs /= count;
+        stats.lastMs = scope->history[(scope->samples - 1) % OGLS_PROFILER_HISTORY];
+        return stats;
+    }
+
+    OglsResult findProfilerScopeStats(const char* name, OglsProfilerScopeStats* stats)
+    {
+        for (uint32_t i = 0; i < s_Profiler.scopes.size(); i++)
+        {
+            if (s_Profiler.scopes[i].name == name)
+            {
+                *stats = getProfilerScopeStats(i);
+                return Ogls_Result_Success;
+            }
+        }
+
+        return Ogls_Result_Failed;
+    }
+
+    OglsResult createShaderFromStr(OglsShader* shader, OglsShaderCreateInfo* shaderStrings)
+    {
+        uint64_t cacheKey = 0;
+        uint32_t shaderProgram = 0;
+
+        if (!s_ShaderCacheDirectory.empty())
+        {
+            cacheKey = hashShaderSources(shaderStrings);
+            shaderProgram = loadProgramBinary(cacheKey);
+        }
+
+        if (shaderProgram)
+        {
+            s_ShaderCacheStats.programsLoaded++;
+        }
+        else
+        {
+            uint32_t vertexShader, fragmentShader;
+
+            vertexShader = glCreateShader(GL_VERTEX_SHADER);
+            glShaderSource(vertexShader, 1, &shaderStrings->vertexSrc, NULL);
+            glCompileShader(vertexShader);
+
+            fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+            glShaderSource(fragmentShader, 1, &shaderStrings->fragmentSrc, NULL);
+            glCompileShader(fragmentShader);
+
+            bool vertexCompiled = checkShaderCompile(vertexShader, "vertex");
+            bool fragmentCompiled = checkShaderCompile(fragmentShader, "fragment");
+            if (!vertexCompiled || !fragmentCompiled)
+            {
+                glDeleteShader(vertexShader);
+                glDeleteShader(fragmentShader);
+                return Ogls_Result_Failed;
+            }
+
+            shaderProgram = glCreateProgram();
+            if (!s_ShaderCacheDirectory.empty()) { glProgramParameteri(shaderProgram, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE); }
+            glAttachShader(shaderProgram, vertexShader);
+            glAttachShader(shaderProgram, fragmentShader);
+            glLinkProgram(shaderProgram);
+
+            glDetachShader(shaderProgram, vertexShader);
+            glDetachShader(shaderProgram, fragmentShader);
+            glDeleteShader(vertexShader);
+            glDeleteShader(fragmentShader);
+
+            if (!checkProgramLink(shaderProgram))
+            {
+                glDeleteProgram(shaderProgram);
+                return Ogls_Result_Failed;
+            }
+
+            s_ShaderCacheStats.programsCompiled++;
+            if (!s_ShaderCacheDirectory.empty()) { saveProgramBinary(shaderProgram, cacheKey); }
+        }
+
+        OglsShaderData shaderData{};
+        shaderData.id = shaderProgram;
+
+        shader->handle = poolAdd(&s_Shaders, shaderData);
+        if (!shader->handle)
+        {
+            printf("%s\n", "ogls error: shader pool is full");
+            cacheForget(&s_StateCache.program, shaderProgram);
+            glDeleteProgram(shaderProgram);
+            return Ogls_Result_Failed;
+        }
+
+        return Ogls_Result_Success;
+    }
+
+    OglsResult createTexture(OglsTexture* texture, OglsTextureCreateInfo* createInfo)
+    {
+        GLint internalFormat;
+        GLenum dataFormat, dataType;
+        getTextureFormat(createInfo->format, &internalFormat, &dataFormat, &dataType);
+
+        GLint filter = createInfo->filter == Ogls_TextureFilter_Linear ? GL_LINEAR : GL_NEAREST;
+
+        uint32_t tex;
+        if (useDirectStateAccess())
+        {
+            glCreateTextures(GL_TEXTURE_2D, 1, &tex);
+            glTextureStorage2D(tex, 1, internalFormat, createInfo->width, createInfo->height);
+            if (createInfo->data) { glTextureSubImage2D(tex, 0, 0, 0, createInfo->width, createInfo->height, dataFormat, dataType, createInfo->data); }
+            glTextureParameteri(tex, GL_TEXTURE_MIN_FILTER, filter);
+            glTextureParameteri(tex, GL_TEXTURE_MAG_FILTER, filter);
+            glTextureParameteri(tex, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTextureParameteri(tex, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            if (OGLS_CHECK_ERROR() == Ogls_Result_Failed) { glDeleteTextures(1, &tex); return Ogls_Result_Failed; }
+        }
+        else
+        {
+            glGenTextures(1, &tex);
+            cacheBindTexture(0, GL_TEXTURE_2D, tex);
+            glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, createInfo->width, createInfo->height, 0, dataFormat, dataType, createInfo->data);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            if (OGLS_CHECK_ERROR() == Ogls_Result_Failed) { cacheBindTexture(0, GL_TEXTURE_2D, 0); glDeleteTextures(1, &tex); return Ogls_Result_Failed; }
+        }
+
+        OglsTextureData textureData{};
+        textureData.id = tex;
+        textureData.width = createInfo->width;
+        textureData.height = createInfo->height;
+        textureData.format = createInfo->format;
+        textureData.target = GL_TEXTURE_2D;
+
+        texture->handle = poolAdd(&s_Textures, textureData);
+        if (!texture->handle)
+        {
+            printf("%s\n", "ogls error: texture pool is full");
+            s_StateCacheTexturesValid = false;
+            glDeleteTextures(1, &tex);
+            return Ogls_Result_Failed;
+        }
+
+        return Ogls_Result_Success;
+    }
+
+    OglsResult createBufferTexture(OglsTexture* texture, OglsVertexBuffer vertexBuffer, OglsTextureFormat format)
+    {
+        OglsVertexBufferData* vertexBufferData = poolLookup(&s_VertexBuffers, vertexBuffer.handle, "vertex buffer");
+        if (!vertexBufferData) { return Ogls_Result_Failed; }
+
+        GLint internalFormat;
+        GLenum dataFormat, dataType;
+        getTextureFormat(format, &internalFormat, &dataFormat, &dataType);
+
+        uint32_t tex;
+        if (useDirectStateAccess())
+        {
+            glCreateTextures(GL_TEXTURE_BUFFER, 1, &tex);
+            glTextureBuffer(tex, internalFormat, vertexBufferData->id);
+            if (OGLS_CHECK_ERROR() == Ogls_Result_Failed) { glDeleteTextures(1, &tex); return Ogls_Result_Failed; }
+        }
+        else
+        {
+            glGenTextures(1, &tex);
+            cacheBindTexture(0, GL_TEXTURE_BUFFER, tex);
+            glTexBuffer(GL_TEXTURE_BUFFER, internalFormat, vertexBufferData->id);
+            if (OGLS_CHECK_ERROR() == Ogls_Result_Failed) { cacheBindTexture(0, GL_TEXTURE_BUFFER, 0); glDeleteTextures(1, &tex); return Ogls_Result_Failed; }
+        }
+
+        OglsTextureData textureData{};
+        textureData.id = tex;
+        textureData.width = vertexBufferData->size / getTextureFormatSize(format);
+        textureData.height = 1;
+        textureData.format = format;
+        textureData.target = GL_TEXTURE_BUFFER;
+
+        texture->handle = poolAdd(&s_Textures, textureData);
+        if (!texture->handle)
+        {
+            printf("%s\n", "ogls error: texture pool is full");
+            s_StateCacheTexturesValid = false;
+            glDeleteTextures(1, &tex);
+            return Ogls_Result_Failed;
+        }
+
+        return Ogls_Result_Success;
+    }
+
+    OglsResult createFramebuffer(OglsFramebuffer* framebuffer, OglsFramebufferCreateInfo* createInfo)
+    {
+        OglsTextureData* colorAttachmentData = poolLookup(&s_Textures, createInfo->colorAttachment.handle, "texture");
+        if (!colorAttachmentData) { return Ogls_Result_Failed; }
+
+        uint32_t fbo;
+        GLenum status;
+
+        if (useDirectStateAccess())
+        {
+            glCreateFramebuffers(1, &fbo);
+            glNamedFramebufferTexture(fbo, GL_COLOR_ATTACHMENT0, colorAttachmentData->id, 0);
+            status = glCheckNamedFramebufferStatus(fbo, GL_FRAMEBUFFER);
+        }
+        else
+        {
+            glGenFramebuffers(1, &fbo);
+            cacheBindFramebuffer(fbo);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, colorAttachmentData->id, 0);
+            status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+            cacheBindFramebuffer(0);
+        }
+
+        if (status != GL_FRAMEBUFFER_COMPLETE)
+        {
+            printf("%s\n", "ogl error: framebuffer is not complete");
+            glDeleteFramebuffers(1, &fbo);
+            return Ogls_Result_Failed;
+        }
+
+        OglsFramebufferData framebufferData{};
+        framebufferData.id = fbo;
+        framebufferData.width = colorAttachmentData->width;
+        framebufferData.height = colorAttachmentData->height;
+        framebufferData.colorAttachment = createInfo->colorAttachment;
+
+        framebuffer->handle = poolAdd(&s_Framebuffers, framebufferData);
+        if (!framebuffer->handle)
+        {
+            printf("%s\n", "ogls error: framebuffer pool is full");
+            cacheForget(&s_StateCache.framebuffer, fbo);
+            glDeleteFramebuffers(1, &fbo);
+            return Ogls_Result_Failed;
+        }
+
+        return Ogls_Result_Success;
+    }
+
+    OglsResult createReadback(OglsReadback* readback, OglsReadbackCreateInfo* createInfo)
+    {
+        if (createInfo->depth == 0 || createInfo->depth > OGLS_READBACK_MAX_DEPTH)
+        {
+            printf("ogls error: readback depth must be between 1 and %d\n", OGLS_READBACK_MAX_DEPTH);
+            return Ogls_Result_Failed;
+        }
+
+        OglsReadbackData readbackData{};
+        readbackData.width = createInfo->width;
+        readbackData.height = createInfo->height;
+        readbackData.size = createInfo->width * createInfo->height * 4;
+        readbackData.depth = createInfo->depth;
+
+        // GL_STREAM_READ hints the driver to place the buffers in memory the cpu reads quickly
+        if (useDirectStateAccess())
+        {
+            glCreateBuffers(readbackData.depth, readbackData.buffers);
+            for (uint32_t i = 0; i < readbackData.depth; i++)
+                glNamedBufferData(readbackData.buffers[i], readbackData.size, NULL, GL_STREAM_READ);
+        }
+        else
+        {
+            glGenBuffers(readbackData.depth, readbackData.buffers);
+            for (uint32_t i = 0; i < readbackData.depth; i++)
+            {
+                glBindBuffer(GL_PIXEL_PACK_BUFFER, readbackData.buffers[i]);
+                glBufferData(GL_PIXEL_PACK_BUFFER, readbackData.size, NULL, GL_STREAM_READ);
+            }
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        }
+
+        if (OGLS_CHECK_ERROR() == Ogls_Result_Failed) { glDeleteBuffers(readbackData.depth, readbackData.buffers); return Ogls_Result_Failed; }
+
+        readback->handle = poolAdd(&s_Readbacks, readbackData);
+        if (!readback->handle)
+        {
+            printf("%s\n", "ogls error: readback pool is full");
+            glDeleteBuffers(readbackData.depth, readbackData.buffers);
+            return Ogls_Result_Failed;
+        }
+
+        return Ogls_Result_Success;
+    }
+
+
+    float* getVertexBufferVertices(OglsVertexBuffer vertexBuffer)
+    {
+        OglsVertexBufferData* vertexBufferData = poolLookup(&s_VertexBuffers, vertexBuffer.handle, "vertex buffer");
+        if (!vertexBufferData) { return nullptr; }
+
+        return vertexBufferData->vertices;
+    }
+
+    uint32_t getVertexBufferCount(OglsVertexBuffer vertexBuffer)
+    {
+        OglsVertexBufferData* vertexBufferData = poolLookup(&s_VertexBuffers, vertexBuffer.handle, "vertex buffer");
+        if (!vertexBufferData) { return 0; }
+
+        return vertexBufferData->count;
+    }
+
+    uint32_t getVertexBufferSize(OglsVertexBuffer vertexBuffer)
+    {
+        OglsVertexBufferData* vertexBufferData = poolLookup(&s_VertexBuffers, vertexBuffer.handle, "vertex buffer");
+        if (!vertexBufferData) { return 0; }
+
+        return vertexBufferData->size;
+    }
+
+    uint32_t getVertexBufferId(OglsVertexBuffer vertexBuffer)
+    {
+        OglsVertexBufferData* vertexBufferData = poolLookup(&s_VertexBuffers, vertexBuffer.handle, "vertex buffer");
+        if (!vertexBufferData) { return 0; }
+
+        return vertexBufferData->id;
+    }
+
+    void* getIndexBufferIndices(OglsIndexBuffer indexBuffer)
+    {
+        OglsIndexBufferData* indexBufferData = poolLookup(&s_IndexBuffers, indexBuffer.handle, "index buffer");
+        if (!indexBufferData) { return nullptr; }
+
+        return indexBufferData->indices;
+    }
+
+    uint32_t getIndexBufferCount(OglsIndexBuffer indexBuffer)
+    {
+        OglsIndexBufferData* indexBufferData = poolLookup(&s_IndexBuffers, indexBuffer.handle, "index buffer");
+        if (!indexBufferData) { return 0; }
+
+        return indexBufferData->count;
+    }
+
+    uint32_t getIndexBufferSize(OglsIndexBuffer indexBuffer)
+    {
+        OglsIndexBufferData* indexBufferData = poolLookup(&s_IndexBuffers, indexBuffer.handle, "index buffer");
+        if (!indexBufferData) { return 0; }
+
+        return indexBufferData->size;
+    }
+
+    uint32_t getIndexBufferId(OglsIndexBuffer indexBuffer)
+    {
+        OglsIndexBufferData* indexBufferData = poolLookup(&s_IndexBuffers, indexBuffer.handle, "index buffer");
+        if (!indexBufferData) { return 0; }
+
+        return indexBufferData->id;
+    }
+
+    OglsDataType getIndexBufferType(OglsIndexBuffer indexBuffer)
+    {
+        OglsIndexBufferData* indexBufferData = poolLookup(&s_IndexBuffers, indexBuffer.handle, "index buffer");
+        if (!indexBufferData) { return Ogls_DataType_UnsignedInt; }
+
+        return indexBufferData->indexType;
+    }
+
+    uint32_t getVertexArrayId(OglsVertexArray vertexArray)
+    {
+        OglsVertexArrayData* vertexArrayData = poolLookup(&s_VertexArrays, vertexArray.handle, "vertex array");
+        if (!vertexArrayData) { return 0; }
+
+        return vertexArrayData->id;
+    }
+
+    uint32_t getShaderId(OglsShader shader)
+    {
+        OglsShaderData* shaderData = poolLookup(&s_Shaders, shader.handle, "shader");
+        if (!shaderData) { return 0; }
+
+        return shaderData->id;
+    }
+
+    uint32_t getTextureId(OglsTexture texture)
+    {
+        OglsTextureData* textureData = poolLookup(&s_Textures, texture.handle, "texture");
+        if (!textureData) { return 0; }
+
+        return textureData->id;
+    }
+
+    uint32_t getTextureWidth(OglsTexture texture)
+    {
+        OglsTextureData* textureData = poolLookup(&s_Textures, texture.handle, "texture");
+        if (!textureData) { return 0; }
+
+        return textureData->width;
+    }
+
+    uint32_t getTextureHeight(OglsTexture texture)
+    {
+        OglsTextureData* textureData = poolLookup(&s_Textures, texture.handle, "texture");
+        if (!textureData) { return 0; }
+
+        return textureData->height;
+    }
+
+    uint32_t getFramebufferId(OglsFramebuffer framebuffer)
+    {
+        OglsFramebufferData* framebufferData = poolLookup(&s_Framebuffers, framebuffer.handle, "framebuffer");
+        if (!framebufferData) { return 0; }
+
+        return framebufferData->id;
+    }
+
+    uint32_t getFramebufferWidth(OglsFramebuffer framebuffer)
+    {
+        OglsFramebufferData* framebufferData = poolLookup(&s_Framebuffers, framebuffer.handle, "framebuffer");
+        if (!framebufferData) { return 0; }
+
+        return framebufferData->width;
+    }
+
+    uint32_t getFramebufferHeight(OglsFramebuffer framebuffer)
+    {
+        OglsFramebufferData* framebufferData = poolLookup(&s_Framebuffers, framebuffer.handle, "framebuffer");
+        if (!framebufferData) { return 0; }
+
+        return framebufferData->height;
+    }
+
+    OglsResult readbackFramebuffer(OglsReadback readback, OglsFramebuffer framebuffer)
+    {
+        OglsReadbackData* readbackData = poolLookup(&s_Readbacks, readback.handle, "readback");
+        if (!readbackData) { return Ogls_Result_Failed; }
+
+        // the caller has to map the oldest frame before its buffer can be reused
+        if (readbackData->pending == readbackData->depth) { return Ogls_Result_Failed; }
+
+        uint32_t fbo = 0;
+        if (framebuffer.handle)
+        {
+            OglsFramebufferData* framebufferData = poolLookup(&s_Framebuffers, framebuffer.handle, "framebuffer");
+            if (!framebufferData) { return Ogls_Result_Failed; }
+            fbo = framebufferData->id;
+        }
+
+        // with a pack buffer bound glReadPixels only queues the copy and returns without waiting for the gpu
+        cacheBindFramebuffer(fbo);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, readbackData->buffers[readbackData->head]);
+        glReadPixels(0, 0, readbackData->width, readbackData->height, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+        readbackData->fences[readbackData->head] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        readbackData->head = (readbackData->head + 1) % readbackData->depth;
+        readbackData->pending++;
+
+        return OGLS_CHECK_ERROR();
+    }
+
+    OglsResult mapReadback(OglsReadback readback, bool wait, const void** pixels)
+    {
+        OglsReadbackData* readbackData = poolLookup(&s_Readbacks, readback.handle, "readback");
+        if (!readbackData || readbackData->pending == 0 || readbackData->mapped) { return Ogls_Result_Failed; }
+
+        uint32_t oldest = (readbackData->head + readbackData->depth - readbackData->pending) % readbackData->depth;
+
+        // a zero timeout only polls the fence, waiting flushes first so the fence is guaranteed to signal
+        GLenum status = wait
+            ? glClientWaitSync(readbackData->fences[oldest], GL_SYNC_FLUSH_COMMANDS_BIT, UINT64_MAX)
+            : glClientWaitSync(readbackData->fences[oldest], 0, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) { return Ogls_Result_Failed; }
+
+        if (useDirectStateAccess())
+        {
+            *pixels = glMapNamedBufferRange(readbackData->buffers[oldest], 0, readbackData->size, GL_MAP_READ_BIT);
+        }
+        else
+        {
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, readbackData->buffers[oldest]);
+            *pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, readbackData->size, GL_MAP_READ_BIT);
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        }
+
+        // a failed map leaves the fence and the read pending, so the next call tries the same buffer again
+        if (!*pixels) { return Ogls_Result_Failed; }
+
+        glDeleteSync(readbackData->fences[oldest]);
+        readbackData->fences[oldest] = 0;
+        readbackData->mapped = true;
+        return Ogls_Result_Success;
+    }
+
+    void unmapReadback(OglsReadback readback)
+    {
+        OglsReadbackData* readbackData = poolLookup(&s_Readbacks, readback.handle, "readback");
+        if (!readbackData || !readbackData->mapped) { return; }
+
+        uint32_t oldest = (readbackData->head + readbackData->depth - readbackData->pending) % readbackData->depth;
+
+        if (useDirectStateAccess())
+        {
+            glUnmapNamedBuffer(readbackData->buffers[oldest]);
+        }
+        else
+        {
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, readbackData->buffers[oldest]);
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        }
+
+        readbackData->mapped = false;
+        readbackData->pending--;
+    }
+
+    uint32_t getReadbackPendingCount(OglsReadback readback)
+    {
+        OglsReadbackData* readbackData = poolLookup(&s_Readbacks, readback.handle, "readback");
+        if (!readbackData) { return 0; }
+
+        return readbackData->pending;
+    }
+
+    uint32_t getReadbackSize(OglsReadback readback)
+    {
+        OglsReadbackData* readbackData = poolLookup(&s_Readbacks, readback.handle, "readback");
+        if (!readbackData) { return 0; }
+
+        return readbackData->size;
+    }
+
+
+    void bindVertexBuffer(OglsVertexBuffer vertexBuffer)
+    {
+        if (!vertexBuffer.handle)
+        {
+            cacheBindBuffer(GL_ARRAY_BUFFER, 0);
+            return;
+        }
+
+        OglsVertexBufferData* vertexBufferData = poolLookup(&s_VertexBuffers, vertexBuffer.handle, "vertex buffer");
+        if (!vertexBufferData) { return; }
+
+        cacheBindBuffer(GL_ARRAY_BUFFER, vertexBufferData->id);
+    }
+
+    void bindIndexBuffer(OglsIndexBuffer indexBuffer)
+    {
+        if (!indexBuffer.handle)
+        {
+            cacheBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+            return;
+        }
+
+        OglsIndexBufferData* indexBufferData = poolLookup(&s_IndexBuffers, indexBuffer.handle, "index buffer");
+        if (!indexBufferData) { return; }
+
+        cacheBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBufferData->id);
+    }
+
+    void bindVertexArray(OglsVertexArray vertexArray)
+    {
+        if (!vertexArray.handle)
+        {
+            cacheBindVertexArray(0);
+            return;
+        }
+
+        OglsVertexArrayData* vertexArrayData = poolLookup(&s_VertexArrays, vertexArray.handle, "vertex array");
+        if (!vertexArrayData) { return; }
+
+        cacheBindVertexArray(vertexArrayData->id);
+    }
+
+    void bindShader(OglsShader shader)
+    {
+        OglsShaderData* shaderData = poolLookup(&s_Shaders, shader.handle, "shader");
+        if (!shaderData) { return; }
+
+        cacheUseProgram(shaderData->id);
+    }
+
+    void bindTexture(OglsTexture texture, uint32_t unit)
+    {
+        if (!texture.handle)
+        {
+            cacheBindTexture(unit, GL_TEXTURE_2D, 0);
+            return;
+        }
+
+        OglsTextureData* textureData = poolLookup(&s_Textures, texture.handle, "texture");
+        if (!textureData) { return; }
+
+        cacheBindTexture(unit, textureData->target, textureData->id);
+    }
+
+    void bindFramebuffer(OglsFramebuffer framebuffer)
+    {
+        if (!framebuffer.handle)
+        {
+            cacheBindFramebuffer(0);
+            return;
+        }
+
+        OglsFramebufferData* framebufferData = poolLookup(&s_Framebuffers, framebuffer.handle, "framebuffer");
+        if (!framebufferData) { return; }
+
+        cacheBindFramebuffer(framebufferData->id);
+    }
+
+    void bindVertexBufferSubData(OglsVertexBuffer vertexBuffer, uint32_t size, uint32_t offset, const void* data)
+    {
+        OglsVertexBufferData* vertexBufferData = poolLookup(&s_VertexBuffers, vertexBuffer.handle, "vertex buffer");
+        if (!vertexBufferData) { return; }
+
+        bool orphan = vertexBufferData->bufferMode == GL_STREAM_DRAW && offset == 0;
+
+        if (useDirectStateAccess())
+        {
+            if (orphan) { glNamedBufferData(vertexBufferData->id, vertexBufferData->size, NULL, GL_STREAM_DRAW); }
+            glNamedBufferSubData(vertexBufferData->id, offset, size, data);
+            return;
+        }
+
+        cacheBindBuffer(GL_ARRAY_BUFFER, vertexBufferData->id);
+        if (orphan) { glBufferData(GL_ARRAY_BUFFER, vertexBufferData->size, NULL, GL_STREAM_DRAW); }
+        glBufferSubData(GL_ARRAY_BUFFER, offset, size, data);
+    }
+    
+    void bindIndexBufferSubData(OglsIndexBuffer indexBuffer, uint32_t size, uint32_t offset, const void* data)
+    {
+        OglsIndexBufferData* indexBufferData = poolLookup(&s_IndexBuffers, indexBuffer.handle, "index buffer");
+        if (!indexBufferData) { return; }
+
+        if (useDirectStateAccess())
+        {
+            glNamedBufferSubData(indexBufferData->id, offset, size, data);
+            return;
+        }
+
+        cacheBindBuffer(GL_COPY_WRITE_BUFFER, indexBufferData->id);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, offset, size, data);
+    }
+
+    void bindTextureSubData(OglsTexture texture, const void* data)
+    {
+        OglsTextureData* textureData = poolLookup(&s_Textures, texture.handle, "texture");
+        if (!textureData || textureData->target != GL_TEXTURE_2D) { return; }
+
+        GLint internalFormat;
+        GLenum dataFormat, dataType;
+        getTextureFormat(textureData->format, &internalFormat, &dataFormat, &dataType);
+
+        if (useDirectStateAccess())
+        {
+            glTextureSubImage2D(textureData->id, 0, 0, 0, textureData->width, textureData->height, dataFormat, dataType, data);
+            return;
+        }
+
+        cacheBindTexture(0, GL_TEXTURE_2D, textureData->id);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, textureData->width, textureData->height, dataFormat, dataType, data);
+    }
+
+    void destroyVertexBuffer(OglsVertexBuffer vertexBuffer)
+    {
+        OglsVertexBufferData* vertexBufferData = poolLookup(&s_VertexBuffers, vertexBuffer.handle, "vertex buffer");
+        if (!vertexBufferData) { return; }
+
+        cacheForget(&s_StateCache.arrayBuffer, vertexBufferData->id);
+        cacheForget(&s_StateCache.copyWriteBuffer, vertexBufferData->id);
+        glDeleteBuffers(1, &vertexBufferData->id);
+        poolRemove(&s_VertexBuffers, vertexBuffer.handle);
+    }
+
+    void destroyIndexBuffer(OglsIndexBuffer indexBuffer)
+    {
+        OglsIndexBufferData* indexBufferData = poolLookup(&s_IndexBuffers, indexBuffer.handle, "index buffer");
+        if (!indexBufferData) { return; }
+
+        cacheForget(&s_StateCache.elementBuffer, indexBufferData->id);
+        cacheForget(&s_StateCache.copyWriteBuffer, indexBufferData->id);
+        glDeleteBuffers(1, &indexBufferData->id);
+        poolRemove(&s_IndexBuffers, indexBuffer.handle);
+    }
+
+    void destroyVertexArray(OglsVertexArray vertexArray)
+    {
+        OglsVertexArrayData* vertexArrayData = poolLookup(&s_VertexArrays, vertexArray.handle, "vertex array");
+        if (!vertexArrayData) { return; }
+
+        cacheForget(&s_StateCache.vertexArray, vertexArrayData->id);
+        glDeleteVertexArrays(1, &vertexArrayData->id);
+        poolRemove(&s_VertexArrays, vertexArray.handle);
+    }
+
+    void destroyShader(OglsShader shader)
+    {
+        OglsShaderData* shaderData = poolLookup(&s_Shaders, shader.handle, "shader");
+        if (!shaderData) { return; }
+
+        cacheForget(&s_StateCache.program, shaderData->id);
+        glDeleteProgram(shaderData->id);
+        poolRemove(&s_Shaders, shader.handle);
+    }
+
+    void destroyTexture(OglsTexture texture)
+    {
+        OglsTextureData* textureData = poolLookup(&s_Textures, texture.handle, "texture");
+        if (!textureData) { return; }
+
+        // deleting a texture unbinds it from every unit
+        s_StateCacheTexturesValid = false;
+        glDeleteTextures(1, &textureData->id);
+        poolRemove(&s_Textures, texture.handle);
+    }
+
+    static void deleteReadbackObjects(OglsReadbackData* readbackData)
+    {
+        for (uint32_t i = 0; i < readbackData->depth; i++)
+        {
+            if (readbackData->fences[i]) { glDeleteSync(readbackData->fences[i]); }
+        }
+
+        // deleting a mapped buffer unmaps it
+        glDeleteBuffers(readbackData->depth, readbackData->buffers);
+    }
+
+    void destroyReadback(OglsReadback readback)
+    {
+        OglsReadbackData* readbackData = poolLookup(&s_Readbacks, readback.handle, "readback");
+        if (!readbackData) { return; }
+
+        deleteReadbackObjects(readbackData);
+        poolRemove(&s_Readbacks, readback.handle);
+    }
+
+    void destroyFramebuffer(OglsFramebuffer framebuffer)
+    {
+        OglsFramebufferData* framebufferData = poolLookup(&s_Framebuffers, framebuffer.handle, "framebuffer");
+        if (!framebufferData) { return; }
+
+        cacheForget(&s_StateCache.framebuffer, framebufferData->id);
+        glDeleteFramebuffers(1, &framebufferData->id);
+        poolRemove(&s_Framebuffers, framebuffer.handle);
+    }
+
+    template<typename T>
+    static void poolClear(OglsPool<T>* pool)
+    {
+        // live slots are retired like a remove so handles from before the clear stay stale
+        for (uint32_t slot : pool->itemSlots)
+        {
+            uint32_t generation = (pool->slotGenerations[slot] + 1) & OGLS_HANDLE_GENERATION_MASK;
+            pool->slotGenerations[slot] = generation ? generation : 1;
+            pool->freeSlots.push_back(slot);
+        }
+
+        pool->items.clear();
+        pool->itemSlots.clear();
+    }
+
+    void destroyAllResources()
+    {
+        // the pools are dense so every object of a type goes to gl in a single delete call
+        std::vector<uint32_t> ids;
+
+        for (OglsFramebufferData& framebufferData : s_Framebuffers.items) { ids.push_back(framebufferData.id); }
+        if (!ids.empty()) { glDeleteFramebuffers((GLsizei)ids.size(), ids.data()); }
+        ids.clear();
+
+        for (OglsTextureData& textureData : s_Textures.items) { ids.push_back(textureData.id); }
+        if (!ids.empty()) { glDeleteTextures((GLsizei)ids.size(), ids.data()); }
+        ids.clear();
+
+        for (OglsVertexArrayData& vertexArrayData : s_VertexArrays.items) { ids.push_back(vertexArrayData.id); }
+        if (!ids.empty()) { glDeleteVertexArrays((GLsizei)ids.size(), ids.data()); }
+        ids.clear();
+
+        for (OglsVertexBufferData& vertexBufferData : s_VertexBuffers.items) { ids.push_back(vertexBufferData.id); }
+        for (OglsIndexBufferData& indexBufferData : s_IndexBuffers.items) { ids.push_back(indexBufferData.id); }
+        if (!ids.empty()) { glDeleteBuffers((GLsizei)ids.size(), ids.data()); }
+
+        for (OglsShaderData& shaderData : s_Shaders.items) { glDeleteProgram(shaderData.id); }
+        for (OglsReadbackData& readbackData : s_Readbacks.items) { deleteReadbackObjects(&readbackData); }
+
+        if (s_Profiler.queriesCreated)
+        {
+            for (uint32_t i = 0; i < OGLS_PROFILER_FRAMES; i++)
+            {
+                glDeleteQueries(OGLS_PROFILER_MAX_SCOPES * 2, s_Profiler.frames[i].queries);
+                s_Profiler.frames[i].pending = false;
+            }
+
+            s_Profiler.queriesCreated = false;
+        }
+
+        poolClear(&s_Framebuffers);
+        poolClear(&s_Textures);
+        poolClear(&s_VertexArrays);
+        poolClear(&s_VertexBuffers);
+        poolClear(&s_IndexBuffers);
+        poolClear(&s_Shaders);
+        poolClear(&s_Readbacks);
+
+        invalidateStateCache();
+    }
+
+    void renderDraw(uint32_t first, uint32_t count)
+    {
+        glDrawArrays(GL_TRIANGLES, first, count);
+    }
+
+    void renderDrawIndex(uint32_t count, OglsDataType indexType)
+    {
+        glDrawElements(GL_TRIANGLES, count, getOglDataTypeEnum(indexType), 0);
+    }
+
+    void renderDrawMode(uint32_t mode, uint32_t first, uint32_t count)
+    {
+        glDrawArrays(mode, first, count);
+    }
+    
+    void renderDrawIndexMode(uint32_t mode, uint32_t count, OglsDataType indexType)
+    {
+        glDrawElements(mode, count, getOglDataTypeEnum(indexType), 0);
+    }
+
+    void renderDrawInstanced(uint32_t mode, uint32_t first, uint32_t count, uint32_t instanceCount)
     {
-        glDrawElements(mode, count, GL_UNSIGNED_INT, 0);
+        glDrawArraysInstanced(mode, first, count, instanceCount);
     }
 }
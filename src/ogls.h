@@ -1,6 +1,23 @@
+#pragma once
+
 #include <stdint.h>
 
+#if !defined(NDEBUG) && !defined(OGLS_DEBUG)
+#define OGLS_DEBUG
+#endif
+
+// error checks and debug groups compile away in release builds
+#ifdef OGLS_DEBUG
 #define OGLS_CHECK_ERROR() ::ogls::printErrorCodeMsg(__FILE__, __LINE__)
+#define OGLS_PUSH_DEBUG_GROUP(name) ::ogls::pushDebugGroup(name, __FILE__, __LINE__)
+#define OGLS_POP_DEBUG_GROUP() ::ogls::popDebugGroup()
+#else
+#define OGLS_CHECK_ERROR() (Ogls_Result_Success)
+#define OGLS_PUSH_DEBUG_GROUP(name) ((void)0)
+#define OGLS_POP_DEBUG_GROUP() ((void)0)
+#endif
+
+#define OGLS_READBACK_MAX_DEPTH 4
 
 enum OglsResult
 {
@@ -24,15 +41,50 @@ enum OglsBufferMode
 {
     Ogls_BufferMode_Static,
     Ogls_BufferMode_Dynamic,
+    Ogls_BufferMode_Stream, // rewritten every frame, writes at offset 0 orphan the old storage instead of waiting on draws that read it
+};
+
+enum OglsDebugSeverity
+{
+    Ogls_DebugSeverity_Notification,
+    Ogls_DebugSeverity_Low,
+    Ogls_DebugSeverity_Medium,
+    Ogls_DebugSeverity_High,
+};
+
+enum OglsTextureFormat
+{
+    Ogls_TextureFormat_RGBA8,
+    Ogls_TextureFormat_RGBA16F,
+    Ogls_TextureFormat_RGBA32F,
+    Ogls_TextureFormat_RG32F,
+    Ogls_TextureFormat_R32F,
+};
+
+enum OglsTextureFilter
+{
+    Ogls_TextureFilter_Nearest,
+    Ogls_TextureFilter_Linear,
 };
 
-struct OglsVertexBuffer;
-struct OglsIndexBuffer;
-struct OglsVertexArray;
+// resources are referred to by generation checked 32-bit handles into dense pools, a zero handle is null
+struct OglsVertexBuffer { uint32_t handle; };
+struct OglsIndexBuffer  { uint32_t handle; };
+struct OglsVertexArray  { uint32_t handle; };
+struct OglsShader       { uint32_t handle; };
+struct OglsTexture      { uint32_t handle; };
+struct OglsFramebuffer  { uint32_t handle; };
+struct OglsReadback     { uint32_t handle; };
+
 struct OglsVertexArrayCreateInfo;
 struct OglsVertexArrayAttribute;
-struct OglsShader;
 struct OglsShaderCreateInfo;
+struct OglsTextureCreateInfo;
+struct OglsFramebufferCreateInfo;
+struct OglsReadbackCreateInfo;
+struct OglsStateCacheStats;
+struct OglsShaderCacheStats;
+struct OglsProfilerScopeStats;
 struct OglsVec2;
 struct OglsVec3;
 struct OglsVec4;
@@ -40,43 +92,136 @@ struct OglsVec4;
 namespace ogls
 {
     OglsResult printErrorCodeMsg(const char* file, int line);
-    OglsResult createVertexBuffer(OglsVertexBuffer** vertexBuffer, float* vertices, uint32_t size, OglsBufferMode bufferMode = Ogls_BufferMode_Static);
-    OglsResult createIndexBuffer(OglsIndexBuffer** indexBuffer, uint32_t* indices, uint32_t size, OglsBufferMode bufferMode = Ogls_BufferMode_Static);
-    OglsResult createVertexArray(OglsVertexArray** vertexArray, OglsVertexArrayCreateInfo* createInfo);
-    OglsResult createShaderFromStr(OglsShader** shader, OglsShaderCreateInfo* shaderStrings);
 
-    float*     getVertexBufferVertices(OglsVertexBuffer* vertexBuffer);
-    uint32_t   getVertexBufferCount(OglsVertexBuffer* vertexBuffer);
-    uint32_t   getVertexBufferSize(OglsVertexBuffer* vertexBuffer);
-    uint32_t   getVertexBufferId(OglsVertexBuffer* vertexBuffer);
+    // asynchronous GL_KHR_debug output (core in gl 4.3), once enabled printErrorCodeMsg leaves the printing to it but
+    // still returns Ogls_Result_Failed for a pending error
+    OglsResult enableDebugOutput(OglsDebugSeverity minSeverity);
+    void       disableDebugOutput();
+    void       pushDebugGroup(const char* name, const char* file, int line);
+    void       popDebugGroup();
+    void       labelVertexBuffer(OglsVertexBuffer vertexBuffer, const char* label);
+    void       labelIndexBuffer(OglsIndexBuffer indexBuffer, const char* label);
+    void       labelVertexArray(OglsVertexArray vertexArray, const char* label);
+    void       labelShader(OglsShader shader, const char* label);
+    void       labelTexture(OglsTexture texture, const char* label);
+    void       labelFramebuffer(OglsFramebuffer framebuffer, const char* label);
+
+    // binds go through a shadow of the gl state and are skipped when nothing changes,
+    // call invalidateStateCache after code outside ogls changes bindings without restoring them
+    void       invalidateStateCache();
+    OglsStateCacheStats getStateCacheStats();
+    void       resetStateCacheStats();
+
+    // direct state access (gl 4.5) is used automatically when the context supports it
+    OglsResult setDirectStateAccess(bool enabled);
+    bool       isDirectStateAccessEnabled();
+
+    // linked programs are saved to and reloaded from path as driver binaries, keyed by the sources and the gl driver,
+    // a missing, stale or rejected binary falls back to compiling from source. a null path disables the cache.
+    // setting the directory trims it to 32 MB, dropping the binaries loaded least recently
+    OglsResult setShaderCacheDirectory(const char* path);
+    OglsShaderCacheStats getShaderCacheStats();
+
+    // gpu timings from timestamp queries, scopes may nest and are matched across frames by name.
+    // results are read a few frames late from a query ring so the cpu never waits on the gpu
+    void       setProfilerEnabled(bool enabled);
+    bool       isProfilerEnabled();
+    void       beginProfilerFrame();
+    void       endProfilerFrame();
+    void       beginProfilerScope(const char* name);
+    void       endProfilerScope();
+    void       resetProfiler();
+    uint32_t   getProfilerScopeCount();
+    OglsProfilerScopeStats getProfilerScopeStats(uint32_t index); // scopes are never removed, name stays valid
+    OglsResult findProfilerScopeStats(const char* name, OglsProfilerScopeStats* stats);
+
+    OglsResult createVertexBuffer(OglsVertexBuffer* vertexBuffer, float* vertices, uint32_t size, OglsBufferMode bufferMode = Ogls_BufferMode_Static);
+    OglsResult createIndexBuffer(OglsIndexBuffer* indexBuffer, void* indices, uint32_t size, OglsBufferMode bufferMode = Ogls_BufferMode_Static, OglsDataType indexType = Ogls_DataType_UnsignedInt);
+    OglsResult createVertexArray(OglsVertexArray* vertexArray, OglsVertexArrayCreateInfo* createInfo);
+    OglsResult createShaderFromStr(OglsShader* shader, OglsShaderCreateInfo* shaderStrings);
+    OglsResult createTexture(OglsTexture* texture, OglsTextureCreateInfo* createInfo);
+    OglsResult createBufferTexture(OglsTexture* texture, OglsVertexBuffer vertexBuffer, OglsTextureFormat format);
+    OglsResult createFramebuffer(OglsFramebuffer* framebuffer, OglsFramebufferCreateInfo* createInfo);
+    OglsResult createReadback(OglsReadback* readback, OglsReadbackCreateInfo* createInfo);
+
+    float*     getVertexBufferVertices(OglsVertexBuffer vertexBuffer);
+    uint32_t   getVertexBufferCount(OglsVertexBuffer vertexBuffer);
+    uint32_t   getVertexBufferSize(OglsVertexBuffer vertexBuffer);
+    uint32_t   getVertexBufferId(OglsVertexBuffer vertexBuffer);
+
+    void*      getIndexBufferIndices(OglsIndexBuffer indexBuffer);
+    uint32_t   getIndexBufferCount(OglsIndexBuffer indexBuffer);
+    uint32_t   getIndexBufferSize(OglsIndexBuffer indexBuffer);
+    uint32_t   getIndexBufferId(OglsIndexBuffer indexBuffer);
+    OglsDataType getIndexBufferType(OglsIndexBuffer indexBuffer);
 
-    uint32_t*  getIndexBufferIndices(OglsIndexBuffer* indexBuffer);
-    uint32_t   getIndexBufferCount(OglsIndexBuffer* indexBuffer);
-    uint32_t   getIndexBufferSize(OglsIndexBuffer* indexBuffer);
-    uint32_t   getIndexBufferId(OglsIndexBuffer* indexBuffer);
+    uint32_t   getVertexArrayId(OglsVertexArray vertexArray);
+    uint32_t   getShaderId(OglsShader shader);
 
-    uint32_t   getVertexArrayId(OglsVertexArray* vertexArray);
-    uint32_t   getShaderId(OglsShader* shader);
+    uint32_t   getTextureId(OglsTexture texture);
+    uint32_t   getTextureWidth(OglsTexture texture);
+    uint32_t   getTextureHeight(OglsTexture texture);
 
+    uint32_t   getFramebufferId(OglsFramebuffer framebuffer);
+    uint32_t   getFramebufferWidth(OglsFramebuffer framebuffer);
+    uint32_t   getFramebufferHeight(OglsFramebuffer framebuffer);
 
-    void       bindVertexBuffer(OglsVertexBuffer* vertexBuffer);
-    void       bindIndexBuffer(OglsIndexBuffer* indexBuffer);
-    void       bindVertexArray(OglsVertexArray* vertexArray);
-    void       bindShader(OglsShader* shader);
-    void       bindVertexBufferSubData(OglsVertexBuffer* vertexBuffer, uint32_t size, uint32_t offset, float* data);
-    void       bindIndexBufferSubData(OglsIndexBuffer* indexBuffer, uint32_t size, uint32_t offset, uint32_t* data);
+    // framebuffer reads go into a ring of pixel pack buffers and are mapped once their fence has passed,
+    // so the gpu keeps rendering ahead while older frames are collected. rows are rgba8, bottom row first
+    OglsResult readbackFramebuffer(OglsReadback readback, OglsFramebuffer framebuffer);
+    OglsResult mapReadback(OglsReadback readback, bool wait, const void** pixels);
+    void       unmapReadback(OglsReadback readback);
+    uint32_t   getReadbackPendingCount(OglsReadback readback);
+    uint32_t   getReadbackSize(OglsReadback readback);
 
-    void       destroyVertexBuffer(OglsVertexBuffer* vertexBuffer);
-    void       destroyIndexBuffer(OglsIndexBuffer* indexBuffer);
-    void       destroyVertexArray(OglsVertexArray* vertexArray);
-    void       destroyShader(OglsShader* shader);
+    void       bindVertexBuffer(OglsVertexBuffer vertexBuffer);
+    void       bindIndexBuffer(OglsIndexBuffer indexBuffer);
+    void       bindVertexArray(OglsVertexArray vertexArray);
+    void       bindShader(OglsShader shader);
+    void       bindTexture(OglsTexture texture, uint32_t unit = 0);
+    void       bindFramebuffer(OglsFramebuffer framebuffer);
+    void       bindVertexBufferSubData(OglsVertexBuffer vertexBuffer, uint32_t size, uint32_t offset, const void* data);
+    void       bindIndexBufferSubData(OglsIndexBuffer indexBuffer, uint32_t size, uint32_t offset, const void* data);
+    void       bindTextureSubData(OglsTexture texture, const void* data); // replaces the whole image
+
+    void       destroyVertexBuffer(OglsVertexBuffer vertexBuffer);
+    void       destroyIndexBuffer(OglsIndexBuffer indexBuffer);
+    void       destroyVertexArray(OglsVertexArray vertexArray);
+    void       destroyShader(OglsShader shader);
+    void       destroyTexture(OglsTexture texture);
+    void       destroyFramebuffer(OglsFramebuffer framebuffer);
+    void       destroyReadback(OglsReadback readback);
+    void       destroyAllResources();
 
     void       renderDraw(uint32_t first, uint32_t count);
-    void       renderDrawIndex(uint32_t count);
+    void       renderDrawIndex(uint32_t count, OglsDataType indexType = Ogls_DataType_UnsignedInt);
     void       renderDrawMode(uint32_t mode, uint32_t first, uint32_t count);
-    void       renderDrawIndexMode(uint32_t mode, uint32_t count);
+    void       renderDrawIndexMode(uint32_t mode, uint32_t count, OglsDataType indexType = Ogls_DataType_UnsignedInt);
+    void       renderDrawInstanced(uint32_t mode, uint32_t first, uint32_t count, uint32_t instanceCount);
 }
 
+struct OglsStateCacheStats
+{
+    uint64_t callsIssued;
+    uint64_t callsSkipped;
+};
+
+struct OglsShaderCacheStats
+{
+    uint32_t programsLoaded;
+    uint32_t programsCompiled;
+};
+
+struct OglsProfilerScopeStats
+{
+    const char* name;
+    uint32_t depth;
+    uint32_t samples;
+    float lastMs;
+    float averageMs;
+    float maxMs;
+};
+
 struct OglsVertexArrayAttribute
 {
     uint32_t index;
@@ -84,12 +229,13 @@ struct OglsVertexArrayAttribute
     uint32_t stride;
     OglsDataType dataType;
     void* offset;
+    bool normalized; // integer data types are mapped to [0, 1] or [-1, 1]
 };
 
 struct OglsVertexArrayCreateInfo
 {
-    OglsVertexBuffer* vertexBuffer;
-    OglsIndexBuffer* indexBuffer;
+    OglsVertexBuffer vertexBuffer;
+    OglsIndexBuffer indexBuffer;
     OglsVertexArrayAttribute* pAttributes;
     uint32_t attributeCount;
 };
@@ -100,6 +246,26 @@ struct OglsShaderCreateInfo
     const char* fragmentSrc;
 };
 
+struct OglsTextureCreateInfo
+{
+    uint32_t width;
+    uint32_t height;
+    OglsTextureFormat format;
+    OglsTextureFilter filter;
+    void* data;
+};
+
+struct OglsFramebufferCreateInfo
+{
+    OglsTexture colorAttachment;
+};
+
+struct OglsReadbackCreateInfo
+{
+    uint32_t width, height;
+    uint32_t depth; // frames in flight, at most OGLS_READBACK_MAX_DEPTH
+};
+
 
 struct OglsVec2
 {
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+// splits [0, count) into one contiguous range per thread, calling fn(thread, begin, end).
+// the calling thread takes the first range, so a thread count of 1 never starts a thread
+template<typename Fn>
+void parallelFor(uint32_t threadCount, uint32_t count, Fn fn)
+{
+    std::vector<std::thread> threads;
+    uint32_t chunk = (count + threadCount - 1) / threadCount;
+
+    for (uint32_t t = 1; t < threadCount && t * chunk < count; t++)
+        threads.emplace_back(fn, t, t * chunk, std::min(count, (t + 1) * chunk));
+
+    fn(0, 0, std::min(count, chunk));
+
+    for (std::thread& thread : threads)
+        thread.join();
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cmath>
+
+// the double pendulum step everything simulates with. the live pendulum, ensemble members, timeline rebuilds and
+// map tiles all go through these two functions, so they cannot drift apart and a rebuilt or recorded state is bit
+// for bit the one the live run went through
+
+// PI the way the simulation has always had it, angles wrap at twice this
+#define PENDULUM_PI (22.0f / 7.0f)
+
+// one semi-implicit euler step, aa1 and aa2 get the change in angular velocity. the angles are left unwrapped
+inline void stepPendulum(float m1, float m2, float l1, float l2, float g, float dt,
+    float& a1, float& a2, float& av1, float& av2, float& aa1, float& aa2)
+{
+    float daa1 = (-g * (2 * m1 + m2) * std::sin(a1) - m2 * g * std::sin(a1 - 2 * a2) - 2 * std::sin(a1 - a2) * m2 * (av2 * av2 * l2 + av1 * av1 * l1 * std::cos(a1 - a2))) / (l1 * (2 * m1 + m2 - m2 * std::cos(2 * a1 - 2 * a2)));
+    float daa2 = (2 * std::sin(a1 - a2) * (av1 * av1 * l1 * (m1 + m2) + g * (m1 + m2) * std::cos(a1) + av2 * av2 * l2 * m2 * std::cos(a1 - a2))) / (l2 * (2 * m1 + m2 - m2 * std::cos(2 * a1 - 2 * a2)));
+    aa1 = daa1 * dt;
+    aa2 = daa2 * dt;
+    av1 += aa1;
+    av2 += aa2;
+    a1 += av1 * dt;
+    a2 += av2 * dt;
+}
+
+// into [0, 2 PI)
+inline float wrapAngle(float x)
+{
+    float angle = std::fmod(x, 2 * PENDULUM_PI);
+    if (angle < 0) { angle += 2 * PENDULUM_PI; }
+    return angle;
+}
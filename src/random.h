@@ -0,0 +1,30 @@
+#pragma once
+
+#include <stdint.h>
+
+// splitmix64, the whole generator is one word so it can be seeded, saved in a checkpoint and restored exactly
+
+struct Random
+{
+    uint64_t state;
+};
+
+inline uint64_t nextRandom(Random* random)
+{
+    uint64_t z = (random->state += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+// uniform in [0, 1)
+inline float randomFloat(Random* random)
+{
+    return (float)(nextRandom(random) >> 40) * (1.0f / 16777216.0f);
+}
+
+// uniform in [0, n)
+inline uint32_t randomBelow(Random* random, uint32_t n)
+{
+    return (uint32_t)(((nextRandom(random) >> 32) * n) >> 32);
+}
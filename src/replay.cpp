@@ -0,0 +1,239 @@
+#include "replay.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define REPLAY_MAGIC   0x4c525044 // "DPRL"
+#define REPLAY_VERSION 1
+
+// groups are a varint step delta, a varint edit count and per edit a field byte and the float value.
+// a group without edits ends the session
+struct ReplayHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t headerSize;
+    uint32_t sessionSize;
+};
+
+static_assert(sizeof(ReplaySession) == 96, "replay session is stored as is");
+static_assert(sizeof(ReplayHeader) == 16, "replay header is stored as is");
+
+struct ReplayLog
+{
+    FILE* file;
+    uint64_t lastStep;
+    uint64_t bytes;
+    std::vector<uint8_t> group;
+    bool failed, finished;
+};
+
+struct ReplayGroup
+{
+    uint64_t step;
+    uint32_t firstEdit, editCount;
+};
+
+struct Replay
+{
+    ReplaySession session;
+    std::vector<ReplayGroup> groups;
+    std::vector<ReplayEdit> edits;
+    uint64_t endStep;
+    size_t nextGroup;
+};
+
+static void appendVarint(std::vector<uint8_t>* bytes, uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        bytes->push_back((uint8_t)(value | 0x80));
+        value >>= 7;
+    }
+    bytes->push_back((uint8_t)value);
+}
+
+static bool readVarint(const uint8_t** data, const uint8_t* end, uint64_t* value)
+{
+    *value = 0;
+    for (uint32_t shift = 0; shift < 64 && *data < end; shift += 7)
+    {
+        uint8_t byte = *(*data)++;
+        *value |= (uint64_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) { return true; }
+    }
+
+    return false;
+}
+
+static bool writeReplayGroup(ReplayLog* log, uint64_t step, const ReplayEdit* edits, uint32_t count)
+{
+    if (log->failed || log->finished) { return false; }
+
+    log->group.clear();
+    appendVarint(&log->group, step - log->lastStep);
+    appendVarint(&log->group, count);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        log->group.push_back((uint8_t)edits[i].field);
+        uint8_t value[sizeof(float)];
+        memcpy(value, &edits[i].value, sizeof(float));
+        log->group.insert(log->group.end(), value, value + sizeof(float));
+    }
+
+    // every group is flushed, so a session that crashes can still be replayed up to its last edit
+    if (fwrite(log->group.data(), 1, log->group.size(), log->file) != log->group.size() || fflush(log->file) != 0)
+    {
+        log->failed = true;
+        return false;
+    }
+
+    log->lastStep = step;
+    log->bytes += log->group.size();
+    return true;
+}
+
+bool createReplayLog(ReplayLog** log, const char* path, const ReplaySession* session)
+{
+    FILE* file = fopen(path, "wb");
+    if (!file) { return false; }
+
+    ReplayHeader header = { REPLAY_MAGIC, REPLAY_VERSION, sizeof(ReplayHeader), sizeof(ReplaySession) };
+    if (fwrite(&header, sizeof(header), 1, file) != 1 || fwrite(session, sizeof(ReplaySession), 1, file) != 1 || fflush(file) != 0)
+    {
+        fclose(file);
+        return false;
+    }
+
+    ReplayLog* newLog = new ReplayLog();
+    newLog->file = file;
+    newLog->lastStep = session->state.step;
+    newLog->bytes = sizeof(header) + sizeof(ReplaySession);
+
+    *log = newLog;
+    return true;
+}
+
+bool logReplayEdits(ReplayLog* log, uint64_t step, const ReplayEdit* edits, uint32_t count)
+{
+    if (count == 0) { return true; }
+    return writeReplayGroup(log, step, edits, count);
+}
+
+bool finishReplayLog(ReplayLog* log, uint64_t step)
+{
+    if (log->finished) { return !log->failed; }
+
+    bool ok = writeReplayGroup(log, step, nullptr, 0);
+    log->finished = true;
+    return ok;
+}
+
+uint64_t getReplayLogBytes(ReplayLog* log)
+{
+    return log->bytes;
+}
+
+void destroyReplayLog(ReplayLog* log)
+{
+    fclose(log->file);
+    delete log;
+}
+
+bool openReplay(Replay** replay, const char* path)
+{
+    FILE* file = fopen(path, "rb");
+    if (!file) { return false; }
+
+    std::vector<uint8_t> data;
+    uint8_t buffer[1 << 16];
+    size_t read;
+    while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0)
+        data.insert(data.end(), buffer, buffer + read);
+    fclose(file);
+
+    ReplayHeader header;
+    if (data.size() < sizeof(ReplayHeader) + sizeof(ReplaySession)) { return false; }
+    memcpy(&header, data.data(), sizeof(header));
+    if (header.magic != REPLAY_MAGIC || header.version != REPLAY_VERSION || header.headerSize != sizeof(ReplayHeader) || header.sessionSize != sizeof(ReplaySession))
+        return false;
+
+    Replay* newReplay = new Replay();
+    memcpy(&newReplay->session, data.data() + sizeof(ReplayHeader), sizeof(ReplaySession));
+
+    // a torn last group is dropped along with anything after it
+    const uint8_t* cursor = data.data() + sizeof(ReplayHeader) + sizeof(ReplaySession);
+    const uint8_t* end = data.data() + data.size();
+    uint64_t step = newReplay->session.state.step;
+    while (cursor < end)
+    {
+        uint64_t delta, count;
+        if (!readVarint(&cursor, end, &delta) || !readVarint(&cursor, end, &count) || count > (uint64_t)(end - cursor) / (1 + sizeof(float)))
+            break;
+
+        step += delta;
+        if (count == 0) { break; }
+
+        ReplayGroup group = { step, (uint32_t)newReplay->edits.size(), (uint32_t)count };
+        for (uint64_t i = 0; i < count; i++)
+        {
+            ReplayEdit edit;
+            edit.field = *cursor++;
+            memcpy(&edit.value, cursor, sizeof(float));
+            cursor += sizeof(float);
+
+            // fields index the value tables, a field this version does not know is a damaged or foreign log
+            if (edit.field >= Replay_Field_Count)
+            {
+                delete newReplay;
+                return false;
+            }
+
+            newReplay->edits.push_back(edit);
+        }
+
+        newReplay->groups.push_back(group);
+    }
+
+    newReplay->endStep = step;
+
+    *replay = newReplay;
+    return true;
+}
+
+const ReplaySession* getReplaySession(Replay* replay)
+{
+    return &replay->session;
+}
+
+bool peekReplayStep(Replay* replay, uint64_t* step)
+{
+    if (replay->nextGroup >= replay->groups.size()) { return false; }
+
+    *step = replay->groups[replay->nextGroup].step;
+    return true;
+}
+
+bool readReplayEdits(Replay* replay, std::vector<ReplayEdit>* edits)
+{
+    if (replay->nextGroup >= replay->groups.size()) { return false; }
+
+    const ReplayGroup& group = replay->groups[replay->nextGroup++];
+    edits->assign(replay->edits.begin() + group.firstEdit, replay->edits.begin() + group.firstEdit + group.editCount);
+    return true;
+}
+
+uint64_t getReplayEndStep(Replay* replay)
+{
+    return replay->endStep;
+}
+
+uint64_t getReplayGroupCount(Replay* replay)
+{
+    return replay->groups.size();
+}
+
+void closeReplay(Replay* replay)
+{
+    delete replay;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "checkpoint.h"
+
+// a session is the state it started from plus every edit made in the settings window, grouped by the frame
+// they were made in and stamped with the number of simulated steps at that point. replaying applies each group
+// once the simulation has taken as many steps, a group made while paused is applied on a frame without a step,
+// so the replayed run goes through the same states as the session did
+
+struct ReplayLog;
+struct Replay;
+
+enum ReplayField
+{
+    Replay_Field_Mass1,
+    Replay_Field_Mass2,
+    Replay_Field_Length1,
+    Replay_Field_Length2,
+    Replay_Field_Angle1,
+    Replay_Field_Angle2,
+    Replay_Field_AngularVelocity1,
+    Replay_Field_AngularVelocity2,
+    Replay_Field_AngularAcceleration1,
+    Replay_Field_AngularAcceleration2,
+    Replay_Field_GravityConstant,
+    Replay_Field_GravityOn,
+    Replay_Field_TimeStep,
+    Replay_Field_EnsembleOn,
+    Replay_Field_EnsembleMembers,
+    Replay_Field_EnsembleSpread,
+    Replay_Field_EnsembleReset, // no value, the ensemble is reset around the angles and spread at that point
+
+    Replay_Field_Count,
+};
+
+struct ReplayEdit
+{
+    uint32_t field; // ReplayField
+    float value;
+};
+
+struct ReplaySession
+{
+    CheckpointState state;    // ensemble members are not part of it, a restored session is replayed with the same --restore
+    uint32_t ensembleMembers; // 0 when the ensemble is off
+    uint32_t reserved;
+};
+
+bool createReplayLog(ReplayLog** log, const char* path, const ReplaySession* session);
+
+// one group per frame, frames without edits are not logged
+bool logReplayEdits(ReplayLog* log, uint64_t step, const ReplayEdit* edits, uint32_t count);
+
+// marks how far the session ran, a log that was never finished replays up to its last group
+bool finishReplayLog(ReplayLog* log, uint64_t step);
+uint64_t getReplayLogBytes(ReplayLog* log);
+void destroyReplayLog(ReplayLog* log);
+
+bool openReplay(Replay** replay, const char* path);
+const ReplaySession* getReplaySession(Replay* replay);
+
+// step of the next group, false once every group has been read
+bool peekReplayStep(Replay* replay, uint64_t* step);
+bool readReplayEdits(Replay* replay, std::vector<ReplayEdit>* edits);
+
+// steps the session ran for
+uint64_t getReplayEndStep(Replay* replay);
+uint64_t getReplayGroupCount(Replay* replay);
+void closeReplay(Replay* replay);
@@ -0,0 +1,551 @@
+#include "scene.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include "physics.h"
+#include "random.h"
+#include "trajectory.h"
+
+#define SCENE_SIDECAR_MAGIC   0x42535044 // "DPSB"
+#define SCENE_SIDECAR_VERSION 1
+
+static const uint32_t s_SceneMaxMembers = 100000000;
+static const uint32_t s_SceneMaxTokens = 32;
+
+struct SceneSidecarHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t memberFloats;
+    uint32_t reserved;
+    uint64_t count;
+    uint64_t reserved2;
+};
+
+static_assert(sizeof(SceneSidecarHeader) == 32, "scene sidecar header is read and written as is");
+
+// members added by one statement, or one run of member lines, in the layout writeEnsembleMembers takes
+struct SceneBlock
+{
+    std::vector<float> members;
+    const float* mapped; // into a sidecar instead of members
+    uint32_t count;
+};
+
+struct SceneMapping
+{
+    void* memory;
+    size_t size;
+};
+
+struct Scene
+{
+    SceneSettings settings;
+    std::vector<SceneBlock> blocks;
+    std::vector<SceneMapping> mappings;
+    uint32_t count;
+};
+
+struct SceneToken
+{
+    const char* begin;
+    const char* end;
+};
+
+struct SceneParser
+{
+    const char* path;
+    uint32_t line;
+    Scene* scene;
+    Random random;
+
+    // member lines are gathered per column and become one block when something else comes along
+    std::vector<float> pending[ENSEMBLE_MEMBER_FLOATS];
+};
+
+enum SceneAxis
+{
+    Scene_Axis_A1,
+    Scene_Axis_A2,
+    Scene_Axis_Av1,
+    Scene_Axis_Av2,
+};
+
+// the same conversion main.cpp uses, a scene with the default angles starts exactly where the defines do
+static float sceneRadians(float degrees)
+{
+    return degrees * PENDULUM_PI * 0.005555f;
+}
+
+static bool sceneError(SceneParser* parser, const char* message)
+{
+    printf("%s:%u: %s\n", parser->path, parser->line, message);
+    return false;
+}
+
+static bool tokenIs(const SceneToken& token, const char* word)
+{
+    size_t length = strlen(word);
+    return (size_t)(token.end - token.begin) == length && memcmp(token.begin, word, length) == 0;
+}
+
+static bool parseFloat(const SceneToken& token, float* value)
+{
+    std::from_chars_result result = std::from_chars(token.begin, token.end, *value);
+    return result.ec == std::errc() && result.ptr == token.end && std::isfinite(*value);
+}
+
+static bool parseUint(const SceneToken& token, uint64_t* value)
+{
+    std::from_chars_result result = std::from_chars(token.begin, token.end, *value);
+    return result.ec == std::errc() && result.ptr == token.end;
+}
+
+static bool parseAxis(const SceneToken& token, SceneAxis* axis)
+{
+    if (tokenIs(token, "a1")) { *axis = Scene_Axis_A1; return true; }
+    if (tokenIs(token, "a2")) { *axis = Scene_Axis_A2; return true; }
+    if (tokenIs(token, "av1")) { *axis = Scene_Axis_Av1; return true; }
+    if (tokenIs(token, "av2")) { *axis = Scene_Axis_Av2; return true; }
+    return false;
+}
+
+static bool parseFloats(SceneParser* parser, const SceneToken* tokens, uint32_t count, float* values)
+{
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if (!parseFloat(tokens[i], &values[i])) { return sceneError(parser, "expected a number"); }
+    }
+
+    return true;
+}
+
+static bool reserveMembers(SceneParser* parser, uint64_t count)
+{
+    size_t pending = parser->pending[0].size();
+    if (parser->scene->count + pending + count > s_SceneMaxMembers) { return sceneError(parser, "too many members"); }
+    return true;
+}
+
+static void flushPendingMembers(SceneParser* parser)
+{
+    uint32_t count = (uint32_t)parser->pending[0].size();
+    if (count == 0) { return; }
+
+    SceneBlock block{};
+    block.count = count;
+    block.members.reserve((size_t)count * ENSEMBLE_MEMBER_FLOATS);
+    for (std::vector<float>& column : parser->pending)
+    {
+        block.members.insert(block.members.end(), column.begin(), column.end());
+        column.clear();
+    }
+
+    parser->scene->blocks.push_back(std::move(block));
+    parser->scene->count += count;
+}
+
+// a block of count members starting from the pendulum, the caller fills in the axes it sets
+static float* addBlock(SceneParser* parser, uint32_t count)
+{
+    flushPendingMembers(parser);
+
+    SceneBlock block{};
+    block.count = count;
+    block.members.resize((size_t)count * ENSEMBLE_MEMBER_FLOATS);
+
+    const SceneSettings& settings = parser->scene->settings;
+    float* members = block.members.data();
+    std::fill(members, members + count, settings.a1);
+    std::fill(members + (size_t)count, members + (size_t)count * 2, settings.a2);
+    std::fill(members + (size_t)count * 2, members + (size_t)count * 3, settings.av1);
+    std::fill(members + (size_t)count * 3, members + (size_t)count * 4, settings.av2);
+
+    parser->scene->blocks.push_back(std::move(block));
+    parser->scene->count += count;
+    return parser->scene->blocks.back().members.data();
+}
+
+// the offset colors members by their initial angle, measured from the pendulum they fan out around
+static void finishBlock(SceneParser* parser, float* members, uint32_t count)
+{
+    float a2 = parser->scene->settings.a2;
+    for (uint32_t i = 0; i < count; i++)
+        members[(size_t)count * 4 + i] = members[(size_t)count + i] - a2;
+}
+
+static bool parseMember(SceneParser* parser, const SceneToken* tokens, uint32_t tokenCount)
+{
+    if (tokenCount != 2 && tokenCount != 4) { return sceneError(parser, "member takes two angles and optionally two velocities"); }
+
+    float values[4];
+    if (!parseFloats(parser, tokens, tokenCount, values) || !reserveMembers(parser, 1)) { return false; }
+
+    // left out velocities are the pendulum's, like the axes grid and random do not set
+    const SceneSettings& settings = parser->scene->settings;
+    parser->pending[0].push_back(sceneRadians(values[0]));
+    parser->pending[1].push_back(sceneRadians(values[1]));
+    parser->pending[2].push_back(tokenCount == 4 ? sceneRadians(values[2]) : settings.av1);
+    parser->pending[3].push_back(tokenCount == 4 ? sceneRadians(values[3]) : settings.av2);
+    parser->pending[4].push_back(parser->pending[1].back() - settings.a2);
+    return true;
+}
+
+static bool parseGrid(SceneParser* parser, const SceneToken* tokens, uint32_t tokenCount)
+{
+    if (tokenCount == 0 || tokenCount % 4 != 0) { return sceneError(parser, "grid takes axes of name, from, to and count"); }
+
+    uint32_t axisCount = tokenCount / 4;
+    SceneAxis axes[4];
+    float from[4], to[4];
+    uint64_t steps[4], total = 1;
+    uint32_t seen = 0;
+    for (uint32_t i = 0; i < axisCount; i++)
+    {
+        const SceneToken* axis = tokens + i * 4;
+        if (i >= 4 || !parseAxis(axis[0], &axes[i])) { return sceneError(parser, "grid axes are a1, a2, av1 and av2"); }
+        if (seen & (1u << axes[i])) { return sceneError(parser, "grid sets an axis twice"); }
+        seen |= 1u << axes[i];
+        if (!parseFloat(axis[1], &from[i]) || !parseFloat(axis[2], &to[i]) || !parseUint(axis[3], &steps[i]) || steps[i] == 0)
+            return sceneError(parser, "grid axes are a name, two numbers and a count");
+
+        total *= steps[i];
+        if (total > s_SceneMaxMembers) { return sceneError(parser, "too many members"); }
+    }
+
+    if (!reserveMembers(parser, total)) { return false; }
+
+    uint32_t count = (uint32_t)total;
+    float* members = addBlock(parser, count);
+
+    // the last axis varies fastest, each axis repeats its values every stride members
+    uint64_t stride = 1;
+    for (uint32_t i = axisCount; i-- > 0;)
+    {
+        float* column = members + (size_t)axes[i] * count;
+        float first = sceneRadians(from[i]), last = sceneRadians(to[i]);
+        float step = steps[i] > 1 ? (last - first) / (float)(steps[i] - 1) : 0.0f;
+
+        for (uint32_t m = 0; m < count; m++)
+            column[m] = first + step * (float)((m / stride) % steps[i]);
+
+        stride *= steps[i];
+    }
+
+    finishBlock(parser, members, count);
+    return true;
+}
+
+static bool parseRandom(SceneParser* parser, const SceneToken* tokens, uint32_t tokenCount)
+{
+    uint64_t total = 0;
+    if (tokenCount == 0 || !parseUint(tokens[0], &total) || total == 0) { return sceneError(parser, "random takes a member count first"); }
+    if ((tokenCount - 1) % 4 != 0) { return sceneError(parser, "random axes are a name, uniform or normal and two numbers"); }
+    if (total > s_SceneMaxMembers) { return sceneError(parser, "too many members"); }
+    if (!reserveMembers(parser, total)) { return false; }
+
+    uint32_t axisCount = (tokenCount - 1) / 4;
+    SceneAxis axes[4];
+    bool normal[4];
+    float a[4], b[4];
+    uint32_t seen = 0;
+    for (uint32_t i = 0; i < axisCount; i++)
+    {
+        const SceneToken* axis = tokens + 1 + i * 4;
+        if (i >= 4 || !parseAxis(axis[0], &axes[i])) { return sceneError(parser, "random axes are a1, a2, av1 and av2"); }
+        if (seen & (1u << axes[i])) { return sceneError(parser, "random sets an axis twice"); }
+        seen |= 1u << axes[i];
+        if (!tokenIs(axis[1], "uniform") && !tokenIs(axis[1], "normal")) { return sceneError(parser, "random distributions are uniform and normal"); }
+        if (!parseFloat(axis[2], &a[i]) || !parseFloat(axis[3], &b[i])) { return sceneError(parser, "expected a number"); }
+        normal[i] = tokenIs(axis[1], "normal");
+    }
+
+    uint32_t count = (uint32_t)total;
+    float* members = addBlock(parser, count);
+
+    // member by member so a scene draws the same values however its axes are written out
+    for (uint32_t m = 0; m < count; m++)
+    {
+        for (uint32_t i = 0; i < axisCount; i++)
+        {
+            float value;
+            if (normal[i])
+            {
+                double u1 = 1.0 - randomFloat(&parser->random), u2 = randomFloat(&parser->random);
+                value = a[i] + b[i] * (float)(std::sqrt(-2.0 * std::log(u1)) * std::cos(2.0 * M_PI * u2));
+            }
+            else { value = a[i] + (b[i] - a[i]) * randomFloat(&parser->random); }
+
+            members[(size_t)axes[i] * count + m] = sceneRadians(value);
+        }
+    }
+
+    finishBlock(parser, members, count);
+    return true;
+}
+
+static bool parseSidecar(SceneParser* parser, const SceneToken& token)
+{
+    std::string path(token.begin, token.end);
+    std::string scenePath = parser->path;
+    size_t slash = scenePath.find_last_of('/');
+    if (path[0] != '/' && slash != std::string::npos) { path = scenePath.substr(0, slash + 1) + path; }
+
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        printf("%s:%u: opening %s failed: %s\n", parser->path, parser->line, path.c_str(), strerror(errno));
+        return false;
+    }
+
+    struct stat info;
+    void* memory = MAP_FAILED;
+    if (fstat(fd, &info) == 0 && (size_t)info.st_size >= sizeof(SceneSidecarHeader))
+        memory = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (memory == MAP_FAILED) { return sceneError(parser, "the sidecar is not a scene sidecar"); }
+
+    size_t size = (size_t)info.st_size;
+    parser->scene->mappings.push_back({ memory, size });
+
+    const SceneSidecarHeader* header = (const SceneSidecarHeader*)memory;
+    if (header->magic != SCENE_SIDECAR_MAGIC || header->version != SCENE_SIDECAR_VERSION || header->memberFloats != ENSEMBLE_MEMBER_FLOATS ||
+        header->count == 0 || header->count > s_SceneMaxMembers || size != sizeof(SceneSidecarHeader) + header->count * ENSEMBLE_MEMBER_FLOATS * sizeof(float))
+        return sceneError(parser, "the sidecar is not a scene sidecar or is truncated");
+
+    if (!reserveMembers(parser, header->count)) { return false; }
+    madvise(memory, size, MADV_SEQUENTIAL);
+
+    flushPendingMembers(parser);
+    SceneBlock block{};
+    block.mapped = (const float*)(header + 1);
+    block.count = (uint32_t)header->count;
+    parser->scene->blocks.push_back(std::move(block));
+    parser->scene->count += (uint32_t)header->count;
+    return true;
+}
+
+static bool parseStatement(SceneParser* parser, const SceneToken* tokens, uint32_t tokenCount)
+{
+    const SceneToken& keyword = tokens[0];
+    const SceneToken* args = tokens + 1;
+    uint32_t argCount = tokenCount - 1;
+    SceneSettings& settings = parser->scene->settings;
+
+    // the most common line in a long explicit list
+    if (tokenIs(keyword, "member")) { return parseMember(parser, args, argCount); }
+
+    float values[2];
+    if (tokenIs(keyword, "masses") || tokenIs(keyword, "lengths"))
+    {
+        if (argCount != 2) { return sceneError(parser, "expected two numbers"); }
+        if (!parseFloats(parser, args, 2, values)) { return false; }
+        if (values[0] <= 0.0f || values[1] <= 0.0f) { return sceneError(parser, "masses and lengths have to be positive"); }
+
+        if (tokenIs(keyword, "masses")) { settings.m1 = values[0]; settings.m2 = values[1]; }
+        else { settings.l1 = values[0]; settings.l2 = values[1]; }
+        return true;
+    }
+
+    if (tokenIs(keyword, "gravity") || tokenIs(keyword, "dt"))
+    {
+        if (argCount != 1) { return sceneError(parser, "expected a number"); }
+        if (!parseFloats(parser, args, 1, values)) { return false; }
+
+        if (tokenIs(keyword, "gravity")) { settings.g = values[0]; }
+        else if (values[0] > 0.0f) { settings.dt = values[0]; }
+        else { return sceneError(parser, "the time step has to be positive"); }
+        return true;
+    }
+
+    if (tokenIs(keyword, "angles") || tokenIs(keyword, "velocities"))
+    {
+        if (argCount != 2) { return sceneError(parser, "expected two numbers"); }
+        if (!parseFloats(parser, args, 2, values)) { return false; }
+
+        if (tokenIs(keyword, "angles")) { settings.a1 = sceneRadians(values[0]); settings.a2 = sceneRadians(values[1]); }
+        else { settings.av1 = sceneRadians(values[0]); settings.av2 = sceneRadians(values[1]); }
+        return true;
+    }
+
+    if (tokenIs(keyword, "integrator"))
+    {
+        if (argCount != 1 || !tokenIs(args[0], "semi-implicit-euler")) { return sceneError(parser, "the only integrator is semi-implicit-euler"); }
+        settings.integrator = Trajectory_Integrator_SemiImplicitEuler;
+        return true;
+    }
+
+    if (tokenIs(keyword, "seed"))
+    {
+        if (argCount != 1 || !parseUint(args[0], &parser->random.state)) { return sceneError(parser, "expected a whole number"); }
+        return true;
+    }
+
+    if (tokenIs(keyword, "grid")) { return parseGrid(parser, args, argCount); }
+    if (tokenIs(keyword, "random")) { return parseRandom(parser, args, argCount); }
+
+    if (tokenIs(keyword, "members"))
+    {
+        if (argCount != 1) { return sceneError(parser, "members takes the path of a sidecar"); }
+        return parseSidecar(parser, args[0]);
+    }
+
+    return sceneError(parser, "unknown statement");
+}
+
+static bool parseScene(SceneParser* parser, const char* text, size_t size)
+{
+    const char* end = text + size;
+    SceneToken tokens[s_SceneMaxTokens];
+
+    for (const char* line = text; line < end;)
+    {
+        const char* lineEnd = (const char*)memchr(line, '\n', (size_t)(end - line));
+        if (!lineEnd) { lineEnd = end; }
+        parser->line++;
+
+        uint32_t tokenCount = 0;
+        for (const char* c = line; c < lineEnd && *c != '#';)
+        {
+            if (*c == ' ' || *c == '\t' || *c == '\r') { c++; continue; }
+            if (tokenCount == s_SceneMaxTokens) { return sceneError(parser, "line is too long"); }
+
+            const char* begin = c;
+            while (c < lineEnd && *c != ' ' && *c != '\t' && *c != '\r' && *c != '#') { c++; }
+            tokens[tokenCount++] = { begin, c };
+        }
+
+        if (tokenCount > 0 && !parseStatement(parser, tokens, tokenCount)) { return false; }
+        line = lineEnd + 1;
+    }
+
+    flushPendingMembers(parser);
+    return true;
+}
+
+bool loadScene(Scene** scene, const char* path)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        printf("opening %s failed: %s\n", path, strerror(errno));
+        return false;
+    }
+
+    std::string text;
+    struct stat info;
+    bool ok = fstat(fd, &info) == 0;
+    if (ok)
+    {
+        text.resize((size_t)info.st_size);
+        ok = read(fd, text.data(), text.size()) == (ssize_t)text.size();
+    }
+    close(fd);
+
+    if (!ok)
+    {
+        printf("reading %s failed\n", path);
+        return false;
+    }
+
+    Scene* newScene = new Scene();
+    newScene->settings = { 10.0f, 10.0f, 10.0f, 10.0f, 9.81f, 0.0166f, Trajectory_Integrator_SemiImplicitEuler,
+        sceneRadians(90.0f), sceneRadians(90.0f), 0.0f, 0.0f };
+
+    SceneParser parser{};
+    parser.path = path;
+    parser.scene = newScene;
+
+    if (!parseScene(&parser, text.data(), text.size()))
+    {
+        destroyScene(newScene);
+        return false;
+    }
+
+    *scene = newScene;
+    return true;
+}
+
+const SceneSettings* getSceneSettings(Scene* scene)
+{
+    return &scene->settings;
+}
+
+uint32_t getSceneMemberCount(Scene* scene)
+{
+    return scene->count;
+}
+
+void writeSceneMembers(Scene* scene, Ensemble* ensemble)
+{
+    uint32_t first = 0;
+    for (const SceneBlock& block : scene->blocks)
+    {
+        writeEnsembleMembers(ensemble, first, block.count, block.mapped ? block.mapped : block.members.data());
+        first += block.count;
+    }
+}
+
+static bool writeAll(int fd, const void* data, size_t size)
+{
+    const uint8_t* bytes = (const uint8_t*)data;
+    while (size > 0)
+    {
+        ssize_t written = write(fd, bytes, size);
+        if (written < 0 && errno == EINTR) { continue; }
+        if (written <= 0) { return false; }
+
+        bytes += written;
+        size -= (size_t)written;
+    }
+
+    return true;
+}
+
+bool writeSceneSidecar(Scene* scene, const char* path)
+{
+    if (scene->count == 0) { return false; }
+
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) { return false; }
+
+    SceneSidecarHeader header{};
+    header.magic = SCENE_SIDECAR_MAGIC;
+    header.version = SCENE_SIDECAR_VERSION;
+    header.memberFloats = ENSEMBLE_MEMBER_FLOATS;
+    header.count = scene->count;
+    bool ok = writeAll(fd, &header, sizeof(header));
+
+    // blocks hold their members column by column, a sidecar holds the whole scene that way
+    for (uint32_t column = 0; ok && column < ENSEMBLE_MEMBER_FLOATS; column++)
+    {
+        for (const SceneBlock& block : scene->blocks)
+        {
+            const float* members = block.mapped ? block.mapped : block.members.data();
+            ok = ok && writeAll(fd, members + (size_t)column * block.count, (size_t)block.count * sizeof(float));
+        }
+    }
+
+    ok = close(fd) == 0 && ok;
+    return ok;
+}
+
+void destroyScene(Scene* scene)
+{
+    for (const SceneMapping& mapping : scene->mappings)
+        munmap(mapping.memory, mapping.size);
+    delete scene;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "ensemble.h"
+
+// starting conditions read from a scene file instead of the defines in main.cpp. a scene is text, one statement
+// per line, '#' starts a comment. angles are in degrees and angular velocities in degrees per second
+//
+//     masses 10 10
+//     lengths 10 10
+//     gravity 9.81
+//     dt 0.0166
+//     integrator semi-implicit-euler
+//     angles 90 90                            the pendulum, and the values members below leave unset
+//     velocities 0 0
+//     seed 7                                  for random statements
+//     member 90 91.5 0 0                      one ensemble member, left out velocities come from velocities
+//     grid a1 80 100 100 a2 80 100 100        every combination, the last axis varies fastest
+//     random 100000 a2 uniform 80 100 av1 normal 0 5
+//     members big.dpsb                        a binary sidecar, relative to the scene file
+//
+// grid and random take axes out of a1, a2, av1 and av2, each at most once. members are added in the order of the statements and
+// share the masses, lengths and gravity of the pendulum, like every ensemble does
+//
+// a sidecar is a 32 byte header (magic "DPSB", version, floats per member, member count) followed by the members
+// in the layout writeEnsembleMembers takes, in radians. it is mapped and handed to the ensemble as is, nothing is
+// parsed, so large lists load at the speed of a memcpy. --scene-sidecar writes one from any scene
+
+struct Scene;
+
+struct SceneSettings
+{
+    float m1, m2;
+    float l1, l2;
+    float g;
+    float dt;
+    uint32_t integrator; // TrajectoryIntegrator
+    float a1, a2;        // radians
+    float av1, av2;      // radians per second
+};
+
+// prints what is wrong with the file and where before returning false
+bool loadScene(Scene** scene, const char* path);
+const SceneSettings* getSceneSettings(Scene* scene);
+uint32_t getSceneMemberCount(Scene* scene);
+
+// into an ensemble of getSceneMemberCount members
+void writeSceneMembers(Scene* scene, Ensemble* ensemble);
+bool writeSceneSidecar(Scene* scene, const char* path);
+void destroyScene(Scene* scene);
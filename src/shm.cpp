@@ -0,0 +1,240 @@
+#include "shm.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <string>
+
+#define SHM_RING_MAGIC   0x52535044 // "DPSR"
+#define SHM_RING_VERSION 1
+
+static const uint32_t s_ShmRingDefaultSlotCount = 1024;
+
+// slots start on their own cache line so a reader copying one never shares a line with the one being written
+static const uint32_t s_ShmRingAlignment = 64;
+
+// processes only share these atomics correctly if they are plain memory operations
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "shared ring sequences have to be lock free");
+
+struct ShmRingHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slotSize;
+    uint32_t slotCount;
+    uint32_t slotStride;
+    uint32_t reserved;
+    std::atomic<uint64_t> published;
+};
+
+// sequence is 2n + 1 while snapshot n is written into the slot and 2n + 2 once it is complete
+struct ShmRingSlot
+{
+    std::atomic<uint64_t> sequence;
+};
+
+struct ShmRingWriter
+{
+    std::string name;
+    uint8_t* memory;
+    size_t size;
+    ShmRingHeader* header;
+    uint64_t published;
+};
+
+struct ShmRingReader
+{
+    uint8_t* memory;
+    size_t size;
+    ShmRingHeader* header;
+};
+
+static std::string shmRingName(const char* name)
+{
+    return name[0] == '/' ? std::string(name) : "/" + std::string(name);
+}
+
+static uint32_t shmRingStride(uint32_t slotSize)
+{
+    uint32_t size = sizeof(ShmRingSlot) + slotSize;
+    return (size + s_ShmRingAlignment - 1) / s_ShmRingAlignment * s_ShmRingAlignment;
+}
+
+static ShmRingSlot* shmRingSlot(uint8_t* memory, const ShmRingHeader* header, uint64_t sequence)
+{
+    return (ShmRingSlot*)(memory + s_ShmRingAlignment + (sequence % header->slotCount) * header->slotStride);
+}
+
+// the snapshot bytes follow the sequence word
+static uint8_t* shmRingPayload(ShmRingSlot* slot)
+{
+    return (uint8_t*)(slot + 1);
+}
+
+bool createShmRingWriter(ShmRingWriter** writer, ShmRingWriterCreateInfo* createInfo)
+{
+    if (!createInfo->name || !createInfo->name[0] || createInfo->slotSize == 0) { return false; }
+
+    std::string name = shmRingName(createInfo->name);
+    uint32_t slotCount = createInfo->slotCount ? createInfo->slotCount : s_ShmRingDefaultSlotCount;
+    uint32_t stride = shmRingStride(createInfo->slotSize);
+    size_t size = s_ShmRingAlignment + (size_t)slotCount * stride;
+
+    // a ring left behind by a writer that crashed is replaced, readers still mapping it keep the old one
+    shm_unlink(name.c_str());
+    int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+    if (fd < 0) { return false; }
+
+    void* memory = MAP_FAILED;
+    if (ftruncate(fd, (off_t)size) == 0)
+        memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (memory == MAP_FAILED)
+    {
+        shm_unlink(name.c_str());
+        return false;
+    }
+
+    // the pages are zeroed, every slot starts at sequence 0 which no snapshot completes with. the magic is
+    // stored last so a reader that opens the ring early sees an empty ring rather than a half set up one
+    ShmRingHeader* header = (ShmRingHeader*)memory;
+    header->version = SHM_RING_VERSION;
+    header->slotSize = createInfo->slotSize;
+    header->slotCount = slotCount;
+    header->slotStride = stride;
+    header->published.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    header->magic = SHM_RING_MAGIC;
+
+    ShmRingWriter* newWriter = new ShmRingWriter();
+    newWriter->name = name;
+    newWriter->memory = (uint8_t*)memory;
+    newWriter->size = size;
+    newWriter->header = header;
+
+    *writer = newWriter;
+    return true;
+}
+
+void publishShmRing(ShmRingWriter* writer, const void* snapshot)
+{
+    uint64_t sequence = writer->published;
+    ShmRingSlot* slot = shmRingSlot(writer->memory, writer->header, sequence);
+
+    slot->sequence.store(2 * sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(shmRingPayload(slot), snapshot, writer->header->slotSize);
+    slot->sequence.store(2 * sequence + 2, std::memory_order_release);
+
+    writer->published = sequence + 1;
+    writer->header->published.store(sequence + 1, std::memory_order_release);
+}
+
+uint64_t getShmRingWriterSequence(ShmRingWriter* writer)
+{
+    return writer->published;
+}
+
+void destroyShmRingWriter(ShmRingWriter* writer)
+{
+    munmap(writer->memory, writer->size);
+    shm_unlink(writer->name.c_str());
+    delete writer;
+}
+
+bool openShmRingReader(ShmRingReader** reader, const char* name)
+{
+    if (!name || !name[0]) { return false; }
+
+    int fd = shm_open(shmRingName(name).c_str(), O_RDONLY, 0);
+    if (fd < 0) { return false; }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (size_t)info.st_size < s_ShmRingAlignment)
+    {
+        close(fd);
+        return false;
+    }
+
+    size_t size = (size_t)info.st_size;
+    void* memory = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (memory == MAP_FAILED) { return false; }
+
+    ShmRingHeader* header = (ShmRingHeader*)memory;
+    bool valid = header->magic == SHM_RING_MAGIC;
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    valid = valid && header->version == SHM_RING_VERSION && header->slotCount > 0 && header->slotStride == shmRingStride(header->slotSize) &&
+        s_ShmRingAlignment + (size_t)header->slotCount * header->slotStride <= size;
+    if (!valid)
+    {
+        munmap(memory, size);
+        return false;
+    }
+
+    ShmRingReader* newReader = new ShmRingReader();
+    newReader->memory = (uint8_t*)memory;
+    newReader->size = size;
+    newReader->header = header;
+
+    *reader = newReader;
+    return true;
+}
+
+uint32_t getShmRingSlotSize(ShmRingReader* reader)
+{
+    return reader->header->slotSize;
+}
+
+uint32_t getShmRingSlotCount(ShmRingReader* reader)
+{
+    return reader->header->slotCount;
+}
+
+uint64_t getShmRingSequence(ShmRingReader* reader)
+{
+    return reader->header->published.load(std::memory_order_acquire);
+}
+
+ShmRingRead readShmRing(ShmRingReader* reader, uint64_t sequence, void* snapshot)
+{
+    ShmRingSlot* slot = shmRingSlot(reader->memory, reader->header, sequence);
+    uint64_t complete = 2 * sequence + 2;
+
+    uint64_t before = slot->sequence.load(std::memory_order_acquire);
+    if (before < complete) { return ShmRing_Read_NotYet; }
+    if (before > complete) { return ShmRing_Read_Overwritten; }
+
+    memcpy(snapshot, shmRingPayload(slot), reader->header->slotSize);
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    uint64_t after = slot->sequence.load(std::memory_order_relaxed);
+    return after == complete ? ShmRing_Read_Ok : ShmRing_Read_Overwritten;
+}
+
+bool readLatestShmRing(ShmRingReader* reader, void* snapshot, uint64_t* sequence)
+{
+    while (true)
+    {
+        uint64_t published = getShmRingSequence(reader);
+        if (published == 0) { return false; }
+
+        if (readShmRing(reader, published - 1, snapshot) == ShmRing_Read_Ok)
+        {
+            *sequence = published - 1;
+            return true;
+        }
+    }
+}
+
+void closeShmRingReader(ShmRingReader* reader)
+{
+    munmap(reader->memory, reader->size);
+    delete reader;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <stdint.h>
+
+// fixed size snapshots shared with other processes through a posix shared memory ring. one writer publishes,
+// any number of readers in any process follow along without telling the writer. publishing is a single memcpy
+// into the next slot between two stores of that slot's sequence number, odd while it is being written. a reader
+// compares the sequence before and after its own copy, so a snapshot that was overwritten while it lagged or
+// while it was copying is reported instead of returned torn
+//
+// this header is all a reader needs, link shm.cpp and open the ring by name
+
+struct ShmRingWriter;
+struct ShmRingReader;
+
+enum ShmRingRead
+{
+    ShmRing_Read_Ok,
+    ShmRing_Read_NotYet,      // not published yet
+    ShmRing_Read_Overwritten, // the writer has lapped the reader, the snapshot is gone
+};
+
+struct ShmRingWriterCreateInfo
+{
+    const char* name;   // shm_open name, a leading '/' is added when missing
+    uint32_t slotSize;  // bytes per snapshot
+    uint32_t slotCount; // snapshots a reader can fall behind by before it loses them, 0 picks a default
+};
+
+bool createShmRingWriter(ShmRingWriter** writer, ShmRingWriterCreateInfo* createInfo);
+void publishShmRing(ShmRingWriter* writer, const void* snapshot);
+uint64_t getShmRingWriterSequence(ShmRingWriter* writer);
+
+// the name is unlinked, readers that still have it mapped keep reading the last snapshots
+void destroyShmRingWriter(ShmRingWriter* writer);
+
+bool openShmRingReader(ShmRingReader** reader, const char* name);
+uint32_t getShmRingSlotSize(ShmRingReader* reader);
+uint32_t getShmRingSlotCount(ShmRingReader* reader);
+
+// snapshots published so far, the next one gets this sequence number
+uint64_t getShmRingSequence(ShmRingReader* reader);
+
+// copies snapshot number sequence into snapshot, which holds getShmRingSlotSize bytes
+ShmRingRead readShmRing(ShmRingReader* reader, uint64_t sequence, void* snapshot);
+
+// newest snapshot, retried if it is overwritten while copying. false when nothing is published yet
+bool readLatestShmRing(ShmRingReader* reader, void* snapshot, uint64_t* sequence);
+void closeShmRingReader(ShmRingReader* reader);
@@ -0,0 +1,237 @@
+#include "sprites.h"
+
+#include <glad/glad.h>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <stdio.h>
+#include <algorithm>
+#include <vector>
+
+// colormaps are stored as a one texel high strip, sampled between the first and last texel centers
+static const uint32_t s_ColormapSize = 256;
+
+struct ColormapStop
+{
+    float t;
+    float r, g, b;
+};
+
+static const ColormapStop s_Viridis[] =
+{
+    { 0.00f, 0.267f, 0.005f, 0.329f },
+    { 0.25f, 0.230f, 0.322f, 0.546f },
+    { 0.50f, 0.128f, 0.567f, 0.551f },
+    { 0.75f, 0.369f, 0.789f, 0.383f },
+    { 1.00f, 0.993f, 0.906f, 0.144f },
+};
+
+static const ColormapStop s_Twilight[] =
+{
+    { 0.00f, 0.886f, 0.851f, 0.888f },
+    { 0.25f, 0.370f, 0.450f, 0.760f },
+    { 0.50f, 0.185f, 0.078f, 0.222f },
+    { 0.75f, 0.710f, 0.330f, 0.290f },
+    { 1.00f, 0.886f, 0.851f, 0.888f },
+};
+
+static const char* s_SpriteVertexShaderSource = R"(
+#version 330 core
+
+layout (location = 0) in vec2 a_Pos;
+
+uniform mat4 u_Camera;
+uniform float u_PointSize;
+uniform samplerBuffer u_Values;
+uniform vec2 u_Range; // lowest value, 1 / (highest - lowest)
+
+out float v_Value;
+
+void main()
+{
+    gl_Position = u_Camera * vec4(a_Pos, 0.0, 1.0);
+    gl_PointSize = u_PointSize;
+    v_Value = clamp((texelFetch(u_Values, gl_VertexID).r - u_Range.x) * u_Range.y, 0.0, 1.0);
+}
+)";
+
+static const char* s_SpriteFragmentShaderSource = R"(
+#version 330 core
+
+in float v_Value;
+
+uniform sampler2D u_Colormap;
+uniform float u_ColormapSize;
+uniform bool u_Round;
+
+out vec4 outColor;
+
+void main()
+{
+    vec2 offset = gl_PointCoord - 0.5;
+    if (u_Round && dot(offset, offset) > 0.25) { discard; }
+
+    float u = (0.5 + v_Value * (u_ColormapSize - 1.0)) / u_ColormapSize;
+    outColor = vec4(texture(u_Colormap, vec2(u, 0.5)).rgb, 1.0);
+}
+)";
+
+struct PointSprites
+{
+    uint32_t maxPoints;
+    uint32_t count;
+    float lowest, highest;
+
+    OglsVertexBuffer positionBuffer;
+    OglsVertexArray vertexArray;
+    OglsVertexBuffer valueBuffer;
+    OglsTexture valueTexture;
+    OglsTexture colormapTexture;
+    OglsShader shader;
+};
+
+static void buildColormap(PointSpriteColormap colormap, std::vector<uint8_t>* texels)
+{
+    const ColormapStop* stops = colormap == PointSprite_Colormap_Twilight ? s_Twilight : s_Viridis;
+    uint32_t stopCount = colormap == PointSprite_Colormap_Twilight ? sizeof(s_Twilight) / sizeof(s_Twilight[0]) : sizeof(s_Viridis) / sizeof(s_Viridis[0]);
+
+    texels->resize(s_ColormapSize * 4);
+    for (uint32_t i = 0; i < s_ColormapSize; i++)
+    {
+        float t = (float)i / (s_ColormapSize - 1);
+
+        uint32_t stop = 1;
+        while (stop < stopCount - 1 && stops[stop].t < t) { stop++; }
+
+        const ColormapStop& a = stops[stop - 1];
+        const ColormapStop& b = stops[stop];
+        float f = std::clamp((t - a.t) / (b.t - a.t), 0.0f, 1.0f);
+
+        (*texels)[i * 4 + 0] = (uint8_t)((a.r + (b.r - a.r) * f) * 255.0f + 0.5f);
+        (*texels)[i * 4 + 1] = (uint8_t)((a.g + (b.g - a.g) * f) * 255.0f + 0.5f);
+        (*texels)[i * 4 + 2] = (uint8_t)((a.b + (b.b - a.b) * f) * 255.0f + 0.5f);
+        (*texels)[i * 4 + 3] = 255;
+    }
+}
+
+bool createPointSprites(PointSprites** sprites, PointSpritesCreateInfo* createInfo)
+{
+    if (createInfo->maxPoints == 0) { return false; }
+
+    // every point fetches its value from a buffer texture, which has its own size limit
+    GLint maxTexels = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxTexels);
+    if ((uint32_t)maxTexels < createInfo->maxPoints)
+    {
+        printf("point sprites: %u points requested, buffer textures hold at most %d\n", createInfo->maxPoints, maxTexels);
+        return false;
+    }
+
+    PointSprites* newSprites = new PointSprites();
+    newSprites->maxPoints = createInfo->maxPoints;
+
+    // positions are rewritten every frame, stream mode orphans the storage instead of waiting for last frame's draw
+    ogls::createVertexBuffer(&newSprites->positionBuffer, nullptr, createInfo->maxPoints * sizeof(OglsVec2), Ogls_BufferMode_Stream);
+    ogls::labelVertexBuffer(newSprites->positionBuffer, "point sprite position buffer");
+
+    OglsVertexArrayAttribute positionAttribute = { 0, 2, sizeof(OglsVec2), Ogls_DataType_Float, (void*)0, false };
+    OglsVertexArrayCreateInfo vertexArrayCreateInfo{};
+    vertexArrayCreateInfo.vertexBuffer = newSprites->positionBuffer;
+    vertexArrayCreateInfo.pAttributes = &positionAttribute;
+    vertexArrayCreateInfo.attributeCount = 1;
+    ogls::createVertexArray(&newSprites->vertexArray, &vertexArrayCreateInfo);
+    ogls::labelVertexArray(newSprites->vertexArray, "point sprite vertex array");
+
+    ogls::createVertexBuffer(&newSprites->valueBuffer, nullptr, createInfo->maxPoints * sizeof(float), Ogls_BufferMode_Dynamic);
+    ogls::labelVertexBuffer(newSprites->valueBuffer, "point sprite value buffer");
+    ogls::createBufferTexture(&newSprites->valueTexture, newSprites->valueBuffer, Ogls_TextureFormat_R32F);
+    ogls::labelTexture(newSprites->valueTexture, "point sprite value buffer texture");
+
+    std::vector<uint8_t> texels;
+    buildColormap(createInfo->colormap, &texels);
+
+    OglsTextureCreateInfo colormapCreateInfo{};
+    colormapCreateInfo.width = s_ColormapSize;
+    colormapCreateInfo.height = 1;
+    colormapCreateInfo.format = Ogls_TextureFormat_RGBA8;
+    colormapCreateInfo.filter = Ogls_TextureFilter_Linear;
+    colormapCreateInfo.data = texels.data();
+    ogls::createTexture(&newSprites->colormapTexture, &colormapCreateInfo);
+    ogls::labelTexture(newSprites->colormapTexture, "point sprite colormap");
+
+    OglsShaderCreateInfo shaderCreateInfo{};
+    shaderCreateInfo.vertexSrc = s_SpriteVertexShaderSource;
+    shaderCreateInfo.fragmentSrc = s_SpriteFragmentShaderSource;
+    ogls::createShaderFromStr(&newSprites->shader, &shaderCreateInfo);
+    ogls::labelShader(newSprites->shader, "point sprite shader");
+
+    *sprites = newSprites;
+    return true;
+}
+
+void setPointSpriteColormap(PointSprites* sprites, PointSpriteColormap colormap)
+{
+    std::vector<uint8_t> texels;
+    buildColormap(colormap, &texels);
+    ogls::bindTextureSubData(sprites->colormapTexture, texels.data());
+}
+
+void updatePointSpritePositions(PointSprites* sprites, const OglsVec2* positions, uint32_t count)
+{
+    sprites->count = std::min(count, sprites->maxPoints);
+    if (sprites->count == 0) { return; }
+
+    ogls::bindVertexBufferSubData(sprites->positionBuffer, sprites->count * sizeof(OglsVec2), 0, positions);
+}
+
+void updatePointSpriteValues(PointSprites* sprites, const float* values, uint32_t count)
+{
+    count = std::min(count, sprites->maxPoints);
+    if (count == 0) { return; }
+
+    auto range = std::minmax_element(values, values + count);
+    sprites->lowest = *range.first;
+    sprites->highest = *range.second;
+
+    ogls::bindVertexBufferSubData(sprites->valueBuffer, count * sizeof(float), 0, values);
+}
+
+void drawPointSprites(PointSprites* sprites, const glm::mat4& camera, float pointSize)
+{
+    if (sprites->count == 0) { return; }
+
+    float spread = sprites->highest - sprites->lowest;
+
+    uint32_t id = ogls::getShaderId(sprites->shader);
+    ogls::bindShader(sprites->shader);
+    glUniformMatrix4fv(glGetUniformLocation(id, "u_Camera"), 1, GL_FALSE, glm::value_ptr(camera));
+    glUniform1f(glGetUniformLocation(id, "u_PointSize"), pointSize);
+    glUniform2f(glGetUniformLocation(id, "u_Range"), sprites->lowest, spread > 0.0f ? 1.0f / spread : 0.0f);
+    glUniform1f(glGetUniformLocation(id, "u_ColormapSize"), (float)s_ColormapSize);
+    glUniform1i(glGetUniformLocation(id, "u_Round"), pointSize > 2.0f);
+    glUniform1i(glGetUniformLocation(id, "u_Values"), 0);
+    glUniform1i(glGetUniformLocation(id, "u_Colormap"), 1);
+
+    ogls::bindTexture(sprites->valueTexture, 0);
+    ogls::bindTexture(sprites->colormapTexture, 1);
+    ogls::bindVertexArray(sprites->vertexArray);
+
+    glEnable(GL_PROGRAM_POINT_SIZE);
+    ogls::renderDrawMode(GL_POINTS, 0, sprites->count);
+    glDisable(GL_PROGRAM_POINT_SIZE);
+}
+
+uint32_t getPointSpriteMaxPoints(PointSprites* sprites)
+{
+    return sprites->maxPoints;
+}
+
+void destroyPointSprites(PointSprites* sprites)
+{
+    ogls::destroyShader(sprites->shader);
+    ogls::destroyTexture(sprites->colormapTexture);
+    ogls::destroyTexture(sprites->valueTexture);
+    ogls::destroyVertexBuffer(sprites->valueBuffer);
+    ogls::destroyVertexArray(sprites->vertexArray);
+    ogls::destroyVertexBuffer(sprites->positionBuffer);
+    delete sprites;
+}
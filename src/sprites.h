@@ -0,0 +1,37 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <glm/glm.hpp>
+
+#include "ogls.h"
+
+// draws up to millions of points as one GL_POINTS call. positions are streamed into a single buffer every frame,
+// the per point values that pick a color from the colormap only have to be uploaded when they change
+
+struct PointSprites;
+
+enum PointSpriteColormap
+{
+    PointSprite_Colormap_Viridis,
+    PointSprite_Colormap_Twilight, // cyclic, for values that wrap such as angles
+};
+
+struct PointSpritesCreateInfo
+{
+    uint32_t maxPoints;
+    PointSpriteColormap colormap;
+};
+
+bool createPointSprites(PointSprites** sprites, PointSpritesCreateInfo* createInfo);
+void setPointSpriteColormap(PointSprites* sprites, PointSpriteColormap colormap);
+void updatePointSpritePositions(PointSprites* sprites, const OglsVec2* positions, uint32_t count);
+
+// the lowest value maps to the start of the colormap and the highest to the end
+void updatePointSpriteValues(PointSprites* sprites, const float* values, uint32_t count);
+
+// sprites wider than two pixels are drawn as discs
+void drawPointSprites(PointSprites* sprites, const glm::mat4& camera, float pointSize);
+
+uint32_t getPointSpriteMaxPoints(PointSprites* sprites);
+void destroyPointSprites(PointSprites* sprites);
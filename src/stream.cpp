@@ -0,0 +1,338 @@
+#include "stream.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define STREAM_MAGIC   0x54535044 // "DPST"
+#define STREAM_VERSION 1
+
+static const uint32_t s_StreamDefaultBufferRecords = 4096;
+
+// a fifo is opened without blocking and retried at this interval until a reader shows up
+static const uint32_t s_StreamOpenRetryMs = 10;
+
+// once the stream is finishing, a reader that takes no data for this long is given up on and the rest is dropped
+static const uint32_t s_StreamFinishTimeoutMs = 2000;
+
+// longest csv line, step and time at full precision and four floats
+static const uint32_t s_StreamMaxCsvLine = 128;
+
+struct StreamHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t recordSize;
+    uint32_t decimation;
+};
+
+static_assert(sizeof(StreamRecord) == 32, "stream records are written as is");
+static_assert(sizeof(StreamHeader) == 16, "stream header is written as is");
+
+struct Stream
+{
+    std::string path; // empty when the descriptor was given
+    int fd;
+    StreamFormat format;
+    uint32_t decimation;
+    uint32_t capacity;
+
+    // front is filled by pushStreamRecord, back belongs to the writer while busy is set
+    std::vector<StreamRecord> front, back;
+    std::vector<char> text;
+
+    std::thread writer;
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::condition_variable idle;
+    bool busy, closing, quit;
+    std::chrono::steady_clock::time_point finishDeadline; // set with closing
+
+    uint64_t recordsKept;
+    std::atomic<uint64_t> recordsWritten, recordsDropped, bytesWritten;
+    std::atomic<bool> connected, failed;
+};
+
+static bool streamFinishExpired(Stream* stream)
+{
+    std::lock_guard<std::mutex> lock(stream->mutex);
+    return stream->closing && std::chrono::steady_clock::now() >= stream->finishDeadline;
+}
+
+// the descriptor stays blocking, it may be the program's own stdout. waiting happens in poll instead and every
+// write is at most what a writable pipe takes without blocking, so a reader that stopped reading cannot hold up
+// finishing for longer than the timeout
+static bool writeAll(Stream* stream, const void* data, size_t size)
+{
+    const uint8_t* bytes = (const uint8_t*)data;
+    while (size > 0)
+    {
+        pollfd target = { stream->fd, POLLOUT, 0 };
+        int ready = poll(&target, 1, (int)s_StreamOpenRetryMs);
+        if (ready < 0 && errno != EINTR) { return false; }
+        if (ready <= 0)
+        {
+            if (streamFinishExpired(stream))
+            {
+                errno = ETIMEDOUT;
+                return false;
+            }
+            continue;
+        }
+
+        ssize_t written = write(stream->fd, bytes, size < PIPE_BUF ? size : PIPE_BUF);
+        if (written < 0 && errno == EINTR) { continue; }
+        if (written <= 0) { return false; }
+
+        bytes += written;
+        size -= (size_t)written;
+    }
+
+    return true;
+}
+
+static bool openStreamTarget(Stream* stream)
+{
+    while (stream->fd < 0)
+    {
+        // without O_NONBLOCK opening a fifo waits for a reader and could never be given up on
+        int fd = open(stream->path.c_str(), O_WRONLY | O_CREAT | O_NONBLOCK, 0644);
+        if (fd >= 0)
+        {
+            fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_NONBLOCK);
+            stream->fd = fd;
+            break;
+        }
+
+        if (errno != ENXIO)
+        {
+            printf("stream: opening %s failed: %s\n", stream->path.c_str(), strerror(errno));
+            return false;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(stream->mutex);
+            if (stream->closing) { return false; }
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(s_StreamOpenRetryMs));
+    }
+
+    // a regular file given by path is started over, fifos and descriptors are written from wherever they are
+    struct stat info;
+    if (!stream->path.empty() && fstat(stream->fd, &info) == 0 && S_ISREG(info.st_mode) && ftruncate(stream->fd, 0) != 0)
+        return false;
+
+    if (stream->format == Stream_Format_Binary)
+    {
+        StreamHeader header = { STREAM_MAGIC, STREAM_VERSION, sizeof(StreamRecord), stream->decimation };
+        if (!writeAll(stream, &header, sizeof(header))) { return false; }
+        stream->bytesWritten += sizeof(header);
+    }
+    else
+    {
+        const char* columns = "step,t,a1,a2,av1,av2\n";
+        if (!writeAll(stream, columns, strlen(columns))) { return false; }
+        stream->bytesWritten += strlen(columns);
+    }
+
+    stream->connected = true;
+    return true;
+}
+
+static bool writeStreamRecords(Stream* stream, const std::vector<StreamRecord>& records)
+{
+    if (stream->format == Stream_Format_Binary)
+    {
+        size_t size = records.size() * sizeof(StreamRecord);
+        if (!writeAll(stream, records.data(), size)) { return false; }
+        stream->bytesWritten += size;
+        return true;
+    }
+
+    // enough digits that every value reads back to the same bits
+    stream->text.resize(records.size() * s_StreamMaxCsvLine);
+    size_t size = 0;
+    for (const StreamRecord& record : records)
+    {
+        size += (size_t)snprintf(stream->text.data() + size, s_StreamMaxCsvLine, "%llu,%.17g,%.9g,%.9g,%.9g,%.9g\n",
+            (unsigned long long)record.step, record.t, record.a1, record.a2, record.av1, record.av2);
+    }
+
+    if (!writeAll(stream, stream->text.data(), size)) { return false; }
+    stream->bytesWritten += size;
+    return true;
+}
+
+static void streamWriterThread(Stream* stream)
+{
+    if (!openStreamTarget(stream)) { stream->failed = true; }
+
+    std::unique_lock<std::mutex> lock(stream->mutex);
+    while (true)
+    {
+        stream->ready.wait(lock, [stream] { return stream->busy || stream->quit; });
+        if (!stream->busy) { return; }
+
+        lock.unlock();
+        if (!stream->failed && !writeStreamRecords(stream, stream->back))
+        {
+            // the reader is gone or stopped reading while finishing, everything from here on is dropped
+            if (errno == ETIMEDOUT) { printf("stream: reader stopped reading, dropping the rest\n"); }
+            else if (errno != EPIPE) { printf("stream: write failed: %s\n", strerror(errno)); }
+            stream->failed = true;
+        }
+
+        if (stream->failed) { stream->recordsDropped += stream->back.size(); }
+        else { stream->recordsWritten += stream->back.size(); }
+        stream->back.clear();
+        lock.lock();
+
+        stream->busy = false;
+        stream->idle.notify_all();
+    }
+}
+
+// hands the filled buffer over if the writer is free, without waiting for it or for the lock
+static bool trySwapStreamBuffers(Stream* stream)
+{
+    std::unique_lock<std::mutex> lock(stream->mutex, std::try_to_lock);
+    if (!lock.owns_lock() || stream->busy || stream->front.empty()) { return false; }
+
+    std::swap(stream->front, stream->back);
+    stream->busy = true;
+    stream->ready.notify_one();
+    return true;
+}
+
+bool streamFormatFromName(const char* name, StreamFormat* format)
+{
+    if (strcmp(name, "binary") == 0) { *format = Stream_Format_Binary; return true; }
+    if (strcmp(name, "csv") == 0) { *format = Stream_Format_Csv; return true; }
+    return false;
+}
+
+bool createStream(Stream** stream, StreamCreateInfo* createInfo)
+{
+    if (!createInfo->target || !createInfo->target[0]) { return false; }
+
+    int fd = -1;
+    if (strcmp(createInfo->target, "-") == 0)
+    {
+        fd = dup(STDOUT_FILENO);
+        if (fd < 0) { return false; }
+    }
+    else if (strncmp(createInfo->target, "fd:", 3) == 0)
+    {
+        char* end = nullptr;
+        long given = strtol(createInfo->target + 3, &end, 10);
+        if (end == createInfo->target + 3 || *end != '\0' || given < 0) { return false; }
+
+        fd = dup((int)given);
+        if (fd < 0) { return false; }
+    }
+
+    // a reader that exits would otherwise end the whole program on the next write
+    signal(SIGPIPE, SIG_IGN);
+
+    Stream* newStream = new Stream();
+    newStream->path = fd < 0 ? createInfo->target : "";
+    newStream->fd = fd;
+    newStream->format = createInfo->format;
+    newStream->decimation = createInfo->decimation ? createInfo->decimation : 1;
+    newStream->capacity = createInfo->bufferRecords ? createInfo->bufferRecords : s_StreamDefaultBufferRecords;
+    newStream->front.reserve(newStream->capacity);
+    newStream->back.reserve(newStream->capacity);
+    newStream->recordsWritten = 0;
+    newStream->recordsDropped = 0;
+    newStream->bytesWritten = 0;
+    newStream->connected = false;
+    newStream->failed = false;
+
+    newStream->writer = std::thread(streamWriterThread, newStream);
+
+    *stream = newStream;
+    return true;
+}
+
+void pushStreamRecord(Stream* stream, const StreamRecord* record)
+{
+    if (record->step % stream->decimation != 0) { return; }
+    stream->recordsKept++;
+
+    if (stream->failed || (stream->front.size() == stream->capacity && !trySwapStreamBuffers(stream)))
+    {
+        stream->recordsDropped++;
+        return;
+    }
+
+    // handed over as soon as the writer is free so a live reader is at most one write behind
+    stream->front.push_back(*record);
+    trySwapStreamBuffers(stream);
+}
+
+void finishStream(Stream* stream)
+{
+    std::unique_lock<std::mutex> lock(stream->mutex);
+    if (!stream->closing)
+    {
+        stream->closing = true;
+        stream->finishDeadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(s_StreamFinishTimeoutMs);
+    }
+    stream->idle.wait(lock, [stream] { return !stream->busy; });
+
+    if (stream->failed)
+    {
+        stream->recordsDropped += stream->front.size();
+        stream->front.clear();
+    }
+    else if (!stream->front.empty())
+    {
+        std::swap(stream->front, stream->back);
+        stream->busy = true;
+        stream->ready.notify_one();
+        stream->idle.wait(lock, [stream] { return !stream->busy; });
+    }
+}
+
+StreamStats getStreamStats(Stream* stream)
+{
+    StreamStats stats{};
+    stats.recordsKept = stream->recordsKept;
+    stats.recordsWritten = stream->recordsWritten;
+    stats.recordsDropped = stream->recordsDropped;
+    stats.bytesWritten = stream->bytesWritten;
+    stats.connected = stream->connected;
+    stats.failed = stream->failed;
+    return stats;
+}
+
+void destroyStream(Stream* stream)
+{
+    finishStream(stream);
+
+    {
+        std::lock_guard<std::mutex> lock(stream->mutex);
+        stream->quit = true;
+        stream->ready.notify_one();
+    }
+
+    stream->writer.join();
+    if (stream->fd >= 0) { close(stream->fd); }
+    delete stream;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <stdint.h>
+
+// live state output for other programs. records are collected in one buffer while a writer thread writes the
+// other, pushing never waits: when both buffers are taken the record is dropped and counted. the target is
+// opened on the writer thread, so a fifo without a reader yet only drops records until one connects
+//
+// binary streams start with a 16 byte header (magic "DPST", version, record size, decimation) followed by
+// StreamRecord as is, csv streams start with a line of column names
+
+struct Stream;
+
+enum StreamFormat
+{
+    Stream_Format_Binary,
+    Stream_Format_Csv,
+};
+
+struct StreamRecord
+{
+    uint64_t step;
+    double t;
+    float a1, a2;
+    float av1, av2;
+};
+
+struct StreamCreateInfo
+{
+    const char* target;      // "-" for stdout, "fd:N" for an open descriptor, otherwise a file or fifo path
+    StreamFormat format;
+    uint32_t decimation;     // every nth step is kept, 0 or 1 keeps all
+    uint32_t bufferRecords;  // per buffer, 0 picks a default
+};
+
+struct StreamStats
+{
+    uint64_t recordsKept;    // after decimation
+    uint64_t recordsWritten;
+    uint64_t recordsDropped; // both buffers were full, or the reader went away
+    uint64_t bytesWritten;
+    bool connected;
+    bool failed;
+};
+
+bool streamFormatFromName(const char* name, StreamFormat* format);
+bool createStream(Stream** stream, StreamCreateInfo* createInfo);
+void pushStreamRecord(Stream* stream, const StreamRecord* record);
+
+// hands the last records to the writer and waits until they are written or the reader is gone. a reader that takes
+// nothing for two seconds is given up on and what is left is dropped
+void finishStream(Stream* stream);
+StreamStats getStreamStats(Stream* stream);
+void destroyStream(Stream* stream);
@@ -0,0 +1,210 @@
+#include "summary.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "trajectory.h"
+
+#define SUMMARY_MAGIC   0x4d535044 // "DPSM"
+#define SUMMARY_VERSION 1
+
+static const uint32_t s_SummaryDefaultRowGroupRows = 65536;
+
+struct SummaryHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t columns;
+    uint32_t rowGroupRows;
+    uint64_t rows;
+    uint32_t rowGroups;
+    uint32_t integrator;
+    EnsembleParams params;
+    float dt;
+    uint64_t steps;
+};
+
+struct SummaryIndexEntry
+{
+    uint64_t offset;
+    uint32_t rows;
+    float min, max;
+    uint32_t reserved;
+};
+
+static_assert(sizeof(SummaryHeader) == 64, "summary header is written as is");
+static_assert(sizeof(SummaryIndexEntry) == 24, "summary index is written as is");
+
+struct SummaryReader
+{
+    const uint8_t* data;
+    size_t size;
+    const SummaryHeader* header;
+    const SummaryIndexEntry* index;
+};
+
+static const char* s_SummaryColumnNames[Ensemble_Summary_Count] = { "a1", "a2", "av1", "av2", "flip_time", "energy_error", "lyapunov" };
+
+static bool writeAll(int fd, const void* data, size_t size, uint64_t offset)
+{
+    const uint8_t* bytes = (const uint8_t*)data;
+    while (size > 0)
+    {
+        ssize_t written = pwrite(fd, bytes, size, (off_t)offset);
+        if (written < 0 && errno == EINTR) { continue; }
+        if (written <= 0) { return false; }
+
+        bytes += written;
+        size -= (size_t)written;
+        offset += (uint64_t)written;
+    }
+
+    return true;
+}
+
+bool writeSummaryFile(const char* path, Ensemble* ensemble, uint32_t rowGroupRows)
+{
+    const float* columns[Ensemble_Summary_Count];
+    EnsembleSummaryInfo info;
+    if (!getEnsembleSummaries(ensemble, columns, &info)) { return false; }
+
+    SummaryHeader header{};
+    header.magic = SUMMARY_MAGIC;
+    header.version = SUMMARY_VERSION;
+    header.columns = Ensemble_Summary_Count;
+    header.rowGroupRows = rowGroupRows ? rowGroupRows : s_SummaryDefaultRowGroupRows;
+    header.rows = getEnsembleCount(ensemble);
+    header.rowGroups = (uint32_t)((header.rows + header.rowGroupRows - 1) / header.rowGroupRows);
+    header.integrator = Trajectory_Integrator_SemiImplicitEuler;
+    header.params = info.params;
+    header.dt = info.dt;
+    header.steps = info.steps;
+
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) { return false; }
+
+    std::vector<SummaryIndexEntry> index((size_t)header.rowGroups * Ensemble_Summary_Count);
+    uint64_t offset = sizeof(SummaryHeader) + index.size() * sizeof(SummaryIndexEntry);
+    bool ok = true;
+
+    // every column of a row group is a slice of the ensemble's own array, written as it is
+    for (uint32_t group = 0; ok && group < header.rowGroups; group++)
+    {
+        uint64_t first = (uint64_t)group * header.rowGroupRows;
+        uint32_t rows = (uint32_t)std::min<uint64_t>(header.rowGroupRows, header.rows - first);
+
+        for (uint32_t column = 0; ok && column < Ensemble_Summary_Count; column++)
+        {
+            const float* values = columns[column] + first;
+            SummaryIndexEntry& entry = index[(size_t)group * Ensemble_Summary_Count + column];
+            entry.offset = offset;
+            entry.rows = rows;
+            entry.min = INFINITY;
+            entry.max = -INFINITY;
+            for (uint32_t i = 0; i < rows; i++)
+            {
+                entry.min = std::fmin(entry.min, values[i]);
+                entry.max = std::fmax(entry.max, values[i]);
+            }
+
+            ok = writeAll(fd, values, (size_t)rows * sizeof(float), offset);
+            offset += (uint64_t)rows * sizeof(float);
+        }
+    }
+
+    ok = ok && writeAll(fd, index.data(), index.size() * sizeof(SummaryIndexEntry), sizeof(SummaryHeader));
+    ok = ok && writeAll(fd, &header, sizeof(header), 0);
+    ok = close(fd) == 0 && ok;
+    return ok;
+}
+
+bool openSummaryFile(SummaryReader** reader, const char* path)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) { return false; }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(SummaryHeader))
+    {
+        close(fd);
+        return false;
+    }
+
+    size_t size = (size_t)info.st_size;
+    void* data = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) { return false; }
+
+    const SummaryHeader* header = (const SummaryHeader*)data;
+    const SummaryIndexEntry* index = (const SummaryIndexEntry*)(header + 1);
+    size_t indexEnd = sizeof(SummaryHeader) + (size_t)header->rowGroups * Ensemble_Summary_Count * sizeof(SummaryIndexEntry);
+
+    bool valid = header->magic == SUMMARY_MAGIC && header->version == SUMMARY_VERSION && header->columns == Ensemble_Summary_Count &&
+        header->rowGroupRows > 0 && header->rowGroups == (header->rows + header->rowGroupRows - 1) / header->rowGroupRows && indexEnd <= size;
+
+    // every column has to lie inside the file, a truncated one is refused rather than read past its end
+    for (size_t i = 0; valid && i < (size_t)header->rowGroups * Ensemble_Summary_Count; i++)
+        valid = index[i].offset >= indexEnd && index[i].offset % sizeof(float) == 0 && index[i].rows <= header->rowGroupRows &&
+            index[i].offset + (uint64_t)index[i].rows * sizeof(float) <= size;
+
+    if (!valid)
+    {
+        munmap(data, size);
+        return false;
+    }
+
+    SummaryReader* newReader = new SummaryReader();
+    newReader->data = (const uint8_t*)data;
+    newReader->size = size;
+    newReader->header = header;
+    newReader->index = index;
+
+    *reader = newReader;
+    return true;
+}
+
+SummaryInfo getSummaryInfo(SummaryReader* reader)
+{
+    const SummaryHeader* header = reader->header;
+
+    SummaryInfo info{};
+    info.params = header->params;
+    info.dt = header->dt;
+    info.integrator = header->integrator;
+    info.steps = header->steps;
+    info.rows = header->rows;
+    info.rowGroups = header->rowGroups;
+    info.rowGroupRows = header->rowGroupRows;
+    return info;
+}
+
+const char* getSummaryColumnName(EnsembleSummary column)
+{
+    return s_SummaryColumnNames[column];
+}
+
+SummaryColumn getSummaryColumn(SummaryReader* reader, uint32_t rowGroup, EnsembleSummary column)
+{
+    const SummaryIndexEntry& entry = reader->index[(size_t)rowGroup * Ensemble_Summary_Count + column];
+
+    SummaryColumn result{};
+    result.values = (const float*)(reader->data + entry.offset);
+    result.rows = entry.rows;
+    result.min = entry.min;
+    result.max = entry.max;
+    return result;
+}
+
+void closeSummaryFile(SummaryReader* reader)
+{
+    munmap((void*)reader->data, reader->size);
+    delete reader;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "ensemble.h"
+
+// per member summaries of an ensemble run stored by column for analysis. members are cut into row groups of a
+// fixed number of rows, and each row group holds one contiguous float array per EnsembleSummary column, so
+//   header    parameters of the run, row and row group counts
+//   index     for every row group and column: where its values are, how many there are, their min and max
+//   values    row group 0 column 0, row group 0 column 1, ... each written straight from the ensemble's arrays
+// a reader maps the file, looks at the min and max of the row groups it could skip and reads single columns
+// of the rest in place. NaN values are left out of min and max
+
+struct SummaryReader;
+
+struct SummaryInfo
+{
+    EnsembleParams params;
+    float dt;
+    uint32_t integrator;   // TrajectoryIntegrator
+    uint64_t steps;
+    uint64_t rows;         // one per ensemble member
+    uint32_t rowGroups;
+    uint32_t rowGroupRows; // every row group but the last has this many rows
+};
+
+struct SummaryColumn
+{
+    const float* values;
+    uint32_t rows;
+    float min, max;
+};
+
+// rowGroupRows 0 picks a default. false when the ensemble has no summaries yet or the file could not be written
+bool writeSummaryFile(const char* path, Ensemble* ensemble, uint32_t rowGroupRows);
+
+bool openSummaryFile(SummaryReader** reader, const char* path);
+SummaryInfo getSummaryInfo(SummaryReader* reader);
+const char* getSummaryColumnName(EnsembleSummary column);
+
+// min and max come from the index, values is only touched when the caller reads it
+SummaryColumn getSummaryColumn(SummaryReader* reader, uint32_t rowGroup, EnsembleSummary column);
+void closeSummaryFile(SummaryReader* reader);
@@ -0,0 +1,229 @@
+#include "tilecache.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <filesystem>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#define TILE_CACHE_MAGIC   0x544d5044 // "DPMT"
+#define TILE_CACHE_VERSION 2
+
+static const uint64_t s_TileCacheDefaultMaxBytes = 512ull << 20;
+
+struct TileCacheHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t keySize;
+    uint32_t valueCount;
+    uint64_t checksum; // of the values, a tile torn by a crash or a full disk reads as a miss
+};
+
+static_assert(sizeof(TileCacheHeader) == 24, "tile headers are read and written as is");
+
+struct TileCacheEntry
+{
+    uint64_t bytes;
+    std::filesystem::file_time_type used;
+};
+
+struct TileCacheMapping
+{
+    void* memory;
+    size_t size;
+};
+
+struct TileCache
+{
+    std::string directory;
+    uint64_t maxBytes;
+    std::unordered_map<uint64_t, TileCacheEntry> entries;
+    std::vector<TileCacheMapping> mappings;
+    uint64_t tempSuffix; // per launch, two launches storing the same tile never write into one file
+    TileCacheStats stats;
+};
+
+// fnv-1a, the key is kept in the file too so for keys this only has to spread them over file names
+static uint64_t hashTileBytes(const void* data, size_t size)
+{
+    const uint8_t* bytes = (const uint8_t*)data;
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+
+    return hash;
+}
+
+static std::string getTilePath(TileCache* cache, uint64_t hash)
+{
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.tile", (unsigned long long)hash);
+    return (std::filesystem::path(cache->directory) / name).string();
+}
+
+static void evictTiles(TileCache* cache, uint64_t keep)
+{
+    while (cache->stats.bytes > cache->maxBytes)
+    {
+        auto oldest = cache->entries.end();
+        for (auto it = cache->entries.begin(); it != cache->entries.end(); ++it)
+        {
+            if (it->first != keep && (oldest == cache->entries.end() || it->second.used < oldest->second.used)) { oldest = it; }
+        }
+        if (oldest == cache->entries.end()) { return; }
+
+        // a tile that is still mapped stays readable, unlinking only takes its name
+        std::error_code error;
+        std::filesystem::remove(getTilePath(cache, oldest->first), error);
+        cache->stats.bytes -= oldest->second.bytes;
+        cache->stats.tiles--;
+        cache->stats.evicted++;
+        cache->entries.erase(oldest);
+    }
+}
+
+bool createTileCache(TileCache** cache, TileCacheCreateInfo* createInfo)
+{
+    if (!createInfo->directory || !createInfo->directory[0]) { return false; }
+
+    std::error_code error;
+    std::filesystem::create_directories(createInfo->directory, error);
+    if (error)
+    {
+        printf("tile cache: could not create %s\n", createInfo->directory);
+        return false;
+    }
+
+    TileCache* newCache = new TileCache();
+    newCache->directory = createInfo->directory;
+    newCache->maxBytes = createInfo->maxBytes ? createInfo->maxBytes : s_TileCacheDefaultMaxBytes;
+    newCache->tempSuffix = ((uint64_t)std::random_device{}() << 32) | std::random_device{}();
+
+    // the files are the index, whatever an earlier launch left behind is picked up in its order of use
+    for (const std::filesystem::directory_entry& file : std::filesystem::directory_iterator(newCache->directory, error))
+    {
+        std::string name = file.path().filename().string();
+        if (name.size() != 21 || name.compare(16, 5, ".tile") != 0 || !file.is_regular_file(error)) { continue; }
+
+        TileCacheEntry entry{};
+        entry.bytes = file.file_size(error);
+        entry.used = file.last_write_time(error);
+        newCache->entries[std::strtoull(name.substr(0, 16).c_str(), nullptr, 16)] = entry;
+        newCache->stats.tiles++;
+        newCache->stats.bytes += entry.bytes;
+    }
+
+    evictTiles(newCache, 0);
+
+    *cache = newCache;
+    return true;
+}
+
+const float* loadTile(TileCache* cache, const void* key, uint32_t keySize, uint32_t valueCount)
+{
+    uint64_t hash = hashTileBytes(key, keySize);
+    auto entry = cache->entries.find(hash);
+    if (entry == cache->entries.end())
+    {
+        cache->stats.misses++;
+        return nullptr;
+    }
+
+    std::string path = getTilePath(cache, hash);
+    size_t size = sizeof(TileCacheHeader) + keySize + (size_t)valueCount * sizeof(float);
+    void* memory = MAP_FAILED;
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd >= 0)
+    {
+        struct stat info;
+        if (fstat(fd, &info) == 0 && (size_t)info.st_size == size)
+            memory = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+    }
+
+    const TileCacheHeader* header = (const TileCacheHeader*)memory;
+    const float* values = memory != MAP_FAILED ? (const float*)((const uint8_t*)(header + 1) + keySize) : nullptr;
+    if (memory == MAP_FAILED || header->magic != TILE_CACHE_MAGIC || header->version != TILE_CACHE_VERSION ||
+        header->keySize != keySize || header->valueCount != valueCount || memcmp(header + 1, key, keySize) != 0 ||
+        header->checksum != hashTileBytes(values, (size_t)valueCount * sizeof(float)))
+    {
+        if (memory != MAP_FAILED) { munmap(memory, size); }
+        cache->stats.misses++;
+        return nullptr;
+    }
+
+    cache->mappings.push_back({ memory, size });
+
+    std::error_code error;
+    entry->second.used = std::filesystem::file_time_type::clock::now();
+    std::filesystem::last_write_time(path, entry->second.used, error);
+
+    cache->stats.hits++;
+    return values;
+}
+
+bool storeTile(TileCache* cache, const void* key, uint32_t keySize, const float* values, uint32_t valueCount)
+{
+    if (keySize % sizeof(float) != 0) { return false; }
+
+    uint64_t hash = hashTileBytes(key, keySize);
+    TileCacheHeader header = { TILE_CACHE_MAGIC, TILE_CACHE_VERSION, keySize, valueCount,
+        hashTileBytes(values, (size_t)valueCount * sizeof(float)) };
+
+    // written to a temporary file and renamed so another launch never maps a partial tile
+    char suffix[32];
+    snprintf(suffix, sizeof(suffix), ".%016llx.tmp", (unsigned long long)cache->tempSuffix);
+    std::string path = getTilePath(cache, hash);
+    std::string tempPath = path + suffix;
+
+    FILE* file = fopen(tempPath.c_str(), "wb");
+    if (!file) { return false; }
+
+    bool written = fwrite(&header, sizeof(header), 1, file) == 1 && fwrite(key, 1, keySize, file) == keySize &&
+        fwrite(values, sizeof(float), valueCount, file) == valueCount;
+    written = fclose(file) == 0 && written;
+
+    std::error_code error;
+    if (written) { std::filesystem::rename(tempPath, path, error); }
+    if (!written || error)
+    {
+        std::filesystem::remove(tempPath, error);
+        return false;
+    }
+
+    TileCacheEntry& entry = cache->entries[hash];
+    cache->stats.bytes += sizeof(header) + keySize + (uint64_t)valueCount * sizeof(float);
+    if (entry.bytes == 0) { cache->stats.tiles++; }
+    else { cache->stats.bytes -= entry.bytes; }
+
+    entry.bytes = sizeof(header) + keySize + (uint64_t)valueCount * sizeof(float);
+    entry.used = std::filesystem::file_time_type::clock::now();
+    cache->stats.stored++;
+
+    evictTiles(cache, hash);
+    return true;
+}
+
+TileCacheStats getTileCacheStats(TileCache* cache)
+{
+    return cache->stats;
+}
+
+void destroyTileCache(TileCache* cache)
+{
+    for (const TileCacheMapping& mapping : cache->mappings)
+        munmap(mapping.memory, mapping.size);
+    delete cache;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <stdint.h>
+
+// float tiles that took long to compute, kept on disk between launches. a tile is stored under a key the caller
+// packs from everything its values depend on, the file is named by a hash of the key and holds the key itself,
+// so a hash collision reads as a miss, and a checksum of the values so a torn file does too. hits are mapped
+// rather than read. when the directory grows past maxBytes the least recently used tiles are deleted, use is
+// tracked through the files' modification times so the order survives restarts
+
+struct TileCache;
+
+struct TileCacheCreateInfo
+{
+    const char* directory; // created if missing
+    uint64_t maxBytes;     // 0 picks a default
+};
+
+struct TileCacheStats
+{
+    uint64_t hits, misses;
+    uint64_t stored, evicted;
+    uint64_t tiles, bytes; // on disk now
+};
+
+bool createTileCache(TileCache** cache, TileCacheCreateInfo* createInfo);
+
+// valueCount floats mapped from the tile's file, valid until the cache is destroyed. null on a miss.
+// keySize has to be a multiple of 4
+const float* loadTile(TileCache* cache, const void* key, uint32_t keySize, uint32_t valueCount);
+bool storeTile(TileCache* cache, const void* key, uint32_t keySize, const float* values, uint32_t valueCount);
+
+TileCacheStats getTileCacheStats(TileCache* cache);
+void destroyTileCache(TileCache* cache);
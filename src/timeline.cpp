@@ -0,0 +1,162 @@
+#include "timeline.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include "physics.h"
+
+// a keyframe every 128 steps is 128 times less than keeping every step, and rebuilding the furthest step
+// from a keyframe takes microseconds
+static const uint32_t s_TimelineDefaultKeyframeInterval = 128;
+
+// about 12000 keyframes, 1.5 million steps or seven hours at the default time step
+static const size_t s_TimelineDefaultMemoryBudget = 1 << 20;
+
+struct Timeline
+{
+    uint32_t keyframeInterval;
+
+    // ring of keyframes in step order, oldest at head
+    std::vector<CheckpointState> keyframes;
+    size_t head, count;
+
+    // the state after the last recorded one, what the next recorded state has to match to continue without a keyframe
+    CheckpointState next;
+    bool hasNext;
+
+    TimelineStats stats;
+};
+
+// the step main.cpp takes, so rebuilt states are bit for bit the ones the run went through
+static void stepTimelineState(CheckpointState* state)
+{
+    float g = (state->flags & Checkpoint_Flag_GravityOn) ? state->g : 0.0f;
+    stepPendulum(state->m1, state->m2, state->l1, state->l2, g, state->dt, state->a1, state->a2, state->av1, state->av2, state->aa1, state->aa2);
+    state->a1 = wrapAngle(state->a1);
+    state->a2 = wrapAngle(state->a2);
+    state->time += state->dt;
+    state->step++;
+}
+
+// everything the step reads or writes, pausing and the ensemble spread do not break the history
+static bool sameDynamics(const CheckpointState* a, const CheckpointState* b)
+{
+    CheckpointState x = *a, y = *b;
+    x.flags &= Checkpoint_Flag_GravityOn;
+    y.flags &= Checkpoint_Flag_GravityOn;
+    x.ensembleSpread = y.ensembleSpread = 0.0f;
+    x.rngState = y.rngState = 0;
+    return memcmp(&x, &y, sizeof(CheckpointState)) == 0;
+}
+
+static CheckpointState& keyframeAt(Timeline* timeline, size_t index)
+{
+    return timeline->keyframes[(timeline->head + index) % timeline->keyframes.size()];
+}
+
+static void pushKeyframe(Timeline* timeline, const CheckpointState* state)
+{
+    if (timeline->count == timeline->keyframes.size())
+    {
+        timeline->head = (timeline->head + 1) % timeline->keyframes.size();
+        timeline->count--;
+    }
+
+    keyframeAt(timeline, timeline->count++) = *state;
+}
+
+bool createTimeline(Timeline** timeline, TimelineCreateInfo* createInfo)
+{
+    size_t budget = createInfo->memoryBudget ? createInfo->memoryBudget : s_TimelineDefaultMemoryBudget;
+    size_t capacity = budget / sizeof(CheckpointState);
+    if (capacity < 2) { return false; }
+
+    Timeline* newTimeline = new Timeline();
+    newTimeline->keyframeInterval = createInfo->keyframeInterval ? createInfo->keyframeInterval : s_TimelineDefaultKeyframeInterval;
+    newTimeline->keyframes.resize(capacity);
+
+    *timeline = newTimeline;
+    return true;
+}
+
+void recordTimelineState(Timeline* timeline, const CheckpointState* state)
+{
+    // a state from before the end of the history is a branch, whatever came after it is gone
+    while (timeline->count > 0 && keyframeAt(timeline, timeline->count - 1).step >= state->step)
+        timeline->count--;
+
+    bool continues = timeline->hasNext && sameDynamics(&timeline->next, state);
+    if (!continues || timeline->count == 0 || state->step - keyframeAt(timeline, timeline->count - 1).step >= timeline->keyframeInterval)
+        pushKeyframe(timeline, state);
+
+    timeline->next = *state;
+    stepTimelineState(&timeline->next);
+    timeline->hasNext = true;
+}
+
+bool getTimelineRange(Timeline* timeline, uint64_t* first, uint64_t* last)
+{
+    if (timeline->count == 0) { return false; }
+
+    *first = keyframeAt(timeline, 0).step;
+    *last = timeline->next.step;
+    return true;
+}
+
+bool getTimelineState(Timeline* timeline, uint64_t step, CheckpointState* state)
+{
+    uint64_t first, last;
+    if (!getTimelineRange(timeline, &first, &last) || step < first || step > last) { return false; }
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    // last keyframe at or before the step, steps only increase along the ring
+    size_t low = 0, high = timeline->count;
+    while (high - low > 1)
+    {
+        size_t middle = (low + high) / 2;
+        if (keyframeAt(timeline, middle).step <= step) { low = middle; }
+        else { high = middle; }
+    }
+
+    CheckpointState rebuilt = keyframeAt(timeline, low);
+    uint32_t steps = 0;
+    while (rebuilt.step < step)
+    {
+        stepTimelineState(&rebuilt);
+        steps++;
+    }
+
+    // pausing, the rng and the spread are whatever they were at the last recorded state
+    rebuilt.flags = (rebuilt.flags & Checkpoint_Flag_GravityOn) | (timeline->next.flags & ~Checkpoint_Flag_GravityOn);
+    rebuilt.rngState = timeline->next.rngState;
+    rebuilt.ensembleSpread = timeline->next.ensembleSpread;
+    *state = rebuilt;
+
+    timeline->stats.lastRebuildSteps = steps;
+    timeline->stats.lastRebuildMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    return true;
+}
+
+void clearTimeline(Timeline* timeline)
+{
+    timeline->head = 0;
+    timeline->count = 0;
+    timeline->hasNext = false;
+}
+
+TimelineStats getTimelineStats(Timeline* timeline)
+{
+    TimelineStats stats = timeline->stats;
+    stats.keyframes = timeline->count;
+    stats.bytes = timeline->count * sizeof(CheckpointState);
+    return stats;
+}
+
+void destroyTimeline(Timeline* timeline)
+{
+    delete timeline;
+}
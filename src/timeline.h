@@ -0,0 +1,41 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "checkpoint.h"
+
+// rewind history of the pendulum. a ring of keyframes holds the full state every keyframeInterval steps and
+// wherever the state stops following from the previous step (an edit in the settings window, a restore), any
+// step in between is rebuilt by stepping forward from the keyframe before it with the same integration main.cpp
+// uses. when the ring is full the oldest keyframes are dropped. ensemble members are not part of it
+
+struct Timeline;
+
+struct TimelineCreateInfo
+{
+    uint32_t keyframeInterval; // 0 picks a default
+    size_t memoryBudget;       // bytes of keyframes, 0 picks a default
+};
+
+struct TimelineStats
+{
+    uint64_t keyframes;
+    size_t bytes;              // of keyframes held, the budget is allocated up front
+    uint32_t lastRebuildSteps; // steps taken by the last getTimelineState
+    double lastRebuildMs;
+};
+
+bool createTimeline(Timeline** timeline, TimelineCreateInfo* createInfo);
+
+// the state the next step starts from, called right before every step. a state at or before one already
+// recorded starts a new branch and drops everything after it
+void recordTimelineState(Timeline* timeline, const CheckpointState* state);
+
+// steps that can be rebuilt, up to and including the one after the last recorded state
+bool getTimelineRange(Timeline* timeline, uint64_t* first, uint64_t* last);
+bool getTimelineState(Timeline* timeline, uint64_t step, CheckpointState* state);
+
+void clearTimeline(Timeline* timeline);
+TimelineStats getTimelineStats(Timeline* timeline);
+void destroyTimeline(Timeline* timeline);
@@ -0,0 +1,309 @@
+#include "trajectory.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#define TRAJECTORY_MAGIC         0x4a545044 // "DPTJ"
+#define TRAJECTORY_TRAILER_MAGIC 0x49545044 // "DPTI"
+#define TRAJECTORY_VERSION       1
+
+// writes are whole multiples of the page size at page aligned file offsets, the header is part of the first one
+static const uint32_t s_TrajectoryWriteAlignment = 4096;
+static const uint32_t s_TrajectoryDefaultBufferSize = 1 << 20;
+static const uint32_t s_TrajectoryDefaultIndexInterval = 4096;
+
+struct TrajectoryHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t headerSize;
+    uint32_t frameSize;
+    uint32_t indexInterval;
+    TrajectoryParams params;
+    uint32_t reserved[4];
+};
+
+struct TrajectoryTrailer
+{
+    uint64_t frameCount;
+    uint64_t indexOffset;
+    uint64_t indexCount;
+    uint32_t magic;
+    uint32_t version;
+};
+
+static_assert(sizeof(TrajectoryFrame) == 24, "trajectory frames are stored as is");
+static_assert(sizeof(TrajectoryHeader) == 64, "trajectory header is stored as is");
+static_assert(sizeof(TrajectoryTrailer) == 32, "trajectory trailer is stored as is");
+
+struct TrajectoryWriter
+{
+    int fd;
+    uint8_t* buffer;
+    uint32_t bufferSize, bufferUsed;
+    uint32_t indexInterval;
+    uint64_t frameCount;
+    std::vector<double> index; // 8 bytes per indexInterval frames, a billion frames at the default interval is 2 MB
+    bool failed, finished;
+};
+
+struct TrajectoryReader
+{
+    const uint8_t* data;
+    size_t size;
+    TrajectoryHeader header;
+    const TrajectoryFrame* frames;
+    uint64_t frameCount;
+    const double* index;
+    uint64_t indexCount;
+};
+
+static bool writeAll(int fd, const uint8_t* data, size_t size)
+{
+    while (size > 0)
+    {
+        ssize_t written = write(fd, data, size);
+        if (written < 0 && errno == EINTR) { continue; }
+        if (written <= 0) { return false; }
+
+        data += written;
+        size -= (size_t)written;
+    }
+
+    return true;
+}
+
+static bool flushTrajectoryBuffer(TrajectoryWriter* writer)
+{
+    if (writer->bufferUsed == 0 || writer->failed) { return !writer->failed; }
+
+    if (!writeAll(writer->fd, writer->buffer, writer->bufferUsed))
+    {
+        printf("trajectory: write failed: %s\n", strerror(errno));
+        writer->failed = true;
+        return false;
+    }
+
+    writer->bufferUsed = 0;
+    return true;
+}
+
+static bool appendTrajectoryBytes(TrajectoryWriter* writer, const void* data, size_t size)
+{
+    const uint8_t* bytes = (const uint8_t*)data;
+    while (size > 0)
+    {
+        // frames do not divide the buffer evenly, one may be split across two writes
+        uint32_t copy = (uint32_t)std::min<size_t>(size, writer->bufferSize - writer->bufferUsed);
+        memcpy(writer->buffer + writer->bufferUsed, bytes, copy);
+        writer->bufferUsed += copy;
+        bytes += copy;
+        size -= copy;
+
+        if (writer->bufferUsed == writer->bufferSize && !flushTrajectoryBuffer(writer)) { return false; }
+    }
+
+    return true;
+}
+
+bool createTrajectoryWriter(TrajectoryWriter** writer, TrajectoryWriterCreateInfo* createInfo)
+{
+    int fd = open(createInfo->path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) { return false; }
+
+    uint32_t bufferSize = createInfo->bufferSize ? createInfo->bufferSize : s_TrajectoryDefaultBufferSize;
+    bufferSize = (bufferSize + s_TrajectoryWriteAlignment - 1) / s_TrajectoryWriteAlignment * s_TrajectoryWriteAlignment;
+
+    void* buffer = nullptr;
+    if (posix_memalign(&buffer, s_TrajectoryWriteAlignment, bufferSize) != 0)
+    {
+        close(fd);
+        return false;
+    }
+
+    TrajectoryWriter* newWriter = new TrajectoryWriter();
+    newWriter->fd = fd;
+    newWriter->buffer = (uint8_t*)buffer;
+    newWriter->bufferSize = bufferSize;
+    newWriter->indexInterval = createInfo->indexInterval ? createInfo->indexInterval : s_TrajectoryDefaultIndexInterval;
+
+    TrajectoryHeader header{};
+    header.magic = TRAJECTORY_MAGIC;
+    header.version = TRAJECTORY_VERSION;
+    header.headerSize = sizeof(TrajectoryHeader);
+    header.frameSize = sizeof(TrajectoryFrame);
+    header.indexInterval = newWriter->indexInterval;
+    header.params = createInfo->params;
+    appendTrajectoryBytes(newWriter, &header, sizeof(header));
+
+    *writer = newWriter;
+    return true;
+}
+
+bool writeTrajectoryFrame(TrajectoryWriter* writer, const TrajectoryFrame* frame)
+{
+    if (writer->failed || writer->finished) { return false; }
+
+    if (writer->frameCount % writer->indexInterval == 0)
+        writer->index.push_back(frame->t);
+
+    writer->frameCount++;
+    return appendTrajectoryBytes(writer, frame, sizeof(TrajectoryFrame));
+}
+
+bool finishTrajectoryWriter(TrajectoryWriter* writer)
+{
+    if (writer->finished) { return !writer->failed; }
+    writer->finished = true;
+
+    TrajectoryTrailer trailer{};
+    trailer.frameCount = writer->frameCount;
+    trailer.indexOffset = sizeof(TrajectoryHeader) + writer->frameCount * sizeof(TrajectoryFrame);
+    trailer.indexCount = writer->index.size();
+    trailer.magic = TRAJECTORY_TRAILER_MAGIC;
+    trailer.version = TRAJECTORY_VERSION;
+
+    appendTrajectoryBytes(writer, writer->index.data(), writer->index.size() * sizeof(double));
+    appendTrajectoryBytes(writer, &trailer, sizeof(trailer));
+    flushTrajectoryBuffer(writer);
+
+    return !writer->failed;
+}
+
+uint64_t getTrajectoryWriterFrameCount(TrajectoryWriter* writer)
+{
+    return writer->frameCount;
+}
+
+void destroyTrajectoryWriter(TrajectoryWriter* writer)
+{
+    finishTrajectoryWriter(writer);
+    close(writer->fd);
+    free(writer->buffer);
+    delete writer;
+}
+
+bool openTrajectory(TrajectoryReader** reader, const char* path)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) { return false; }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(TrajectoryHeader))
+    {
+        close(fd);
+        return false;
+    }
+
+    // the mapping stays valid after the descriptor is closed
+    size_t size = (size_t)info.st_size;
+    void* data = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) { return false; }
+
+    TrajectoryHeader header;
+    memcpy(&header, data, sizeof(header));
+    if (header.magic != TRAJECTORY_MAGIC || header.version != TRAJECTORY_VERSION ||
+        header.headerSize != sizeof(TrajectoryHeader) || header.frameSize != sizeof(TrajectoryFrame) || header.indexInterval == 0)
+    {
+        munmap(data, size);
+        return false;
+    }
+
+    TrajectoryReader* newReader = new TrajectoryReader();
+    newReader->data = (const uint8_t*)data;
+    newReader->size = size;
+    newReader->header = header;
+    newReader->frames = (const TrajectoryFrame*)(newReader->data + sizeof(TrajectoryHeader));
+
+    // a trailer is only trusted if everything it describes fits the file exactly
+    TrajectoryTrailer trailer{};
+    if (size >= sizeof(TrajectoryHeader) + sizeof(TrajectoryTrailer))
+        memcpy(&trailer, newReader->data + size - sizeof(TrajectoryTrailer), sizeof(trailer));
+
+    bool indexed = trailer.magic == TRAJECTORY_TRAILER_MAGIC && trailer.version == TRAJECTORY_VERSION &&
+        trailer.indexOffset == sizeof(TrajectoryHeader) + trailer.frameCount * sizeof(TrajectoryFrame) &&
+        trailer.indexCount == (trailer.frameCount + header.indexInterval - 1) / header.indexInterval &&
+        trailer.indexOffset + trailer.indexCount * sizeof(double) + sizeof(TrajectoryTrailer) == size;
+
+    if (indexed)
+    {
+        newReader->frameCount = trailer.frameCount;
+        newReader->index = (const double*)(newReader->data + trailer.indexOffset);
+        newReader->indexCount = trailer.indexCount;
+    }
+    else
+    {
+        // unfinished run, every whole frame after the header counts and a torn last frame is ignored
+        newReader->frameCount = (size - sizeof(TrajectoryHeader)) / sizeof(TrajectoryFrame);
+    }
+
+    *reader = newReader;
+    return true;
+}
+
+TrajectoryParams getTrajectoryParams(TrajectoryReader* reader)
+{
+    return reader->header.params;
+}
+
+uint64_t getTrajectoryFrameCount(TrajectoryReader* reader)
+{
+    return reader->frameCount;
+}
+
+bool isTrajectoryIndexed(TrajectoryReader* reader)
+{
+    return reader->index != nullptr;
+}
+
+const TrajectoryFrame* getTrajectoryFrame(TrajectoryReader* reader, uint64_t index)
+{
+    if (index >= reader->frameCount) { return nullptr; }
+    return &reader->frames[index];
+}
+
+// last frame in [begin, end) at or before t, begin if there is none
+static uint64_t searchFrames(TrajectoryReader* reader, uint64_t begin, uint64_t end, double t)
+{
+    const TrajectoryFrame* found = std::upper_bound(reader->frames + begin, reader->frames + end, t,
+        [](double time, const TrajectoryFrame& frame) { return time < frame.t; });
+
+    uint64_t after = (uint64_t)(found - reader->frames);
+    return after > begin ? after - 1 : begin;
+}
+
+uint64_t findTrajectoryFrame(TrajectoryReader* reader, double t)
+{
+    if (reader->frameCount == 0) { return 0; }
+    if (!reader->index) { return searchFrames(reader, 0, reader->frameCount, t); }
+
+    // with a constant time step the guess is already the right index entry, otherwise it is walked to the
+    // nearest one that brackets t, which only pages in the index around the guess
+    uint64_t interval = reader->header.indexInterval;
+    double chunkTime = reader->header.params.dt * interval;
+    double guess = chunkTime > 0.0 ? std::floor((t - reader->index[0]) / chunkTime) : 0.0;
+    uint64_t chunk = guess > 0.0 ? std::min((uint64_t)std::min(guess, 1.0e18), reader->indexCount - 1) : 0;
+
+    while (chunk > 0 && reader->index[chunk] > t) { chunk--; }
+    while (chunk + 1 < reader->indexCount && reader->index[chunk + 1] <= t) { chunk++; }
+
+    uint64_t begin = chunk * interval;
+    return searchFrames(reader, begin, std::min(begin + interval, reader->frameCount), t);
+}
+
+void closeTrajectory(TrajectoryReader* reader)
+{
+    munmap((void*)reader->data, reader->size);
+    delete reader;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <stdint.h>
+
+// binary trajectory files, laid out as
+//   header   parameters the run started with and the integrator
+//   frames   fixed size TrajectoryFrame records, frame n is at sizeof(header) + n * sizeof(TrajectoryFrame)
+//   index    the time of every indexInterval-th frame
+//   trailer  where the index starts and how many frames there are, always the last bytes of the file
+// readers map the file instead of loading it, so run length is only limited by disk space. a file whose writer
+// never finished has no index or trailer, it is still readable from its frames alone
+
+enum TrajectoryIntegrator
+{
+    Trajectory_Integrator_SemiImplicitEuler = 1, // velocities first, then angles from the new velocities
+};
+
+struct TrajectoryParams
+{
+    float m1, m2;
+    float l1, l2;
+    float g;
+    float dt;
+    uint32_t integrator; // TrajectoryIntegrator
+};
+
+struct TrajectoryFrame
+{
+    double t;
+    float a1, a2;
+    float av1, av2;
+};
+
+struct TrajectoryWriter;
+struct TrajectoryReader;
+
+struct TrajectoryWriterCreateInfo
+{
+    const char* path;
+    TrajectoryParams params;
+    uint32_t indexInterval; // frames between index entries
+    uint32_t bufferSize;    // bytes collected before each write, rounded up to a multiple of 4096
+};
+
+bool createTrajectoryWriter(TrajectoryWriter** writer, TrajectoryWriterCreateInfo* createInfo);
+bool writeTrajectoryFrame(TrajectoryWriter* writer, const TrajectoryFrame* frame);
+bool finishTrajectoryWriter(TrajectoryWriter* writer); // writes the index and trailer, no frames can follow
+uint64_t getTrajectoryWriterFrameCount(TrajectoryWriter* writer);
+void destroyTrajectoryWriter(TrajectoryWriter* writer);
+
+bool openTrajectory(TrajectoryReader** reader, const char* path);
+TrajectoryParams getTrajectoryParams(TrajectoryReader* reader);
+uint64_t getTrajectoryFrameCount(TrajectoryReader* reader);
+bool isTrajectoryIndexed(TrajectoryReader* reader);
+const TrajectoryFrame* getTrajectoryFrame(TrajectoryReader* reader, uint64_t index);
+
+// the last frame at or before t, the first frame if t is earlier than all of them
+uint64_t findTrajectoryFrame(TrajectoryReader* reader, double t);
+void closeTrajectory(TrajectoryReader* reader);